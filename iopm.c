@@ -23,6 +23,31 @@ You should have received a copy of the GNU General Public License along with thi
 //-------------------------------------------------------------------------
 // Ver 1.00    Initial release
 // Ver 1.01    bug fix: vwrite_kanji: fix number-2 byte flag bug
+// Ver 1.02    render through shadow text VRAM, flush dirty spans on vsync
+// Ver 1.03    add burst block I/O screen (f1)
+// Ver 1.04    add live port range scan screen (f2)
+// Ver 1.05    add PIT timestamped port capture screen (f3)
+// Ver 1.06    add headless script mode (-s)
+// Ver 1.07    add hardware abstraction layer and Linux simulator build (make host)
+// Ver 1.08    add host benchmark for render and log paths (make bench)
+// Ver 1.09    prebuild static UI strings into VRAM cells, compose log rows once
+// Ver 1.10    keep 8192 log entries in far memory, page back with ROLL keys
+// Ver 1.11    save log and capture as binary trace files (f4), add iopm_trace decoder (make tools)
+// Ver 1.12    record main screen I/O with PIT timing (f5), replay screen (f6) and -r/-rf
+// Ver 1.13    watch list of up to 16 ports polled while idle (f7/f8)
+// Ver 1.14    tick-driven scheduler on hooked IRQ0 replaces busy main loop, HLT when idle
+// Ver 1.15    optional direct keyboard path (-k): IRQ1 ring buffer, own modifier state, accelerated repeat
+// Ver 1.16    pattern write/readback screen (f9): walking 1/0, ramp, LFSR, constant; mismatch log and rate
+// Ver 1.17    port speed screen (f10): ns per inp/inpw/outp/outpw against the on-board PIC port
+// Ver 1.18    memory screen (shift+f1): segment:offset hex/ASCII dump from one REP MOVSW snapshot, byte/word writes
+// Ver 1.19    port range snapshot and differential compare screen (shift+f2)
+// Ver 1.20    draw main screen frames from a compact draw list instead of a 4KB cell table
+// Ver 1.21    board register database (iopm_regs.h) with O(1) port index, register names on/off (shift+f3)
+// Ver 1.22    indexed register-pair screen (shift+f4) with 256-register dump
+// Ver 1.23    IRQ activity monitor screen (shift+f5): per-line counts, rates and interval histogram
+// Ver 1.24    DMA transfer screen (shift+f6): 8237 port<->memory transfers with TC/stall detection
+// Ver 1.25    wait-for-condition screen (shift+f9): write-to-ready latency min/avg/max and histogram
+// Ver 1.26    RS-232C remote server screen (shift+f10) with batched binary protocol, add iopm_remote client (make tools)
 //-------------------------------------------------------------------------
 
 #pragma pack(1)
@@ -51,115 +76,210 @@ void inc_moji_pos(){
 
 //-------------------------------------------------------------------------
 /**
-* @brief 指定された文字コードはSJISかどうかを判定する
-* @param[in] 判定する1バイトコード
+* @brief シャドウVRAMの1行に更新範囲を追加する
+* @param[in] ｘ、ｙ
 * @param[out] 無し
-* @return 1=SJIS 0=SJISじゃない
-* @details 渡された8ビットデータが、SJIS漢字文字コードの1バイト目かどうかを判定する。
+* @return 無し
+* @details 行ごとに更新が必要な桁の範囲を1つだけ持ち、広げていく。
 */
-uint8_t is_SJIS(uint8_t code){
-	uint8_t result = 0;
-	if(      (code > 0x80) && (code < 0xA0)){
-		result = 1;
-	}else if((code > 0xDF) && (code < 0xFD)){
-		result = 1;
+void shadow_mark(uint16_t vx, uint16_t vy){
+	if(dirty_x1[vy] == 0){
+		dirty_x0[vy] = vx;
+		dirty_x1[vy] = vx + 1;
+		dirty_rows++;
+	}else{
+		if(vx <  dirty_x0[vy]) dirty_x0[vy] = vx;
+		if(vx >= dirty_x1[vy]) dirty_x1[vy] = vx + 1;
 	}
-	return result;
 }
 
+//-------------------------------------------------------------------------
+/**
+* @brief バーチャルカーソルの位置のシャドウVRAMを書き換える
+* @param[in] 文字コード、属性
+* @param[out] 無し
+* @return 無し
+* @details 内容が変わったセルだけを更新範囲に加える。
+*/
+void shadow_put(uint16_t code, uint16_t attr){
+	uint16_t pos = (vposy * TVRAM_WIDTH) + vposx;
 
+	if((shadow_code[pos] != code) || (shadow_attr[pos] != attr)){
+		shadow_code[pos] = code;
+		shadow_attr[pos] = attr;
+		shadow_mark(vposx, vposy);
+	}
+}
 
 //-------------------------------------------------------------------------
 /**
-* @brief バーチャルカーソルの位置に任意の属性で半角1バイト文字を1文字書き込む
-* @param[in] 文字データ、属性
+* @brief 任意の位置のシャドウVRAMの属性だけを書き換える
+* @param[in] 属性、ｘ、ｙ
 * @param[out] 無し
 * @return 無し
-* @details バーチャルカーソルの位置に任意の属性で半角1バイト文字を1文字書き込む
+* @details カーソル表示用。
 */
-void vwrite_moji(uint16_t value, uint16_t attr){
-	uint16_t __far *addr_code = (uint16_t __far *)0xA0000000;
-	uint16_t __far *addr_attr = (uint16_t __far *)0xA0002000;
+void shadow_set_attr(uint16_t attr, uint16_t vx, uint16_t vy){
+	uint16_t pos = (vy * TVRAM_WIDTH) + vx;
 
-	addr_code[(vposy * 80) + vposx] = (value & 0x00FF);
-	addr_attr[(vposy * 80) + vposx] = (attr | ATTR_VISIBLE);
-
-	inc_moji_pos();
+	attr |= ATTR_VISIBLE;
+	if(shadow_attr[pos] != attr){
+		shadow_attr[pos] = attr;
+		shadow_mark(vx, vy);
+	}
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief バーチャルカーソルの位置に任意の属性で漢字を1文字書き込む
-* @param[in] 文字データ、属性
+* @brief 変換済みのセル列を同じ属性でシャドウVRAMに書き込む
+* @param[in] セル列、セル数、属性、ｘ、ｙ
 * @param[out] 無し
 * @return 無し
-* @details バーチャルカーソルの位置に任意の属性で漢字を1文字書き込む
+* @details 行をまたがないこと。SJISの判定も変換もしないので、固定文字列はiopm_cells.hのセル列を渡す。
+* @details 変わったセルの範囲だけを1回で更新範囲に加える。
 */
-void vwrite_kanji(uint16_t value, uint16_t attr){
-	uint16_t __far *addr_code = (uint16_t __far *)0xA0000000;
-	uint16_t __far *addr_attr = (uint16_t __far *)0xA0002000;
+void shadow_write_cells(const uint16_t *cells, uint8_t len, uint16_t attr, uint16_t vx, uint16_t vy){
+	uint16_t pos   = (vy * TVRAM_WIDTH) + vx;
+	uint8_t  first = len;
+	uint8_t  last  = 0;
 
-	addr_code[(vposy * 80) + vposx]     = (value & 0xFF7F);
-	addr_code[(vposy * 80) + vposx + 1] = (value | 0x0080);
-	addr_attr[(vposy * 80) + vposx]     = (attr | ATTR_VISIBLE);
-	addr_attr[(vposy * 80) + vposx + 1] = (attr | ATTR_VISIBLE);
-
-	inc_moji_pos();
-	inc_moji_pos();
+	attr |= ATTR_VISIBLE;
+	for(uint8_t index = 0; index < len; index++, pos++){
+		if((shadow_code[pos] != cells[index]) || (shadow_attr[pos] != attr)){
+			shadow_code[pos] = cells[index];
+			shadow_attr[pos] = attr;
+			if(first == len) first = index;
+			last = index;
+		}
+	}
+	if(first != len){
+		shadow_mark(vx + first, vy);
+		shadow_mark(vx + last,  vy);
+	}
 }
 
+//-------------------------------------------------------------------------
+/**
+* @brief 1セルずつ属性の違うセル列をシャドウVRAMに書き込む
+* @param[in] セル列、属性列、セル数、ｘ、ｙ
+* @param[out] 無し
+* @return 無し
+* @details 行をまたがないこと。ログの1行のように、作業用の配列で組み立てた行を一度に書く時に使う。
+*/
+void shadow_write_row(const uint16_t *cells, const uint16_t *attrs, uint8_t len, uint16_t vx, uint16_t vy){
+	uint16_t pos   = (vy * TVRAM_WIDTH) + vx;
+	uint8_t  first = len;
+	uint8_t  last  = 0;
 
+	for(uint8_t index = 0; index < len; index++, pos++){
+		uint16_t attr = attrs[index] | ATTR_VISIBLE;
+		if((shadow_code[pos] != cells[index]) || (shadow_attr[pos] != attr)){
+			shadow_code[pos] = cells[index];
+			shadow_attr[pos] = attr;
+			if(first == len) first = index;
+			last = index;
+		}
+	}
+	if(first != len){
+		shadow_mark(vx + first, vy);
+		shadow_mark(vx + last,  vy);
+	}
+}
 
 //-------------------------------------------------------------------------
 /**
-* @brief メイン画面を表示する
+* @brief シャドウVRAM全体を更新対象にする
 * @param[in] 無し
 * @param[out] 無し
 * @return 無し
-* @details メイン画面を表示する
+* @details 起動直後など、テキストVRAMの内容がシャドウと一致しない場合に使う。
 */
-void write_main_frame(){
-	vposx = 0;
-	vposy = 0;
-	for(uint16_t index = 0; index < (80 * 24); index++){
-		vwrite_moji(op_frame[index], (ATTR_COLOR_BLUE | ATTR_VISIBLE));
+void shadow_invalidate(){
+	for(uint8_t vy = 0; vy < TVRAM_HEIGHT; vy++){
+		dirty_x0[vy] = 0;
+		dirty_x1[vy] = TVRAM_WIDTH;
 	}
+	dirty_rows = TVRAM_HEIGHT;
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief SJIS文字コードをVRAMに格納される形式(JIS)に変換する
-* @param[in] SJISの1バイト目、2バイト目
+* @brief GDCの垂直帰線期間の開始を待つ
+* @param[in] 無し
 * @param[out] 無し
-* @return VRAM形式(JIS)の漢字コード
-* @details printf書式ではないことに注意。
+* @return 無し
+* @details 帰線期間中に呼ばれた場合は次の帰線期間まで待つ。
 */
-uint16_t SJIS_to_VRAM(uint8_t code1, uint8_t code2){
-  code1 <<= 1;
-  if( code2 < 0x9F ){
-    if( code1 < 0x3F ){
-		code1 += 0x1F;
-	}else{
-		code1 -= 0x61;
-	}
-    if( code2 > 0x7E ){
-		code2 -= 0x20;
-	}else{
-		code2 -= 0x1F;
+void wait_vsync(){
+	while(port_in8(GDC_STATUS) & GDC_VSYNC);
+	while(!(port_in8(GDC_STATUS) & GDC_VSYNC));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief シャドウVRAMの更新範囲をすぐにテキストVRAMに反映する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 垂直帰線期間を待たない。帰線期間に入ったのを呼ぶ側で確かめてある場合に使う。
+*/
+void screen_copy(){
+	for(uint8_t vy = 0; vy < TVRAM_HEIGHT; vy++){
+		if(dirty_x1[vy]){
+			uint16_t pos   = (vy * TVRAM_WIDTH) + dirty_x0[vy];
+			uint16_t count = dirty_x1[vy] - dirty_x0[vy];
+			hal_copy_to_far(TVRAM_CODE + pos, &shadow_code[pos], count);
+			hal_copy_to_far(TVRAM_ATTR + pos, &shadow_attr[pos], count);
+			dirty_x1[vy] = 0;
+		}
 	}
-  }else{
-    if( code1 < 0x3F ){
-		code1 += 0x20;
-	}else{
-		code1 -= 0x60;
+	dirty_rows = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief シャドウVRAMの更新範囲をテキストVRAMに反映する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 更新が無ければ何もしない。あれば垂直帰線期間に合わせて、行ごとの更新範囲だけを転送する。
+*/
+void screen_flush(){
+	if(dirty_rows == 0){
+		return;
 	}
-    code2 -= 0x7E;
-  }
-  code1 -= 0x20;
 
-  return (((uint16_t)code2)<< 8) + ((uint16_t)code1);
+	wait_vsync();
+	screen_copy();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief バーチャルカーソルの位置に任意の属性で半角1バイト文字を1文字書き込む
+* @param[in] 文字データ、属性
+* @param[out] 無し
+* @return 無し
+* @details 書き込み先はシャドウVRAM。テキストVRAMへはscreen_flush()で反映される。
+*/
+void vwrite_moji(uint16_t value, uint16_t attr){
+	shadow_put((value & 0x00FF), (attr | ATTR_VISIBLE));
+	inc_moji_pos();
 }
 
+//-------------------------------------------------------------------------
+/**
+* @brief バーチャルカーソルの位置に任意の属性で漢字を1文字書き込む
+* @param[in] 文字データ、属性
+* @param[out] 無し
+* @return 無し
+* @details 書き込み先はシャドウVRAM。テキストVRAMへはscreen_flush()で反映される。
+*/
+void vwrite_kanji(uint16_t value, uint16_t attr){
+	shadow_put((value & 0xFF7F), (attr | ATTR_VISIBLE));
+	inc_moji_pos();
+	shadow_put((value | 0x0080), (attr | ATTR_VISIBLE));
+	inc_moji_pos();
+}
 
 
 
@@ -253,51 +373,74 @@ uint32_t word_str(uint16_t value){
 
 //-------------------------------------------------------------------------
 /**
-* @brief デバッグ用カウンタ表示
-* @param[in] ｘ、ｙ
+* @brief 矩形領域を空白で塗りつぶす
+* @param[in] 属性、左上ｘ、左上ｙ、幅、高さ
 * @param[out] 無し
 * @return 無し
-* @details デバッグ用カウンタ表示
+* @details サブ画面の表示領域を消すのに使う。
 */
-void debug_counter_proc(uint16_t vx, uint16_t vy){
-	degub_cnt++;
-	VRAM_print_word(word_str(degub_cnt), (ATTR_COLOR_SKY | ATTR_REVERSE), vx, vy);
+void clear_area(uint8_t attr, uint16_t vx, uint16_t vy, uint16_t width, uint16_t height){
+	for(uint16_t y = vy; y < (vy + height); y++){
+		vposx = vx;
+		vposy = y;
+		for(uint16_t x = 0; x < width; x++){
+			vwrite_moji(0x0020, (uint16_t)attr);
+		}
+	}
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief ログを再描画する。
-* @param[in] 無し
+* @brief 罫線で枠を描く
+* @param[in] 属性、左上ｘ、左上ｙ、右下ｘ、右下ｙ
 * @param[out] 無し
 * @return 無し
-* @details 最新ログは黄色でハイライト、次に書き込む位置はブリンク。
+* @details 罫線は半角グラフィック文字（0x90～0x9F）を使う。
 */
-void disp_log(){
-	for(uint8_t curr_x = 0; curr_x < 2; curr_x++){
-		for(uint8_t curr_y = 0; curr_y < 20; curr_y++){
-			uint8_t attr = (((lastlog_x == curr_x) && (lastlog_y == curr_y)) ? (ATTR_COLOR_YELLOW | ATTR_REVERSE) : ATTR_COLOR_WHITE );
-			attr |= (((log_x == curr_x) && (log_y == curr_y)) ? ATTR_BLINK : 0 );
-			if(logs[curr_x][curr_y].avail){
-				VRAM_print(" *  :  **  : __00 : __00", attr, (curr_x ? 54 : 27), 2 + curr_y);
-				if(logs[curr_x][curr_y].r_w){
-					VRAM_print("W", ATTR_COLOR_RED, (curr_x ? 55 : 28), 2 + curr_y);
-				}else{
-					VRAM_print("R", ATTR_COLOR_SKY, (curr_x ? 55 : 28), 2 + curr_y);
-				}
-				if(logs[curr_x][curr_y].b_w){
-					VRAM_print("16", ATTR_COLOR_WHITE,  (curr_x ? 61 : 34), 2 + curr_y);
-				}else{
-					VRAM_print(" 8", ATTR_COLOR_YELLOW, (curr_x ? 61 : 34), 2 + curr_y);
-				}
-					VRAM_print_word(word_str(logs[curr_x][curr_y].addr), ATTR_COLOR_WHITE, (curr_x ? 67 : 40), 2 + curr_y);
-				if(logs[curr_x][curr_y].b_w){
-					VRAM_print_word(word_str(logs[curr_x][curr_y].data), ATTR_COLOR_WHITE, (curr_x ? 74 : 47), 2 + curr_y);
-				}else{
-					VRAM_print_byte(byte_str(logs[curr_x][curr_y].data), ATTR_COLOR_WHITE, (curr_x ? 76 : 49), 2 + curr_y);
-				}
-			
-			}else{
-				VRAM_print("--- : ---- : ---- : ----", attr, (curr_x ? 54 : 27), 2 + curr_y);
+void draw_box(uint8_t attr, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1){
+	vposx = x0;
+	vposy = y0;
+	vwrite_moji(0x009C, (uint16_t)attr);
+	for(uint16_t x = x0 + 1; x < x1; x++){
+		vwrite_moji(0x0095, (uint16_t)attr);
+	}
+	vwrite_moji(0x009D, (uint16_t)attr);
+
+	for(uint16_t y = y0 + 1; y < y1; y++){
+		vposx = x0;
+		vposy = y;
+		vwrite_moji(0x0096, (uint16_t)attr);
+		vposx = x1;
+		vwrite_moji(0x0096, (uint16_t)attr);
+	}
+
+	vposx = x0;
+	vposy = y1;
+	vwrite_moji(0x009E, (uint16_t)attr);
+	for(uint16_t x = x0 + 1; x < x1; x++){
+		vwrite_moji(0x0095, (uint16_t)attr);
+	}
+	vwrite_moji(0x009F, (uint16_t)attr);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 矩形を1つの文字で埋める
+* @param[in] 文字、属性、左上ｘ、左上ｙ、幅、高さ
+* @param[out] 無し
+* @return 無し
+* @details シャドウVRAMに直接書き、変わったセルだけを更新範囲に入れる。
+*/
+void frame_fill(uint16_t code, uint16_t attr, uint16_t vx, uint16_t vy, uint16_t width, uint16_t height){
+	attr |= ATTR_VISIBLE;
+	for(uint16_t y = vy; y < (vy + height); y++){
+		uint16_t pos = (y * TVRAM_WIDTH) + vx;
+
+		for(uint16_t x = vx; x < (vx + width); x++, pos++){
+			if((shadow_code[pos] != code) || (shadow_attr[pos] != attr)){
+				shadow_code[pos] = code;
+				shadow_attr[pos] = attr;
+				shadow_mark(x, y);
 			}
 		}
 	}
@@ -305,277 +448,5134 @@ void disp_log(){
 
 //-------------------------------------------------------------------------
 /**
-* @brief IOポート読み書きをログに残す。
-* @param[in] 読み書き、8/16、アドレス、データ
+* @brief 描画リストに従って画面の枠を描く
+* @param[in] 描画リスト（FRAME_ENDで終わる）
 * @param[out] 無し
 * @return 無し
-* @details 残すのはR/W、8/16、アドレス、データ。
-* @details タイムスタンプもあったほうがいい？
+* @details 画面全体をセルの表で持たず、埋める矩形と罫線の枠の並びで持つ。後の命令ほど上に重なる。
 */
-void logger(uint8_t r_w, uint8_t b_w, uint16_t addr, uint16_t data){
-	logs[log_x][log_y].avail = 1;
-	logs[log_x][log_y].r_w = r_w;
-	logs[log_x][log_y].b_w = b_w;
-	logs[log_x][log_y].addr = addr;
-	logs[log_x][log_y].data = data;
-	lastlog_x = log_x;
-	lastlog_y = log_y;
-	if(++log_y > 19){
-		log_y = 0;
-		++log_x;
-		log_x &= 1;
+void frame_draw(const st_frame *list){
+	for(; list->code != FRAME_END; list++){
+		if(list->code == FRAME_BOX){
+			draw_box(list->attr, list->x, list->y, list->x + list->w - 1, list->y + list->h - 1);
+		}else{
+			frame_fill(list->cell, list->attr, list->x, list->y, list->w, list->h);
+		}
 	}
-	disp_log();
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief 16ビット読み込み
-* @param[in] 無し
+* @brief サブ画面の枠を表示する
+* @param[in] タイトル文字列
 * @param[out] 無し
 * @return 無し
-* @details IOポートから16ビットのデータを読み込む。アドレスとデータは読み込み後にログに残す。
+* @details 全面を消して外枠とタイトルを描く。中身は各サブ画面が描く。
 */
-void io_read_16bit(){
-	uint16_t value = inpw(addr_digit);
-	logger(0,1,addr_digit, value);
+void draw_sub_frame(uint8_t *title){
+	log_visible = 0;
+	frame_draw(frame_sub);
+	VRAM_print(title, ATTR_COLOR_YELLOW, 2, 0);
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief 16ビット書き込み
-* @param[in] 無し
+* @brief デバッグ用カウンタ表示
+* @param[in] ｘ、ｙ
 * @param[out] 無し
 * @return 無し
-* @details IOポートに16ビットのデータを書き込む。アドレスとデータは書き込み前にログに残す。
+* @details デバッグ用カウンタ表示
 */
-void io_write_16bit(){
-	logger(1,1,addr_digit, word_digit);
-	outpw(addr_digit, word_digit);
+void debug_counter_proc(uint16_t vx, uint16_t vy){
+	degub_cnt++;
+	VRAM_print_word(word_str(degub_cnt), (ATTR_COLOR_SKY | ATTR_REVERSE), vx, vy);
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief 8ビット読み込み
+* @brief PITの入力クロックを調べる
 * @param[in] 無し
 * @param[out] 無し
 * @return 無し
-* @details IOポートから８ビットのデータを読み込む。アドレスとデータは読み込み後にログに残す。
+* @details BIOSワークエリア 0000:0501 のbit7が立っていれば8MHz系(1.9968MHz)、そうでなければ5MHz系(2.4576MHz)。
 */
-void io_read_8bit(){
-	uint8_t value = inp(addr_digit);
-	logger(0,0,addr_digit, value);
+void pit_detect_clock(){
+	uint8_t __far *bios_flag = (uint8_t __far *)MK_FP(0x0000, 0x0501);
+
+	pit_clock = ((*bios_flag & 0x80) ? PIT_CLOCK_8MHZ : PIT_CLOCK_5MHZ);
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief 8ビット書き込み
+* @brief PITカウンタ0の現在値を読む
 * @param[in] 無し
 * @param[out] 無し
-* @return 無し
-* @details IOポートに８ビットのデータを書き込む。アドレスとデータは書き込み前にログに残す。
+* @return カウンタ値（ダウンカウント）
+* @details カウンタラッチコマンドでラッチしてから下位、上位の順に読む。
+* @details 割り込み監視のISRも同じカウンタをラッチして読むので、ラッチから2回目の読み込みまでは割り込みを止める。
 */
-void io_write_8bit(){
-	logger(1,0,addr_digit, byte_digit);
-	outp(addr_digit, byte_digit);
+uint16_t pit_read(){
+	uint16_t flags = hal_int_save();
+
+	port_out8(PIT_CONTROL, 0x00);				//カウンタ0 ラッチ
+	uint16_t value = port_in8(PIT_COUNTER0);
+	value |= ((uint16_t)port_in8(PIT_COUNTER0) << 8);
+	hal_int_restore(flags);
+	return value;
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief 数値の再描画
+* @brief PITカウンタ0を一周65536カウントで回す
 * @param[in] 無し
 * @param[out] 無し
 * @return 無し
-* @details アドレスと、書き込み用の数値、およびカーソルを再描画する。
+* @details モード2、カウント65536。割り込みのマスクは呼ぶ側で行うこと。
 */
-void redraw_digit(){
-	VRAM_print_word(word_str(addr_digit), ATTR_COLOR_WHITE, 18, 1);
-	VRAM_print_word(word_str(word_digit), ATTR_COLOR_WHITE, 18, 3);
-	VRAM_print_byte(byte_str(byte_digit), ATTR_COLOR_WHITE, 20, 5);
-
-	uint16_t __far *addr_attr = (uint16_t __far *)0xA0002000;
-
-	addr_attr[(((cursol_y * 2) + 1) * 80) + (cursol_x + ((cursol_y == 2) ? 20 : 18))] = (ATTR_COLOR_YELLOW | ATTR_REVERSE | ATTR_VISIBLE);
+void pit_free_run(){
+	port_out8(PIT_CONTROL, 0x34);				//カウンタ0 下位→上位 モード2 バイナリ
+	port_out8(PIT_COUNTER0, 0x00);
+	port_out8(PIT_COUNTER0, 0x00);
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief カーソル位置の数値を1つ上げる。
+* @brief PITカウンタ0をスケジューラの周期で回す
 * @param[in] 無し
 * @param[out] 無し
 * @return 無し
-* @details カーソル位置の数値を1つ上げる。桁の繰り上がりもする。
+* @details モード2、カウントsched_divisor。スケジューラが止まっていれば何もしない。
 */
-void value_up(){
-	switch(cursol_y){
-	case 0:
-		addr_digit += (0x0001 << ((3-cursol_x) * 4));
-		break;
-	case 1:
-		word_digit += (0x0001 << ((3-cursol_x) * 4));
-		break;
-	case 2:
-		byte_digit += (0x01   << ((1-cursol_x) * 4));
-		break;
+void sched_program(){
+	if(sched_divisor == 0){
+		return;
 	}
-	redraw_digit();
+	port_out8(PIT_CONTROL, 0x34);				//カウンタ0 下位→上位 モード2 バイナリ
+	port_out8(PIT_COUNTER0, (uint8_t)sched_divisor);
+	port_out8(PIT_COUNTER0, (uint8_t)(sched_divisor >> 8));
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief カーソル位置の数値を1つ下げる。
+* @brief PITカウンタ0を計測用に起動する
 * @param[in] 無し
 * @param[out] 無し
 * @return 無し
-* @details カーソル位置の数値を1つ下げる。桁の繰り下がりもする。
+* @details タイマ割り込み(IRQ0)をマスクし、カウンタ0をモード2、カウント65536で回す。
+* @details カウンタは約27msで一周するので、それより短い間隔でpit_elapsed()を呼ぶこと。
 */
-void value_down(){
-	switch(cursol_y){
-	case 0:
-		addr_digit -= (0x0001 << ((3-cursol_x) * 4));
-		break;
-	case 1:
-		word_digit -= (0x0001 << ((3-cursol_x) * 4));
-		break;
-	case 2:
-		byte_digit -= (0x01   << ((1-cursol_x) * 4));
-		break;
-	}
-	redraw_digit();
+void pit_start(){
+	pit_saved_imr = port_in8(PIC_MASTER_IMR);
+	port_out8(PIC_MASTER_IMR, (pit_saved_imr | 0x01));
+	pit_free_run();
+	pit_last  = pit_read();
+	pit_ticks = 0;
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief カーソル上移動
+* @brief PIT計測開始からの経過カウントを得る
 * @param[in] 無し
 * @param[out] 無し
-* @return 無し
-* @details カーソルを上に移動する。行き過ぎるとループする
+* @return 経過カウント
+* @details 前回読み出しからの差分を積算する。カウンタの一周は差分の桁あふれで吸収される。
 */
-void cursol_up(){
-	if(--cursol_y > 2){
-		cursol_y = 2;
-	}
-	if(cursol_y == 2){
-		cursol_x &= 1;
-	}
-	redraw_digit();
+uint32_t pit_elapsed(){
+	uint16_t now = pit_read();
+	pit_ticks += (uint16_t)(pit_last - now);
+	pit_last = now;
+	return pit_ticks;
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief カーソル左移動
+* @brief PITの計測を終える
 * @param[in] 無し
 * @param[out] 無し
 * @return 無し
-* @details カーソルを左に移動する。行き過ぎるとループする
+* @details 割り込みマスクを元に戻す。スケジューラが動いていればカウンタ0をその周期に戻す。
 */
-void cursol_left(){
-	--cursol_x;
-	cursol_x &= 0x03;
-	if(cursol_y == 2){
-		cursol_x &= 1;
+void pit_stop(){
+	sched_program();
+	port_out8(PIC_MASTER_IMR, pit_saved_imr);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief PITのカウント数をマイクロ秒に換算する
+* @param[in] カウント数
+* @param[out] 無し
+* @return マイクロ秒
+* @details 1000000/2457600 = 625/1536、1000000/1996800 = 625/1248 で、32ビットを超えないよう分けて計算する。
+*/
+uint32_t pit_to_us(uint32_t ticks){
+	uint16_t div = ((pit_clock == PIT_CLOCK_8MHZ) ? 1248 : 1536);
+
+	return ((ticks / div) * 625) + (((ticks % div) * 625) / div);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 1秒あたりの回数を求める
+* @param[in] 回数、経過カウント
+* @param[out] 無し
+* @return 回数/秒
+* @details 経過カウントが0なら0を返す。
+*/
+uint32_t pit_rate(uint32_t count, uint32_t ticks){
+	if(ticks == 0){
+		return 0;
 	}
-	redraw_digit();
+	return (uint32_t)(((unsigned long long)count * pit_clock) / ticks);
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief カーソル右移動
+* @brief スケジューラのタイマ割り込みを始める
 * @param[in] 無し
 * @param[out] 無し
 * @return 無し
-* @details カーソルを右に移動する。行き過ぎるとループする
+* @details PITカウンタ0をSCHED_HZの周期で回し、タイマ割り込み(IRQ0)を乗っ取ってマスクを外す。
+* @details 計測でpit_start()を使う間はIRQ0がマスクされるので、その間tickは進まない。
 */
-void cursol_right(){
-	++cursol_x;
-	cursol_x &= 0x03;
-	if(cursol_y == 2){
-		cursol_x &= 1;
-	}
-	redraw_digit();
+void sched_start(){
+	sched_divisor   = (uint16_t)(pit_clock / SCHED_HZ);
+	sched_saved_imr = port_in8(PIC_MASTER_IMR);
+	port_out8(PIC_MASTER_IMR, (sched_saved_imr | 0x01));
+	sched_program();
+	hal_tick_hook();
+	port_out8(PIC_MASTER_IMR, (sched_saved_imr & ~0x01));
 }
 
-
 //-------------------------------------------------------------------------
 /**
-* @brief カーソル下移動
+* @brief スケジューラのタイマ割り込みを終える
 * @param[in] 無し
 * @param[out] 無し
 * @return 無し
-* @details カーソルを下に移動する。行き過ぎるとループする
+* @details IRQ0をマスクしてから割り込みベクタを戻し、最後に開始前のマスクに戻す。
+* @details カウンタ0の周期は戻さない。BIOSのタイマを使う時はBIOSが設定し直す。
 */
-void cursol_down(){
-	if(++cursol_y > 2){
-		cursol_y = 0;
-	}
-	if(cursol_y == 2){
-		cursol_x &= 1;
-	}
-	redraw_digit();
+void sched_stop(){
+	port_out8(PIC_MASTER_IMR, (port_in8(PIC_MASTER_IMR) | 0x01));
+	hal_tick_unhook();
+	port_out8(PIC_MASTER_IMR, sched_saved_imr);
+	sched_divisor = 0;
 }
 
 //-------------------------------------------------------------------------
 /**
-* @brief キーボードセンス＆読み込み
+* @brief スケジューラの時計
 * @param[in] 無し
 * @param[out] 無し
-* @return uint8_t 有効なキーコード、または０か１
-* @details 使用されるキー意外は無視される。
-* @details センスされるキーは以下。
-* @details 0x00, //ESC
-* @details 0x34, //SPC
-* @details 0x1C, //ENTER
-* @details 0x3A, //UP
-* @details 0x3B, //LEFT
-* @details 0x3C, //RIGHT
-* @details 0x3D, //DOWN
-* @details シフトキー
+* @return sched_start()からの経過時間（PITのカウント数）
+* @details tick数×1tick分のカウント数に、カウンタ0の進み具合を足す。
+* @details カウンタを読む間にtickが進んでいたら、もう一度読み直す。
 */
-uint8_t kbread(){
-	union REGS  regs_param;						//BIOSコールパラメタ
-	union REGS  regs_result;					//BIOSコール戻り値
+uint32_t sched_clock(){
+	uint32_t ticks = hal_tick_count();
+	uint16_t count = pit_read();
+	uint32_t again = hal_tick_count();
 
-	regs_param.h.ah = 0x01; 					//指定：キーボードバッファーセンシング
-	int86( 0x18, &regs_param, &regs_result);	//BIOSコール実行
+	if(again != ticks){
+		ticks = again;
+		count = pit_read();
+	}
+	return (ticks * sched_divisor) + (uint16_t)(sched_divisor - count);
+}
 
-	if(regs_result.h.bh){ //入力あり
+//-------------------------------------------------------------------------
+/**
+* @brief レジスタ定義の索引を作る
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 64Kポートを256ポートずつのページに分け、レジスタのあるページだけにポート→番号の表を割り当てる。
+* @details これでポートからの検索は表を2回引くだけになる。ページが足りなければ、入らなかった定義は無視する。
+*/
+void reg_index_build(){
+	memset(reg_page, 0, sizeof(reg_page));
+	memset(reg_slot, 0, sizeof(reg_slot));
+	reg_pages = 0;
+	for(uint8_t index = 0; index < REG_COUNT; index++){
+		uint8_t high = (uint8_t)(reg_list[index].port >> 8);
 
-		regs_param.h.ah = 0x02; 					//指定：シフトキー状態のセンシング
-		int86( 0x18, &regs_param, &regs_result);	//BIOSコール実行
-		uint8_t shift = regs_result.h.al;			//シフトキー状態の保存
+		if(reg_page[high] == 0){
+			if(reg_pages >= REG_PAGES_MAX){
+				continue;
+			}
+			reg_page[high] = ++reg_pages;
+		}
+		reg_slot[reg_page[high] - 1][reg_list[index].port & 0xFF] = index + 1;
+	}
+}
 
-		regs_param.h.ah = 0x00; 					//指定：キーボードバッファーリード
-		int86( 0x18, &regs_param, &regs_result);	//BIOSコール実行
-		uint8_t keydata = regs_result.h.ah;
+//-------------------------------------------------------------------------
+/**
+* @brief ポートのレジスタ定義を探す
+* @param[in] ポート
+* @param[out] 無し
+* @return レジスタ定義　無ければNULL
+* @details 索引を引くだけなので、掃引のような大量の表示でも1ポートごとに呼んでよい。
+*/
+const st_reg *reg_find(uint16_t port){
+	uint8_t page = reg_page[port >> 8];
+	uint8_t slot;
+
+	if(page == 0){
+		return NULL;
+	}
+	slot = reg_slot[page - 1][port & 0xFF];
+	return (slot ? &reg_list[slot - 1] : NULL);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 値をビット欄ごとに分けた文字列を作る
+* @param[in] レジスタ定義、値、文字列の大きさ
+* @param[out] 文字列（"名前=値 "の並び）
+* @return 無し
+* @details 入りきらない欄は省く。値は16進で、1ビットの欄は0か1になる。
+*/
+void reg_decode(const st_reg *reg, uint16_t value, uint8_t *line, uint8_t size){
+	const char *spec = reg->fields;
+	uint8_t     used = 0;
+	uint8_t     item[24];
+
+	line[0] = 0;
+	while(*spec){
+		const char *name = spec;
+		uint8_t     len  = 0;
+		uint8_t     high = 0;
+		uint8_t     low;
+
+		while(*spec && (*spec != ':')){
+			spec++;
+			len++;
+		}
+		if(*spec == ':'){
+			spec++;
+		}
+		while((*spec >= '0') && (*spec <= '9')){
+			high = (high * 10) + (*spec++ - '0');
+		}
+		low = high;
+		if(*spec == '-'){
+			spec++;
+			low = 0;
+			while((*spec >= '0') && (*spec <= '9')){
+				low = (low * 10) + (*spec++ - '0');
+			}
+		}
+		while(*spec == ' '){
+			spec++;
+		}
+
+		uint16_t field = (value >> low) & (0xFFFF >> (15 - (high - low)));
+		uint8_t  count = (uint8_t)sprintf((char *)item, "%.*s=%X ", len, name, field);
+		if((used + count) >= size){
+			break;
+		}
+		memcpy(&line[used], item, count + 1);
+		used += count;
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ログ格納用のファーメモリを確保する
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=成功 0=メモリが足りない
+* @details LOG_CAPACITY件分を1セグメントに確保する。
+*/
+uint8_t log_init(){
+	if(log_seg == 0){
+		log_seg = hal_far_alloc((uint16_t)(((uint32_t)LOG_CAPACITY * sizeof(st_logcell) + 15) >> 4));
+	}
+	return (log_seg != 0);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ログ1件分の格納位置
+* @param[in] ログの番号
+* @param[out] 無し
+* @return ファーポインタ
+* @details 番号はLOG_CAPACITYで折り返す。
+*/
+st_logcell __far *log_cell(uint32_t number){
+	return (st_logcell __far *)MK_FP(log_seg, (uint16_t)(number & (LOG_CAPACITY - 1)) * sizeof(st_logcell));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 保持しているログの件数
+* @param[in] 無し
+* @param[out] 無し
+* @return 件数
+* @details
+*/
+uint16_t log_retained(){
+	return ((log_total > LOG_CAPACITY) ? LOG_CAPACITY : (uint16_t)log_total);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 最新のログのレジスタ名とビット欄を最下行に表示する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details レジスタ名表示の時だけ。ログが増えていなければ何もしない。表示をやめた時は1回だけ消す。
+*/
+void reg_draw_line(){
+	uint8_t line[TVRAM_WIDTH + 1];
+
+	if(reg_line_valid && (!reg_names || (reg_shown_total == log_total))){
+		return;
+	}
+	reg_line_valid  = 1;
+	reg_shown_total = log_total;
+	clear_area(ATTR_COLOR_WHITE, 0, 23, TVRAM_WIDTH, 1);
+	if(!reg_names || (log_total == 0)){
+		return;
+	}
+
+	st_logcell __far *log = log_cell(log_total - 1);
+	const st_reg     *reg = reg_find(log->addr);
+	uint8_t           used;
+
+	used = (uint8_t)sprintf((char *)line, "%c %04X %-*s %0*X ", ((log->flags & LOG_FLAG_WRITE) ? 'W' : 'R'), log->addr,
+		REG_NAME_LEN, (reg ? reg->name : "-"), ((log->flags & LOG_FLAG_16BIT) ? 4 : 2), log->data);
+	if(reg){
+		reg_decode(reg, log->data, &line[used], (uint8_t)(sizeof(line) - used));
+	}
+	VRAM_print(line, ATTR_COLOR_SKY, 0, 23);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ログ1行をレジスタ名つきの並びに組み替える
+* @param[in] ログ1行分のセル（数値で組み立て済み）、属性、アドレス
+* @param[out] ログ1行分のセル、属性
+* @return 無し
+* @details " R ADDR 名前       DATA "の並びにする。R/W、アドレス、データは組み立て済みのセルを移すだけ。
+*/
+void reg_log_row(uint16_t *cells, uint16_t *attrs, uint16_t addr){
+	const st_reg *reg  = reg_find(addr);
+	const char   *name = (reg ? reg->name : "");
+	uint8_t       index;
+
+	for(index = 0; index < 4; index++){
+		cells[3 + index]  = cells[13 + index];
+		cells[19 + index] = cells[20 + index];
+		attrs[19 + index] = attrs[20 + index];
+	}
+	cells[0] = cells[2] = cells[7] = cells[18] = cells[23] = ' ';
+	for(index = 0; index < REG_NAME_LEN; index++){
+		cells[8 + index] = (*name ? (uint8_t)*name++ : ' ');
+		attrs[8 + index] = ATTR_COLOR_SKY;
+	}
+	for(index = 3; index < 7; index++){
+		attrs[index] = ATTR_COLOR_WHITE;
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ログの件数と表示中のページを表示する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 過去のページを表示している間は黄色にする。件数もページも変わっていなければ何もしない。
+*/
+void disp_log_status(){
+	static uint16_t shown_retained = 0;
+	static uint16_t shown_scroll   = 0;
+	uint8_t line[32];
+
+	if(log_status_valid && (shown_retained == log_retained()) && (shown_scroll == log_scroll)){
+		return;
+	}
+	shown_retained   = log_retained();
+	shown_scroll     = log_scroll;
+	log_status_valid = 1;
+	if(log_scroll){
+		sprintf((char *)line, "履歴:%5u件 -%4u頁 ", log_retained(), log_scroll);
+	}else{
+		sprintf((char *)line, "履歴:%5u件 最新    ", log_retained());
+	}
+	VRAM_print(line, (log_scroll ? ATTR_COLOR_YELLOW : ATTR_COLOR_WHITE), 2, 18);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ログを再描画する。
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 40個の表示位置はログの番号をLOG_PAGEで割った余りで決まり、各位置には表示中のページの分だけ遡ったログを出す。
+* @details 描くのは画面に見えている40件だけ。最新のページでは、最新ログは黄色でハイライト、次に書き込む位置はブリンク。
+* @details 1行分を作業用の配列で組み立ててから書き込むので、変化の無い行は更新範囲に入らない。
+* @details 右側にウォッチを表示している間は件数表示だけを更新する。
+*/
+void disp_log(){
+	uint16_t cells[UI_log_used_LEN];
+	uint16_t attrs[UI_log_used_LEN];
+	uint32_t oldest = log_total - log_retained();
+	uint32_t back   = (uint32_t)log_scroll * LOG_PAGE;
+	uint8_t  next   = (uint8_t)(log_total % LOG_PAGE);
+	uint8_t  last   = (next ? (next - 1) : (LOG_PAGE - 1));
+
+	if(watch_visible){
+		disp_log_status();
+		reg_draw_line();
+		return;
+	}
+	for(uint8_t slot = 0; slot < LOG_PAGE; slot++){
+		uint8_t  curr_x = slot / 20;
+		uint8_t  curr_y = slot % 20;
+		uint8_t  avail  = 0;
+		uint32_t number = 0;
+		uint8_t  attr   = ATTR_COLOR_WHITE;
+
+		if(log_total > slot){
+			number = (log_total - 1) - ((last >= slot) ? (last - slot) : (last + LOG_PAGE - slot));
+			if((number >= back) && ((number - back) >= oldest)){
+				number -= back;
+				avail = 1;
+			}
+		}
+		if(log_scroll == 0){
+			attr = ((log_total && (last == slot)) ? (ATTR_COLOR_YELLOW | ATTR_REVERSE) : ATTR_COLOR_WHITE );
+			attr |= ((next == slot) ? ATTR_BLINK : 0 );
+		}
+		if(avail){
+			st_logcell __far *log = log_cell(number);
+			uint16_t addr = log->addr;
+			uint16_t data = log->data;
+			uint8_t  flags = log->flags;
+
+			memcpy(cells, &ui_cells[UI_log_used], sizeof(cells));
+			for(uint8_t index = 0; index < UI_log_used_LEN; index++){
+				attrs[index] = attr;
+			}
+			cells[1] = ((flags & LOG_FLAG_WRITE) ? 'W' : 'R');
+			attrs[1] = ((flags & LOG_FLAG_WRITE) ? ATTR_COLOR_RED : ATTR_COLOR_SKY);
+			if(flags & LOG_FLAG_16BIT){
+				cells[7] = '1';
+				cells[8] = '6';
+				attrs[7] = attrs[8] = ATTR_COLOR_WHITE;
+			}else{
+				cells[7] = ' ';
+				cells[8] = '8';
+				attrs[7] = attrs[8] = ATTR_COLOR_YELLOW;
+			}
+			cells[13] = nible_digit[(addr >> 12) & 0x0F];
+			cells[14] = nible_digit[(addr >>  8) & 0x0F];
+			cells[15] = nible_digit[(addr >>  4) & 0x0F];
+			cells[16] = nible_digit[ addr        & 0x0F];
+			attrs[13] = attrs[14] = attrs[15] = attrs[16] = ATTR_COLOR_WHITE;
+			if(flags & LOG_FLAG_16BIT){
+				cells[20] = nible_digit[(data >> 12) & 0x0F];
+				cells[21] = nible_digit[(data >>  8) & 0x0F];
+				attrs[20] = attrs[21] = ATTR_COLOR_WHITE;
+			}
+			cells[22] = nible_digit[(data >>  4) & 0x0F];
+			cells[23] = nible_digit[ data        & 0x0F];
+			attrs[22] = attrs[23] = ATTR_COLOR_WHITE;
+			if(reg_names){
+				reg_log_row(cells, attrs, addr);
+			}
+			shadow_write_row(cells, attrs, UI_log_used_LEN, (curr_x ? 54 : 27), 2 + curr_y);
+		}else{
+			shadow_write_cells(&ui_cells[UI_log_empty], UI_log_empty_LEN, attr, (curr_x ? 54 : 27), 2 + curr_y);
+		}
+	}
+	disp_log_status();
+	reg_draw_line();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ログのページを切り替える
+* @param[in] 0=新しい方へ 1=古い方へ 2=最新へ
+* @param[out] 無し
+* @return 無し
+* @details 保持しているログより古いページには行かない。
+*/
+void log_page(uint8_t direction){
+	switch(direction){
+	case 0:
+		if(log_scroll) log_scroll--;
+		break;
+	case 1:
+		if(((uint32_t)(log_scroll + 1) * LOG_PAGE) < log_retained()) log_scroll++;
+		break;
+	default:
+		log_scroll = 0;
+		break;
+	}
+	disp_log();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief IOポート読み書きをログに残す。
+* @param[in] 読み書き、8/16、アドレス、データ
+* @param[out] 無し
+* @return 無し
+* @details 残すのはR/W、8/16、アドレス、データ。LOG_CAPACITY件を超えたら古いものから上書きする。
+* @details 過去のページを表示中でも最新のページに戻す。
+* @details タイムスタンプもあったほうがいい？
+*/
+void logger(uint8_t r_w, uint8_t b_w, uint16_t addr, uint16_t data){
+	st_logcell __far *log = log_cell(log_total);
+
+	log->flags = (r_w ? LOG_FLAG_WRITE : 0) | (b_w ? LOG_FLAG_16BIT : 0);
+	log->addr  = addr;
+	log->data  = data;
+	log_total++;
+	log_scroll = 0;
+	if(log_visible){
+		disp_log();
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 記録用のファーメモリを確保する
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=成功 0=メモリが足りない
+* @details REC_MAX件分を1セグメントに確保する。
+*/
+uint8_t rec_init(){
+	if(rec_seg == 0){
+		rec_seg = hal_far_alloc((uint16_t)(((uint32_t)REC_MAX * sizeof(st_trace_rec) + 15) >> 4));
+	}
+	return (rec_seg != 0);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 記録の件数を表示する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details メイン画面の左下。記録中は赤で点滅させる。
+*/
+void rec_status(){
+	uint8_t line[16];
+
+	if(rec_active){
+		sprintf((char *)line, "REC %5u件", rec_reads + rec_writes);
+		VRAM_print(line, (ATTR_COLOR_RED | ATTR_BLINK), 2, 21);
+	}else if(rec_reads + rec_writes){
+		sprintf((char *)line, "記録%5u件", rec_reads + rec_writes);
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 21);
+	}else{
+		clear_area(ATTR_COLOR_WHITE, 2, 21, 11, 1);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 記録を始める
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 前の記録は捨てる。操作の間隔はスケジューラの時計(sched_clock())で測る。
+*/
+void rec_start(){
+	if(!rec_init()){
+		return;
+	}
+	rec_stamp  = 0;
+	rec_span   = 0;
+	rec_count  = 0;
+	rec_reads  = 0;
+	rec_writes = 0;
+	rec_active = 1;
+	replay_result = REPLAY_NONE;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 記録を終える
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void rec_stop(){
+	rec_active = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 記録にレコードを1件足す
+* @param[in] 属性、アドレス、データ、前のレコードからの間隔
+* @param[out] 無し
+* @return 1=成功 0=一杯
+* @details
+*/
+uint8_t rec_store(uint8_t flags, uint16_t addr, uint16_t data, uint16_t delta){
+	if(rec_count >= REC_MAX){
+		return 0;
+	}
+
+	st_trace_rec __far *rec = (st_trace_rec __far *)MK_FP(rec_seg, rec_count * sizeof(st_trace_rec));
+	rec->flags = flags;
+	rec->addr  = addr;
+	rec->data  = data;
+	rec->delta = delta;
+	rec_count++;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 読み書きを1件記録する
+* @param[in] 読み書き、8/16、アドレス、データ
+* @param[out] 無し
+* @return 無し
+* @details 記録中でなければ何もしない。ポートを操作する直前（読み込みは直後）に呼ぶ。
+* @details 間隔が16ビットに収まらなければ先にTRACE_FLAG_SKIPのレコードを置く。一杯になったら記録を止める。
+*/
+void rec_put(uint8_t r_w, uint8_t b_w, uint16_t addr, uint16_t data){
+	if(!rec_active){
+		return;
+	}
+	uint32_t now   = sched_clock();
+	uint32_t delta = now - rec_stamp;
+	if(((rec_reads + rec_writes) == 0) || (delta & 0x80000000UL)){
+		delta = 0;								//記録開始から最初の操作までと、時計の読み違いは数えない
+	}else{
+		rec_span += delta;
+	}
+	rec_stamp = now;
+
+	if((delta > 0xFFFF) && !rec_store(TRACE_FLAG_SKIP, (uint16_t)(delta >> 16), (uint16_t)delta, 0)){
+		rec_stop();
+	}else if(!rec_store((r_w ? TRACE_FLAG_WRITE : 0) | (b_w ? TRACE_FLAG_16BIT : 0), addr, data, ((delta > 0xFFFF) ? 0 : (uint16_t)delta))){
+		rec_stop();
+	}else{
+		(r_w ? rec_writes++ : rec_reads++);
+	}
+	if(log_visible){
+		rec_status();
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 16ビット読み込み
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details IOポートから16ビットのデータを読み込む。アドレスとデータは読み込み後にログに残す。
+*/
+void io_read_16bit(){
+	uint16_t value = port_in16(addr_digit);
+	rec_put(0,1,addr_digit, value);
+	logger(0,1,addr_digit, value);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 16ビット書き込み
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details IOポートに16ビットのデータを書き込む。アドレスとデータは書き込み前にログに残す。
+*/
+void io_write_16bit(){
+	logger(1,1,addr_digit, word_digit);
+	rec_put(1,1,addr_digit, word_digit);
+	port_out16(addr_digit, word_digit);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 8ビット読み込み
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details IOポートから８ビットのデータを読み込む。アドレスとデータは読み込み後にログに残す。
+*/
+void io_read_8bit(){
+	uint8_t value = port_in8(addr_digit);
+	rec_put(0,0,addr_digit, value);
+	logger(0,0,addr_digit, value);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 8ビット書き込み
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details IOポートに８ビットのデータを書き込む。アドレスとデータは書き込み前にログに残す。
+*/
+void io_write_8bit(){
+	logger(1,0,addr_digit, byte_digit);
+	rec_put(1,0,addr_digit, byte_digit);
+	port_out8(addr_digit, byte_digit);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 数値の再描画
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details アドレスと、書き込み用の数値、およびカーソルを再描画する。
+*/
+void redraw_digit(){
+	VRAM_print_word(word_str(addr_digit), ATTR_COLOR_WHITE, 18, 1);
+	VRAM_print_word(word_str(word_digit), ATTR_COLOR_WHITE, 18, 3);
+	VRAM_print_byte(byte_str(byte_digit), ATTR_COLOR_WHITE, 20, 5);
+
+	shadow_set_attr((ATTR_COLOR_YELLOW | ATTR_REVERSE), (cursol_x + ((cursol_y == 2) ? 20 : 18)), ((cursol_y * 2) + 1));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief カーソル位置の数値を1つ上げる。
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details カーソル位置の数値を1つ上げる。桁の繰り上がりもする。
+*/
+void value_up(){
+	switch(cursol_y){
+	case 0:
+		addr_digit += (0x0001 << ((3-cursol_x) * 4));
+		break;
+	case 1:
+		word_digit += (0x0001 << ((3-cursol_x) * 4));
+		break;
+	case 2:
+		byte_digit += (0x01   << ((1-cursol_x) * 4));
+		break;
+	}
+	redraw_digit();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief カーソル位置の数値を1つ下げる。
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details カーソル位置の数値を1つ下げる。桁の繰り下がりもする。
+*/
+void value_down(){
+	switch(cursol_y){
+	case 0:
+		addr_digit -= (0x0001 << ((3-cursol_x) * 4));
+		break;
+	case 1:
+		word_digit -= (0x0001 << ((3-cursol_x) * 4));
+		break;
+	case 2:
+		byte_digit -= (0x01   << ((1-cursol_x) * 4));
+		break;
+	}
+	redraw_digit();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief カーソル上移動
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details カーソルを上に移動する。行き過ぎるとループする
+*/
+void cursol_up(){
+	if(--cursol_y > 2){
+		cursol_y = 2;
+	}
+	if(cursol_y == 2){
+		cursol_x &= 1;
+	}
+	redraw_digit();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief カーソル左移動
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details カーソルを左に移動する。行き過ぎるとループする
+*/
+void cursol_left(){
+	--cursol_x;
+	cursol_x &= 0x03;
+	if(cursol_y == 2){
+		cursol_x &= 1;
+	}
+	redraw_digit();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief カーソル右移動
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details カーソルを右に移動する。行き過ぎるとループする
+*/
+void cursol_right(){
+	++cursol_x;
+	cursol_x &= 0x03;
+	if(cursol_y == 2){
+		cursol_x &= 1;
+	}
+	redraw_digit();
+}
+
+
+//-------------------------------------------------------------------------
+/**
+* @brief カーソル下移動
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details カーソルを下に移動する。行き過ぎるとループする
+*/
+void cursol_down(){
+	if(++cursol_y > 2){
+		cursol_y = 0;
+	}
+	if(cursol_y == 2){
+		cursol_x &= 1;
+	}
+	redraw_digit();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーをキューに入れる
+* @param[in] キーコード
+* @param[out] 無し
+* @return 無し
+* @details 今のシフト状態と一緒に入れる。一杯なら捨てる。
+*/
+void key_push(uint8_t code){
+	uint8_t next = (key_queue_head + 1) & (KEY_QUEUE - 1);
+
+	if(next == key_queue_tail){
+		return;
+	}
+	key_queue[key_queue_head] = ((uint16_t)key_shift_state << 8) | code;
+	key_queue_head = next;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 押し続けた時にリピートするキーか
+* @param[in] キーコード
+* @param[out] 無し
+* @return 1=リピートする 0=しない
+* @details カーソルキー、ROLL UP/DOWN、SPACE、RETURNだけ。ESCやファンクションキーはリピートしない。
+*/
+uint8_t key_repeats(uint8_t code){
+	switch(code){
+	case 0x1C: //RETURN
+	case 0x34: //SPACE
+	case 0x36: //ROLL UP
+	case 0x37: //ROLL DOWN
+	case 0x3A: //UP
+	case 0x3B: //LEFT
+	case 0x3C: //RIGHT
+	case 0x3D: //DOWN
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボード割り込みで受け取ったスキャンコードをキー入力に直す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details シフト系のキー(0x70～0x74)は状態を覚えるだけ。押したキーはキューに入れ、押し続けている間に
+* @details キーボードから届く同じキーの押下は捨てる。代わりにKEY_REPEAT_DELAY後から自前でリピートし、
+* @details 間隔はKEY_REPEAT_FIRSTから1回ごとにKEY_REPEAT_STEPずつ縮めてKEY_REPEAT_MINで止める。
+* @details 時間はスケジューラのtickで数えるので、PITを計測に使っている間はリピートしない。
+*/
+void key_fetch(){
+	uint16_t now = (uint16_t)hal_tick_count();
+	uint8_t  code;
+
+	while(hal_kb_get(&code)){
+		uint8_t key = code & ~KEY_CODE_BREAK;
+
+		if((key >= KEY_CODE_SHIFT) && (key <= KEY_CODE_CTRL)){
+			uint8_t bit = 1 << (key - KEY_CODE_SHIFT);
+			key_shift_state = ((code & KEY_CODE_BREAK) ? (key_shift_state & ~bit) : (key_shift_state | bit));
+		}else if(code & KEY_CODE_BREAK){
+			if(key == key_held){
+				key_held = KEY_HELD_NONE;
+			}
+		}else if(key != key_held){
+			key_push(key);
+			key_held       = key;
+			key_repeat_due = now + KEY_REPEAT_DELAY;
+			key_repeat_gap = KEY_REPEAT_FIRST;
+		}
+	}
+
+	if((key_held != KEY_HELD_NONE) && key_repeats(key_held) && ((int16_t)(now - key_repeat_due) >= 0)){
+		key_push(key_held);
+		key_repeat_due = now + key_repeat_gap;
+		key_repeat_gap = ((key_repeat_gap > (KEY_REPEAT_MIN + KEY_REPEAT_STEP)) ? (key_repeat_gap - KEY_REPEAT_STEP) : KEY_REPEAT_MIN);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キューからキーを1つ取り出す
+* @param[in] 無し
+* @param[out] キーコード、シフト状態
+* @return 1=取り出した 0=無い
+* @details
+*/
+uint8_t key_get(uint8_t *code, uint8_t *shift){
+	key_fetch();
+	if(key_queue_tail == key_queue_head){
+		return 0;
+	}
+	*code  = (uint8_t)key_queue[key_queue_tail];
+	*shift = (uint8_t)(key_queue[key_queue_tail] >> 8);
+	key_queue_tail = (key_queue_tail + 1) & (KEY_QUEUE - 1);
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 読んでいないキー入力があるか
+* @param[in] 無し
+* @param[out] 無し
+* @return 0=無い それ以外=ある
+* @details 計測中の中断の確認に使う。BIOS経由ならキーバッファの入力数(0000:0528)を見るだけ。
+*/
+uint8_t key_pending(){
+	if(key_direct){
+		key_fetch();
+		return (key_queue_tail != key_queue_head);
+	}
+	return *BIOS_KB_COUNT;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボードセンス＆読み込み
+* @param[in] 無し
+* @param[out] 無し
+* @return uint8_t 有効なキーコード、または０か１
+* @details 使用されるキー意外は無視される。
+* @details センスされるキーは以下。
+* @details 0x00, //ESC
+* @details 0x34, //SPC
+* @details 0x1C, //ENTER
+* @details 0x3A, //UP
+* @details 0x3B, //LEFT
+* @details 0x3C, //RIGHT
+* @details 0x3D, //DOWN
+* @details 0x36, //ROLL UP
+* @details 0x37, //ROLL DOWN
+* @details 0x3E, //HOME CLR
+* @details 0x62～0x6B, //f･1～f･10
+* @details シフトキー
+* @details -k で起動した時はBIOSを呼ばず、キーボード割り込みで受け取ったキーをkey_get()で取り出す。
+*/
+uint8_t kbread(){
+	uint8_t shift   = 0;
+	uint8_t keydata = 0;
+
+	if(key_direct){
+		if(!key_get(&keydata, &shift)){
+			return 1;
+		}
+	}else if(kb_sense()){ //入力あり
+		shift   = kb_shift();						//シフトキー状態の保存
+		keydata = kb_read();
+	}else{
+		return 1;
+	}
+
+	switch(keydata){
+	case 0x00: //ESC
+		keydata |= 0x80;
+		break;
+	case 0x1C: //RETURN
+		if(shift & 0x01) keydata |= 0x80;
+		break;
+	case 0x34: //SPACE
+		if(shift & 0x01) keydata |= 0x80;
+		break;
+	case 0x3A: //UP
+		if(shift & 0x01) keydata |= 0x80;
+		break;
+	case 0x3B: //LEFT
+		break;
+	case 0x3C: //RIGHT
+		break;
+	case 0x3D: //DOWN
+		if(shift & 0x01) keydata |= 0x80;
+		break;
+	case 0x36: //ROLL UP
+		break;
+	case 0x37: //ROLL DOWN
+		break;
+	case 0x3E: //HOME CLR
+		break;
+	case 0x62: //f･1
+	case 0x63: //f･2
+	case 0x64: //f･3
+	case 0x65: //f･4
+	case 0x66: //f･5
+	case 0x67: //f･6
+	case 0x68: //f･7
+	case 0x69: //f･8
+	case 0x6A: //f･9
+	case 0x6B: //f･10
+		if(shift & 0x01) keydata |= 0x80;
+		break;
+	default:
+		return 0;
+	}
+	return keydata;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 8ビット連続読み込み
+* @param[in] ポート、格納先、回数
+* @param[out] 無し
+* @return 無し
+* @details V30/186以降はREP INSB、8086は8回展開したループで読む。
+*/
+void burst_in8(uint16_t port, uint8_t __far *buf, uint16_t count){
+	if(cpu_type != CPU_8086){
+		hal_ins8(port, buf, count);
+		return;
+	}
+
+	while(count >= 8){
+		buf[0] = port_in8(port);
+		buf[1] = port_in8(port);
+		buf[2] = port_in8(port);
+		buf[3] = port_in8(port);
+		buf[4] = port_in8(port);
+		buf[5] = port_in8(port);
+		buf[6] = port_in8(port);
+		buf[7] = port_in8(port);
+		buf   += 8;
+		count -= 8;
+	}
+	while(count--){
+		*buf++ = port_in8(port);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 16ビット連続読み込み
+* @param[in] ポート、格納先、回数
+* @param[out] 無し
+* @return 無し
+* @details V30/186以降はREP INSW、8086は8回展開したループで読む。
+*/
+void burst_in16(uint16_t port, uint16_t __far *buf, uint16_t count){
+	if(cpu_type != CPU_8086){
+		hal_ins16(port, buf, count);
+		return;
+	}
+
+	while(count >= 8){
+		buf[0] = port_in16(port);
+		buf[1] = port_in16(port);
+		buf[2] = port_in16(port);
+		buf[3] = port_in16(port);
+		buf[4] = port_in16(port);
+		buf[5] = port_in16(port);
+		buf[6] = port_in16(port);
+		buf[7] = port_in16(port);
+		buf   += 8;
+		count -= 8;
+	}
+	while(count--){
+		*buf++ = port_in16(port);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 8ビット連続書き込み
+* @param[in] ポート、書き込むデータ、回数
+* @param[out] 無し
+* @return 無し
+* @details V30/186以降はREP OUTSB、8086は8回展開したループで書く。
+*/
+void burst_out8(uint16_t port, uint8_t __far *buf, uint16_t count){
+	if(cpu_type != CPU_8086){
+		hal_outs8(port, buf, count);
+		return;
+	}
+
+	while(count >= 8){
+		port_out8(port, buf[0]);
+		port_out8(port, buf[1]);
+		port_out8(port, buf[2]);
+		port_out8(port, buf[3]);
+		port_out8(port, buf[4]);
+		port_out8(port, buf[5]);
+		port_out8(port, buf[6]);
+		port_out8(port, buf[7]);
+		buf   += 8;
+		count -= 8;
+	}
+	while(count--){
+		port_out8(port, *buf++);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 16ビット連続書き込み
+* @param[in] ポート、書き込むデータ、回数
+* @param[out] 無し
+* @return 無し
+* @details V30/186以降はREP OUTSW、8086は8回展開したループで書く。
+*/
+void burst_out16(uint16_t port, uint16_t __far *buf, uint16_t count){
+	if(cpu_type != CPU_8086){
+		hal_outs16(port, buf, count);
+		return;
+	}
+
+	while(count >= 8){
+		port_out16(port, buf[0]);
+		port_out16(port, buf[1]);
+		port_out16(port, buf[2]);
+		port_out16(port, buf[3]);
+		port_out16(port, buf[4]);
+		port_out16(port, buf[5]);
+		port_out16(port, buf[6]);
+		port_out16(port, buf[7]);
+		buf   += 8;
+		count -= 8;
+	}
+	while(count--){
+		port_out16(port, *buf++);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief バースト転送を実行する
+* @param[in] 0=Read 1=Write
+* @param[out] 無し
+* @return 無し
+* @details addr_digitに対してburst_count回、burst_width幅で転送し、経過時間を計る。
+* @details PITが一周しないよう、BURST_CHUNK回ごとに経過時間を読む。ログには最後の値を1件だけ残す。
+*/
+void burst_run(uint8_t r_w){
+	uint8_t  step   = (burst_width ? 2 : 1);
+	uint16_t remain = burst_count;
+	uint16_t offset = 0;
+
+	pit_start();
+	while(remain){
+		uint16_t n = ((remain > BURST_CHUNK) ? BURST_CHUNK : remain);
+		void __far *buf = MK_FP(burst_seg, offset);
+
+		switch((r_w << 1) | burst_width){
+		case 0:
+			burst_in8(addr_digit, (uint8_t __far *)buf, n);
+			break;
+		case 1:
+			burst_in16(addr_digit, (uint16_t __far *)buf, n);
+			break;
+		case 2:
+			burst_out8(addr_digit, (uint8_t __far *)buf, n);
+			break;
+		case 3:
+			burst_out16(addr_digit, (uint16_t __far *)buf, n);
+			break;
+		}
+		pit_elapsed();
+		offset += (n * step);
+		remain -= n;
+	}
+	burst_ticks = pit_elapsed();
+	pit_stop();
+
+	burst_done_rw    = r_w;
+	burst_done_width = burst_width;
+	burst_done_count = burst_count;
+
+	uint16_t last = ((burst_count - 1) * step);
+	if(burst_width){
+		logger(r_w, 1, addr_digit, *(uint16_t __far *)MK_FP(burst_seg, last));
+	}else{
+		logger(r_w, 0, addr_digit, *(uint8_t __far *)MK_FP(burst_seg, last));
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief バーストバッファを書き込み用の値で埋める
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 16ビットの書き込み用数値で埋める。
+*/
+void burst_fill(){
+	uint16_t __far *buf = (uint16_t __far *)MK_FP(burst_seg, 0);
+
+	for(uint16_t index = 0; index < (uint16_t)(BURST_BUF_SIZE / 2); index++){
+		buf[index] = word_digit;
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief バースト画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 設定、前回の結果、バッファの16進ダンプを表示する。
+*/
+void burst_draw(){
+	uint8_t line[80];
+
+	VRAM_print("ポート: 0x",       ATTR_COLOR_WHITE, 2, 1);
+	VRAM_print_word(word_str(addr_digit),  ATTR_COLOR_WHITE, 12, 1);
+	VRAM_print("転送数:",          ATTR_COLOR_WHITE, 18, 1);
+	VRAM_print_word(word_str(burst_count), ATTR_COLOR_WHITE, 26, 1);
+	VRAM_print("幅:",              ATTR_COLOR_WHITE, 32, 1);
+	VRAM_print((burst_width ? "16bit" : " 8bit"), ATTR_COLOR_WHITE, 36, 1);
+	VRAM_print("CPU:",             ATTR_COLOR_WHITE, 43, 1);
+	VRAM_print(cpu_name[cpu_type], ATTR_COLOR_WHITE, 48, 1);
+	VRAM_print("方式:",            ATTR_COLOR_WHITE, 54, 1);
+	VRAM_print(((cpu_type != CPU_8086) ? "REP INS/OUTS" : "LOOP x8     "), ATTR_COLOR_WHITE, 60, 1);
+
+	if(burst_seg == 0){
+		VRAM_print("バッファを確保できません", ATTR_COLOR_RED, 2, 3);
+		return;
+	}
+
+	if(burst_done_count){
+		sprintf((char *)line, "結果: %c %2dbit %5u回 %8luus %8lu回/秒",
+			(burst_done_rw ? 'W' : 'R'), (burst_done_width ? 16 : 8), burst_done_count,
+			(unsigned long)pit_to_us(burst_ticks), (unsigned long)pit_rate(burst_done_count, burst_ticks));
+		VRAM_print(line, ATTR_COLOR_YELLOW, 2, 2);
+	}
+
+	uint8_t  __far *buf   = (uint8_t __far *)MK_FP(burst_seg, 0);
+	uint32_t        bytes = (uint32_t)burst_count << burst_width;
+	uint16_t        rows  = (uint16_t)((bytes + 15) / 16);
+	if((burst_top + BURST_VIEW_ROWS) > rows){
+		burst_top = ((rows > BURST_VIEW_ROWS) ? (rows - BURST_VIEW_ROWS) : 0);
+	}
+	for(uint16_t row = 0; row < BURST_VIEW_ROWS; row++){
+		uint32_t offset = (uint32_t)(burst_top + row) * 16;
+		clear_area(ATTR_COLOR_WHITE, 2, 4 + row, 54, 1);
+		if(offset >= bytes){
+			continue;
+		}
+		VRAM_print_word(word_str((uint16_t)offset), ATTR_COLOR_SKY, 2, 4 + row);
+		for(uint8_t col = 0; (col < 16) && ((offset + col) < bytes); col += (1 << burst_width)){
+			if(burst_width){
+				VRAM_print_word(word_str(*(uint16_t __far *)(buf + (uint16_t)offset + col)), ATTR_COLOR_WHITE, 8 + ((col / 2) * 5), 4 + row);
+			}else{
+				VRAM_print_byte(byte_str(buf[(uint16_t)offset + col]), ATTR_COLOR_WHITE, 8 + (col * 3), 4 + row);
+			}
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief バースト画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details addr_digitに対してまとめて読み書きし、結果を16進ダンプで表示する。
+* @details 書き込みはバッファの内容をそのまま出力する。バッファは確保時とSHIFT+f･1でword_digitで埋める。
+*/
+void burst_mode(){
+	if(burst_seg == 0){
+		burst_seg = hal_far_alloc((uint16_t)(BURST_BUF_SIZE >> 4));
+		if(burst_seg){
+			burst_fill();
+		}
+	}
+
+	draw_sub_frame(" BURST I/O ");
+	VRAM_print("[SPC]読込 [S+SPC]書込 [RET]幅 [S+f1]埋め [S+↑↓]数 [↑↓ROLL]表示 [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	burst_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint16_t rows = (uint16_t)((((uint32_t)burst_count << burst_width) + 15) / 16);
+		uint8_t  redraw = 1;
+
+		switch(kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x34: //SPACE
+			if(burst_seg) burst_run(0);
+			break;
+		case 0xB4: //SHIFT + SPACE
+			if(burst_seg) burst_run(1);
+			break;
+		case 0xE2: //SHIFT + f･1
+			if(burst_seg) burst_fill();
+			break;
+		case 0x1C: //RETURN
+			burst_width ^= 1;
+			break;
+		case 0xBA: //SHIFT + UP
+			if(burst_count < BURST_MAX){
+				burst_count <<= 1;
+			}
+			break;
+		case 0xBD: //SHIFT + DOWN
+			if(burst_count > 1){
+				burst_count >>= 1;
+			}
+			break;
+		case 0x3A: //UP
+			if(burst_top) burst_top--;
+			break;
+		case 0x3D: //DOWN
+			if((burst_top + BURST_VIEW_ROWS) < rows) burst_top++;
+			break;
+		case 0x37: //ROLL DOWN
+			burst_top = ((burst_top > BURST_VIEW_ROWS) ? (burst_top - BURST_VIEW_ROWS) : 0);
+			break;
+		case 0x36: //ROLL UP
+			if((burst_top + (BURST_VIEW_ROWS * 2)) < rows){
+				burst_top += BURST_VIEW_ROWS;
+			}else{
+				burst_top = ((rows > BURST_VIEW_ROWS) ? (rows - BURST_VIEW_ROWS) : 0);
+			}
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			burst_draw();
+			screen_flush();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief パターンの値を1つ作る
+* @param[in] 転送の番号
+* @param[out] LFSRの状態（PAT_LFSRの時に1つ進める）
+* @return 値（幅のマスクは呼ぶ側でかける）
+* @details ウォーキングは番号を幅のビット数で割った余りのビットを立てる（落とす）。
+*/
+uint16_t pat_value(uint16_t number, uint16_t *lfsr){
+	uint8_t bits = (pat_width ? 16 : 8);
+
+	switch(pat_kind){
+	case PAT_WALK1:
+		return (uint16_t)(1U << (number % bits));
+	case PAT_WALK0:
+		return (uint16_t)~(1U << (number % bits));
+	case PAT_RAMP:
+		return number;
+	case PAT_LFSR:
+		*lfsr = ((*lfsr & 1) ? ((*lfsr >> 1) ^ PAT_LFSR_TAPS) : (*lfsr >> 1));
+		return *lfsr;
+	default:
+		return (pat_width ? word_digit : byte_digit);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief パターンを書いて読み戻す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details addr_digitからpat_stride間隔でpat_ports個のポートを順に回し、pat_count回、書いた直後に同じポートを読んで比べる。
+* @details 時間はPITで計り、PAT_CHUNK回ごとに経過時間を読む。不一致は最初のPAT_MISS_MAX件を覚え、
+* @details 計測が終わってから最初のPAT_LOG_MAX件を書込と読込の組でI/Oログに残す。
+*/
+void pat_run(){
+	uint16_t mask = (pat_width ? 0xFFFF : 0x00FF);
+	uint16_t lfsr = PAT_LFSR_SEED;
+	uint16_t slot = 0;
+
+	pat_misses = 0;
+	pit_start();
+	for(uint16_t number = 0; number < pat_count; number++){
+		uint16_t port  = addr_digit + (slot * pat_stride);
+		uint16_t value = pat_value(number, &lfsr) & mask;
+		uint16_t actual;
+
+		if(pat_width){
+			port_out16(port, value);
+			actual = port_in16(port);
+		}else{
+			port_out8(port, (uint8_t)value);
+			actual = port_in8(port);
+		}
+		if(actual != value){
+			if(pat_misses < PAT_MISS_MAX){
+				pat_miss[pat_misses].number = number;
+				pat_miss[pat_misses].addr   = port;
+				pat_miss[pat_misses].expect = value;
+				pat_miss[pat_misses].actual = actual;
+			}
+			pat_misses++;
+		}
+		if(++slot >= pat_ports){
+			slot = 0;
+		}
+		if((number % PAT_CHUNK) == (PAT_CHUNK - 1)){
+			pit_elapsed();
+		}
+	}
+	pat_ticks = pit_elapsed();
+	pit_stop();
+
+	pat_done_count = pat_count;
+	pat_done_kind  = pat_kind;
+	pat_done_width = pat_width;
+	for(uint8_t index = 0; (index < pat_misses) && (index < PAT_LOG_MAX); index++){
+		logger(1, pat_width, pat_miss[index].addr, pat_miss[index].expect);
+		logger(0, pat_width, pat_miss[index].addr, pat_miss[index].actual);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief パターン画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 設定、前回の結果、不一致の一覧を表示する。
+*/
+void pat_draw(){
+	uint8_t line[80];
+
+	sprintf((char *)line, "ポート: 0x%04X～0x%04X 間隔:%u 幅:%2ubit 転送数:%5u",
+		addr_digit, (uint16_t)(addr_digit + ((pat_ports - 1) * pat_stride)), pat_stride, (pat_width ? 16 : 8), pat_count);
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 1);
+	VRAM_print("パターン:", ATTR_COLOR_WHITE, 2, 2);
+	VRAM_print(pat_name[pat_kind], ATTR_COLOR_YELLOW, 12, 2);
+	if(pat_kind == PAT_CONST){
+		sprintf((char *)line, "(0x%0*X)", (pat_width ? 4 : 2), (pat_width ? word_digit : byte_digit));
+		VRAM_print(line, ATTR_COLOR_WHITE, 22, 2);
+	}else{
+		clear_area(ATTR_COLOR_WHITE, 22, 2, 8, 1);
+	}
+	if(pat_done_count == 0){
+		return;
+	}
+
+	sprintf((char *)line, "結果: %s %2ubit %5u組 不一致:%5u 時間:%8luus %8lu組/秒",
+		pat_name[pat_done_kind], (pat_done_width ? 16 : 8), pat_done_count, pat_misses,
+		(unsigned long)pit_to_us(pat_ticks), (unsigned long)pit_rate(pat_done_count, pat_ticks));
+	VRAM_print(line, (pat_misses ? ATTR_COLOR_RED : ATTR_COLOR_YELLOW), 2, 4);
+
+	VRAM_print("   No.  ADDR  書込  読戻  差bit", (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 2, 6);
+	for(uint8_t row = 0; row < PAT_MISS_MAX; row++){
+		clear_area(ATTR_COLOR_WHITE, 2, 7 + row, 40, 1);
+		if(row >= pat_misses){
+			continue;
+		}
+		st_miss *miss = &pat_miss[row];
+		sprintf((char *)line, "%6u  %04X  %04X  %04X  %04X", miss->number, miss->addr, miss->expect, miss->actual, (miss->expect ^ miss->actual));
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 7 + row);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief パターン画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details addr_digitからのポート範囲に作ったパターンを書き、1回ごとに読み戻して確かめる。
+* @details I/Oの窓から見えるボード上のRAMの確認用。一定値は書込用の数値（word_digit/byte_digit）を使う。
+*/
+void pat_mode(){
+	draw_sub_frame(" PATTERN ");
+	VRAM_print("[SPC]実行 [←→]種類 [RET]幅 [HOME]間隔 [↑↓]範囲 [S+↑↓]転送数 [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	pat_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint8_t redraw = 1;
+
+		switch(kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x34: //SPACE
+			VRAM_print("実行中...", (ATTR_COLOR_RED | ATTR_BLINK), 60, 2);
+			screen_flush();
+			pat_run();
+			clear_area(ATTR_COLOR_WHITE, 60, 2, 10, 1);
+			break;
+		case 0x3B: //LEFT
+			pat_kind = ((pat_kind == 0) ? (PAT_KINDS - 1) : (pat_kind - 1));
+			break;
+		case 0x3C: //RIGHT
+			pat_kind = ((pat_kind + 1) % PAT_KINDS);
+			break;
+		case 0x1C: //RETURN
+			pat_width ^= 1;
+			break;
+		case 0x3E: //HOME CLR
+			pat_stride = ((pat_stride == 1) ? 2 : 1);
+			break;
+		case 0x3A: //UP
+			if(pat_ports < PAT_PORTS_MAX){
+				pat_ports <<= 1;
+			}
+			break;
+		case 0x3D: //DOWN
+			if(pat_ports > 1){
+				pat_ports >>= 1;
+			}
+			break;
+		case 0xBA: //SHIFT + UP
+			if(pat_count < PAT_MAX){
+				pat_count <<= 1;
+			}
+			break;
+		case 0xBD: //SHIFT + DOWN
+			if(pat_count > 1){
+				pat_count >>= 1;
+			}
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			pat_draw();
+			screen_flush();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 1種類のアクセスをSPEED_LOOPS回行う時間を計る
+* @param[in] 項目 SPEED_xxx、ポート、書き込む値
+* @param[out] 無し
+* @return 経過カウント（SPEED_PASSES回のうち最短）
+* @details ループは8回ずつ展開して、ループ自体の時間をなるべく小さくする。読んだ値は捨てる。
+* @details PITのカウンタが一周しないよう、SPEED_CHUNK回ごとに経過時間を読む。
+*/
+uint32_t speed_time(uint8_t kind, uint16_t port, uint16_t value){
+	uint32_t best = 0xFFFFFFFFUL;
+
+	for(uint8_t pass = 0; pass < SPEED_PASSES; pass++){
+		uint32_t start = pit_elapsed();
+
+		for(uint16_t block = SPEED_LOOPS / SPEED_CHUNK; block; block--){
+			switch(kind){
+			case SPEED_IN8:
+				for(uint16_t count = SPEED_CHUNK / 8; count; count--){
+					(void)port_in8(port); (void)port_in8(port); (void)port_in8(port); (void)port_in8(port);
+					(void)port_in8(port); (void)port_in8(port); (void)port_in8(port); (void)port_in8(port);
+				}
+				break;
+			case SPEED_IN16:
+				for(uint16_t count = SPEED_CHUNK / 8; count; count--){
+					(void)port_in16(port); (void)port_in16(port); (void)port_in16(port); (void)port_in16(port);
+					(void)port_in16(port); (void)port_in16(port); (void)port_in16(port); (void)port_in16(port);
+				}
+				break;
+			case SPEED_OUT8:
+				for(uint16_t count = SPEED_CHUNK / 8; count; count--){
+					port_out8(port, (uint8_t)value); port_out8(port, (uint8_t)value); port_out8(port, (uint8_t)value); port_out8(port, (uint8_t)value);
+					port_out8(port, (uint8_t)value); port_out8(port, (uint8_t)value); port_out8(port, (uint8_t)value); port_out8(port, (uint8_t)value);
+				}
+				break;
+			case SPEED_OUT16:
+				for(uint16_t count = SPEED_CHUNK / 8; count; count--){
+					port_out16(port, value); port_out16(port, value); port_out16(port, value); port_out16(port, value);
+					port_out16(port, value); port_out16(port, value); port_out16(port, value); port_out16(port, value);
+				}
+				break;
+			}
+			pit_elapsed();
+		}
+
+		uint32_t ticks = pit_elapsed() - start;
+		if(ticks < best){
+			best = ticks;
+		}
+	}
+	return best;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 速度を計測する
+* @param[in] 0=読込だけ 1=書込も
+* @param[out] 無し
+* @return 無し
+* @details addr_digitと基準のポートで、読込（と書込）の時間を計る。書き込む値は書込用の数値。
+* @details 基準のポートへの書込は、今の割り込みマスクをそのまま書き戻す8bitだけ行う。
+* @details 16bitで書くと隣の0x0003にも書いてしまうので行わない。
+*/
+void speed_run(uint8_t write){
+	memset(speed_ticks, 0, sizeof(speed_ticks));
+	speed_port = addr_digit;
+
+	pit_start();
+	speed_ticks[0][SPEED_IN8]  = speed_time(SPEED_IN8,  addr_digit, 0);
+	speed_ticks[0][SPEED_IN16] = speed_time(SPEED_IN16, addr_digit, 0);
+	speed_ticks[1][SPEED_IN8]  = speed_time(SPEED_IN8,  SPEED_REF_PORT, 0);
+	speed_ticks[1][SPEED_IN16] = speed_time(SPEED_IN16, SPEED_REF_PORT, 0);
+	if(write){
+		speed_ticks[0][SPEED_OUT8]  = speed_time(SPEED_OUT8,  addr_digit, byte_digit);
+		speed_ticks[0][SPEED_OUT16] = speed_time(SPEED_OUT16, addr_digit, word_digit);
+		speed_ticks[1][SPEED_OUT8]  = speed_time(SPEED_OUT8,  SPEED_REF_PORT, port_in8(SPEED_REF_PORT));
+	}
+	pit_stop();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 経過カウントを1回あたりの時間[0.1ns]にする
+* @param[in] SPEED_LOOPS回分の経過カウント
+* @param[out] 無し
+* @return 1回あたりの時間[0.1ns]
+* @details
+*/
+uint32_t speed_ns10(uint32_t ticks){
+	return (uint32_t)(((unsigned long long)ticks * 10000000000ULL) / ((unsigned long long)pit_clock * SPEED_LOOPS));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 速度計測画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 項目ごとに、計測したポートと基準のポートの1回あたりの時間と、その差（ボードの待ち）を表示する。
+*/
+void speed_draw(){
+	uint8_t line[80];
+
+	sprintf((char *)line, "ポート: 0x%04X  基準: 0x%04X(PIC)  回数:%5u x %u  CPU:%s",
+		addr_digit, SPEED_REF_PORT, SPEED_LOOPS, SPEED_PASSES, cpu_name[cpu_type]);
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 1);
+	sprintf((char *)line, "書込の値: 0x%02X / 0x%04X", byte_digit, word_digit);
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 2);
+
+	sprintf((char *)line, "                 0x%04X [ns]      回/秒   基準 [ns]    差 [ns]", speed_port);
+	VRAM_print(line, (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 2, 4);
+	for(uint8_t kind = 0; kind < SPEED_KINDS; kind++){
+		uint32_t ticks = speed_ticks[0][kind];
+		uint32_t ref   = speed_ticks[1][kind];
+
+		clear_area(ATTR_COLOR_WHITE, 2, 5 + kind, 70, 1);
+		VRAM_print(speed_name[kind], ATTR_COLOR_WHITE, 2, 5 + kind);
+		if(ticks == 0){
+			VRAM_print("----", ATTR_COLOR_WHITE, 23, 5 + kind);
+			continue;
+		}
+
+		uint32_t ns10 = speed_ns10(ticks);
+		sprintf((char *)line, "%8lu.%lu %10lu", (unsigned long)(ns10 / 10), (unsigned long)(ns10 % 10),
+			(unsigned long)pit_rate(SPEED_LOOPS, ticks));
+		VRAM_print(line, ATTR_COLOR_YELLOW, 17, 5 + kind);
+		if(ref == 0){
+			VRAM_print("       ----", ATTR_COLOR_WHITE, 47, 5 + kind);
+			continue;
+		}
+
+		uint32_t ref10 = speed_ns10(ref);
+		uint32_t diff  = ((ns10 > ref10) ? (ns10 - ref10) : (ref10 - ns10));
+		sprintf((char *)line, "%8lu.%lu %c%8lu.%lu", (unsigned long)(ref10 / 10), (unsigned long)(ref10 % 10),
+			((ns10 < ref10) ? '-' : '+'), (unsigned long)(diff / 10), (unsigned long)(diff % 10));
+		VRAM_print(line, ((ns10 > ref10) ? ATTR_COLOR_RED : ATTR_COLOR_WHITE), 47, 5 + kind);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 速度計測画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details addr_digitへのinp/inpw/outp/outpwを繰り返してPITで時間を計り、1回あたりの時間を本体内蔵の
+* @details 基準のポートと比べる。差が拡張ボードのウェイトを含むバスの余分な時間になる。
+*/
+void speed_mode(){
+	draw_sub_frame(" PORT SPEED ");
+	VRAM_print("[SPC]読込を計測 [S+SPC]書込も計測 [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	speed_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint8_t redraw = 1;
+		uint8_t key;
+
+		switch(key = kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x34: //SPACE
+		case 0xB4: //SHIFT + SPACE
+			VRAM_print("計測中...", (ATTR_COLOR_RED | ATTR_BLINK), 60, 2);
+			screen_flush();
+			speed_run(key == 0xB4);
+			clear_area(ATTR_COLOR_WHITE, 60, 2, 10, 1);
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			speed_draw();
+			screen_flush();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 表示するメモリを読み取る
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=前回表示した内容から変わった 0=同じ
+* @details mem_offを含む256バイトを1回のブロック転送(REP MOVSW)でニアのバッファに取る。
+* @details 読み取りが一瞬で終わるので、書き換わっている最中のメモリでも1時点の内容として揃って見える。
+*/
+uint8_t mem_snapshot(){
+	hal_copy_from_far(mem_view, (const uint16_t __far *)MK_FP(mem_seg, (mem_off & ~(MEM_VIEW_BYTES - 1))), MEM_VIEW_BYTES / 2);
+	return (memcmp(mem_view, mem_shown, sizeof(mem_view)) != 0);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief メモリ画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details アドレス欄と、読み取った256バイトの16進/ASCIIダンプを表示する。mem_offの1バイトを反転表示する。
+*/
+void mem_draw(){
+	uint8_t *bytes = (uint8_t *)mem_view;
+	uint16_t base  = mem_off & ~(MEM_VIEW_BYTES - 1);
+	uint8_t  line[80];
+
+	VRAM_print("アドレス:", ATTR_COLOR_WHITE, 2, 1);
+	sprintf((char *)line, "%04X:%04X", mem_seg, mem_off);
+	VRAM_print(line, ATTR_COLOR_WHITE, 12, 1);
+	shadow_set_attr((ATTR_COLOR_YELLOW | ATTR_REVERSE), 12 + mem_cursol + (mem_cursol >> 2), 1);
+	sprintf((char *)line, "書込の値: 0x%02X / 0x%04X  自動更新:%s", byte_digit, word_digit, (mem_auto ? "ON " : "OFF"));
+	VRAM_print(line, ATTR_COLOR_WHITE, 26, 1);
+
+	VRAM_print("          +0 +1 +2 +3 +4 +5 +6 +7 +8 +9 +A +B +C +D +E +F  0123456789ABCDEF", (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 2, 3);
+	for(uint8_t row = 0; row < MEM_VIEW_ROWS; row++){
+		uint8_t *src = &bytes[row * MEM_ROW_BYTES];
+		uint8_t *dst = line;
+
+		dst += sprintf((char *)dst, "%04X:%04X ", mem_seg, (uint16_t)(base + (row * MEM_ROW_BYTES)));
+		for(uint8_t col = 0; col < MEM_ROW_BYTES; col++){
+			dst += sprintf((char *)dst, " %02X", src[col]);
+		}
+		*dst++ = ' ';
+		*dst++ = ' ';
+		for(uint8_t col = 0; col < MEM_ROW_BYTES; col++){
+			*dst++ = (((src[col] >= 0x20) && (src[col] < 0x7F)) ? src[col] : '.');
+		}
+		*dst = 0;
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 4 + row);
+	}
+
+	uint8_t index = (uint8_t)(mem_off - base);
+	uint8_t row   = index / MEM_ROW_BYTES;
+	uint8_t col   = index % MEM_ROW_BYTES;
+	shadow_set_attr((ATTR_COLOR_YELLOW | ATTR_REVERSE), 13 + (col * 3), 4 + row);
+	shadow_set_attr((ATTR_COLOR_YELLOW | ATTR_REVERSE), 14 + (col * 3), 4 + row);
+	shadow_set_attr((ATTR_COLOR_YELLOW | ATTR_REVERSE), 61 + col, 4 + row);
+
+	memcpy(mem_shown, mem_view, sizeof(mem_shown));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief カーソル位置の桁を1つ上げ下げする
+* @param[in] 1=上げる 0=下げる
+* @param[out] 無し
+* @return 無し
+* @details 0～3はセグメント、4～7はオフセットの桁。桁の繰り上がりもする。
+*/
+void mem_digit(uint8_t up){
+	uint16_t step = (0x0001 << ((3 - (mem_cursol & 3)) * 4));
+
+	if(mem_cursol < 4){
+		mem_seg = (up ? (mem_seg + step) : (mem_seg - step));
+	}else{
+		mem_off = (up ? (mem_off + step) : (mem_off - step));
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief メモリ画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details セグメント:オフセットで指定したメモリを256バイトずつ表示する。C-busボードのROM/RAMの確認用。
+* @details 自動更新がONなら垂直帰線ごとに読み直し、変わった時だけ描き直す。
+* @details 書込はメイン画面と同じくSHIFT+SPACEで8bit、SHIFT+RETURNで16bit。値はメイン画面の書込用の数値。
+*/
+void mem_mode(){
+	draw_sub_frame(" MEMORY ");
+	VRAM_print("[←→]桁 [S+↑↓]値 [↑↓ROLL]移動 [S+SPC/RET]8/16書込 [SPC]自動 [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	mem_snapshot();
+	mem_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint8_t redraw = 1;
+
+		switch(kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x3B: //LEFT
+			mem_cursol = (mem_cursol - 1) & 7;
+			break;
+		case 0x3C: //RIGHT
+			mem_cursol = (mem_cursol + 1) & 7;
+			break;
+		case 0xBA: //SHIFT + UP
+			mem_digit(1);
+			break;
+		case 0xBD: //SHIFT + DOWN
+			mem_digit(0);
+			break;
+		case 0x3A: //UP
+			mem_off -= MEM_ROW_BYTES;
+			break;
+		case 0x3D: //DOWN
+			mem_off += MEM_ROW_BYTES;
+			break;
+		case 0x37: //ROLL DOWN
+			mem_off -= MEM_VIEW_BYTES;
+			break;
+		case 0x36: //ROLL UP
+			mem_off += MEM_VIEW_BYTES;
+			break;
+		case 0x34: //SPACE
+			mem_auto ^= 1;
+			break;
+		case 0xB4: //SHIFT + SPACE
+			*(uint8_t __far *)MK_FP(mem_seg, mem_off) = byte_digit;
+			break;
+		case 0x9C: //SHIFT + RETURN
+			*(uint16_t __far *)MK_FP(mem_seg, mem_off) = word_digit;
+			break;
+		case 0x01: //入力なし
+			redraw = 0;
+			if(mem_auto){
+				uint8_t vsync = port_in8(GDC_STATUS) & GDC_VSYNC;
+				if(vsync && !mem_vsync && mem_snapshot()){
+					mem_draw();
+					screen_copy();
+				}
+				mem_vsync = vsync;
+			}
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			mem_snapshot();
+			mem_draw();
+			screen_flush();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ポート範囲をファーバッファに読み込む
+* @param[in] 0=変化前の面 1=変化後の面
+* @param[out] 無し
+* @return 経過カウント
+* @details snap_baseからsnap_done_ports個のポートを8bitで順に読む。ポート数は2のべき乗で、
+* @details 65536個の時はオフセットが一周して0に戻ったところで終わる。
+*/
+uint32_t snap_read(uint8_t page){
+	uint8_t __far *dst  = (uint8_t __far *)MK_FP(snap_seg[page], 0);
+	uint16_t       port = snap_base;
+	uint16_t       end  = (uint16_t)snap_done_ports;
+	uint16_t       offset = 0;
+	uint32_t       ticks;
+
+	pit_start();
+	do{
+		dst[offset] = port_in8(port++);
+		if((offset % SNAP_CHUNK) == (SNAP_CHUNK - 1)){
+			pit_elapsed();
+		}
+	}while(++offset != end);
+	ticks = pit_elapsed();
+	pit_stop();
+	return ticks;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 変化したポートを一覧に加える
+* @param[in] 先頭からの番号
+* @param[out] 無し
+* @return 無し
+* @details 一覧に入るのは最初のSNAP_LIST_MAX件まで。数はすべて数える。
+*/
+void snap_note(uint16_t offset){
+	if(snap_diffs < SNAP_LIST_MAX){
+		snap_list[snap_diffs] = offset;
+	}
+	snap_diffs++;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 変化前と変化後を比べる
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 2つの面をワード単位でhal_far_compare()にかけ、違うワードが見つかった所だけ2バイトを調べる。
+* @details 変化が少なければほぼブロック比較(REPE CMPSW)の速さで終わる。PITはSNAP_CHUNKワードごとに読む。
+*/
+void snap_compare(){
+	const uint16_t __far *before = (const uint16_t __far *)MK_FP(snap_seg[0], 0);
+	const uint16_t __far *after  = (const uint16_t __far *)MK_FP(snap_seg[1], 0);
+	const uint8_t  __far *prev   = (const uint8_t __far *)before;
+	const uint8_t  __far *curr   = (const uint8_t __far *)after;
+	uint16_t words = (uint16_t)(snap_done_ports / 2);
+	uint16_t index = 0;
+
+	snap_diffs = 0;
+	snap_top   = 0;
+	pit_start();
+	while(index < words){
+		uint16_t end = (((words - index) > SNAP_CHUNK) ? (index + SNAP_CHUNK) : words);
+
+		while(index < end){
+			index += hal_far_compare(&before[index], &after[index], end - index);
+			if(index < end){
+				uint16_t offset = index * 2;
+
+				if(prev[offset] != curr[offset]){
+					snap_note(offset);
+				}
+				if(prev[offset + 1] != curr[offset + 1]){
+					snap_note(offset + 1);
+				}
+				index++;
+			}
+		}
+		pit_elapsed();
+	}
+	snap_cmp_ticks = pit_elapsed();
+	pit_stop();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief スナップショット画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 次に取る範囲、前回の結果、変化したポートの一覧（ポート: 変化前 > 変化後）を表示する。
+*/
+void snap_draw(){
+	const uint8_t __far *prev = (const uint8_t __far *)MK_FP(snap_seg[0], 0);
+	const uint8_t __far *curr = (const uint8_t __far *)MK_FP(snap_seg[1], 0);
+	uint16_t shown = (uint16_t)((snap_diffs < SNAP_LIST_MAX) ? snap_diffs : SNAP_LIST_MAX);
+	uint8_t  line[80];
+
+	sprintf((char *)line, "次に取る範囲: 0x%04X～0x%04X (%5luポート)",
+		addr_digit, (uint16_t)(addr_digit + snap_ports - 1), (unsigned long)snap_ports);
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 1);
+
+	clear_area(ATTR_COLOR_WHITE, 2, 2, 76, 1);
+	if(snap_seg[1] == 0){
+		VRAM_print("バッファを確保できません", ATTR_COLOR_RED, 2, 2);
+	}else if(snap_state == SNAP_NONE){
+		VRAM_print("[SPC]で変化前を取ってください", ATTR_COLOR_WHITE, 2, 2);
+	}else{
+		sprintf((char *)line, "取得済: 0x%04X～0x%04X 読込:%7luus",
+			snap_base, (uint16_t)(snap_base + snap_done_ports - 1), (unsigned long)pit_to_us(snap_read_ticks));
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 2);
+		if(snap_state == SNAP_COMPARED){
+			sprintf((char *)line, "比較:%7luus 変化:%5lu", (unsigned long)pit_to_us(snap_cmp_ticks), (unsigned long)snap_diffs);
+			VRAM_print(line, (snap_diffs ? ATTR_COLOR_YELLOW : ATTR_COLOR_GREEN), 44, 2);
+		}
+	}
+
+	VRAM_print("PORT  前 > 後      PORT  前 > 後      PORT  前 > 後      PORT  前 > 後", (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 2, 3);
+	for(uint8_t row = 0; row < SNAP_LIST_ROWS; row++){
+		clear_area(ATTR_COLOR_WHITE, 2, 4 + row, 76, 1);
+		if(snap_state != SNAP_COMPARED){
+			continue;
+		}
+		for(uint8_t col = 0; col < SNAP_LIST_COLS; col++){
+			uint16_t index = snap_top + (row * SNAP_LIST_COLS) + col;
+			if(index >= shown){
+				break;
+			}
+			uint16_t offset = snap_list[index];
+			sprintf((char *)line, "%04X: %02X > %02X", (uint16_t)(snap_base + offset), prev[offset], curr[offset]);
+			VRAM_print(line, ATTR_COLOR_WHITE, 2 + (col * 19), 4 + row);
+		}
+	}
+	if(snap_diffs > SNAP_LIST_MAX){
+		sprintf((char *)line, "（最初の%u件のみ表示）", SNAP_LIST_MAX);
+		VRAM_print(line, ATTR_COLOR_RED, 2, 21);
+	}else{
+		clear_area(ATTR_COLOR_WHITE, 2, 21, 40, 1);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 一覧の表示開始位置を動かす
+* @param[in] 動かす件数（負なら上へ）
+* @param[out] 無し
+* @return 無し
+* @details 一覧の範囲に収める。
+*/
+void snap_scroll(int16_t step){
+	uint16_t shown = (uint16_t)((snap_diffs < SNAP_LIST_MAX) ? snap_diffs : SNAP_LIST_MAX);
+	int16_t  top   = (int16_t)snap_top + step;
+	int16_t  last  = (int16_t)(((shown + SNAP_LIST_COLS - 1) / SNAP_LIST_COLS) - SNAP_LIST_ROWS) * SNAP_LIST_COLS;
+
+	if(top > last){
+		top = last;
+	}
+	if(top < 0){
+		top = 0;
+	}
+	snap_top = (uint16_t)top;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief スナップショット画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details addr_digitからのポート範囲を丸ごと読んで覚え、何か操作した後にもう一度読んで変わったポートだけを一覧にする。
+* @details 操作はメイン画面に戻ってしてよい。変化前は画面を出ても残る。RETURNを押すたびに変化前と比べ直す。
+*/
+void snap_mode(){
+	if(snap_seg[0] == 0){
+		snap_seg[0] = hal_far_alloc(0x1000);
+	}
+	if((snap_seg[0] != 0) && (snap_seg[1] == 0)){
+		snap_seg[1] = hal_far_alloc(0x1000);
+	}
+
+	draw_sub_frame(" SNAPSHOT ");
+	VRAM_print("[SPC]変化前 [RET]変化後と比較 [S+↑↓]ポート数 [↑↓ROLL]一覧 [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	snap_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint8_t redraw = 1;
+
+		switch(kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x34: //SPACE
+			if(snap_seg[1]){
+				snap_base       = addr_digit;
+				snap_done_ports = snap_ports;
+				snap_read_ticks = snap_read(0);
+				snap_state      = SNAP_BEFORE;
+				snap_diffs      = 0;
+				snap_top        = 0;
+			}
+			break;
+		case 0x1C: //RETURN
+			if(snap_state != SNAP_NONE){
+				snap_read_ticks = snap_read(1);
+				snap_compare();
+				snap_state = SNAP_COMPARED;
+			}
+			break;
+		case 0xBA: //SHIFT + UP
+			if(snap_ports < SNAP_PORTS_MAX){
+				snap_ports <<= 1;
+			}
+			break;
+		case 0xBD: //SHIFT + DOWN
+			if(snap_ports > 16){
+				snap_ports >>= 1;
+			}
+			break;
+		case 0x3A: //UP
+			snap_scroll(-SNAP_LIST_COLS);
+			break;
+		case 0x3D: //DOWN
+			snap_scroll(SNAP_LIST_COLS);
+			break;
+		case 0x37: //ROLL DOWN
+			snap_scroll(-(SNAP_LIST_COLS * SNAP_LIST_ROWS));
+			break;
+		case 0x36: //ROLL UP
+			snap_scroll(SNAP_LIST_COLS * SNAP_LIST_ROWS);
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			snap_draw();
+			screen_flush();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief チップのための待ちを入れる
+* @param[in] 回数
+* @param[out] 無し
+* @return 無し
+* @details IDX_WAIT_PORT(5Fh)への書き込みは1回約0.6usで、CPUの速さによらず同じ時間待てる。
+*/
+void idx_wait(uint8_t count){
+	while(count--){
+		port_out8(IDX_WAIT_PORT, 0);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief インデックスを指定してレジスタを読む
+* @param[in] レジスタ番号
+* @param[out] 無し
+* @return 値
+* @details インデックスポートに番号を書き、idx_wait_addr分待ってからデータポートを読む。記録には残さない。
+*/
+uint8_t idx_read(uint8_t index){
+	uint16_t data_port = idx_port + IDX_DATA_GAP;
+	uint8_t  value;
+
+	port_out8(idx_port, index);
+	idx_wait(idx_wait_addr);
+	value = port_in8(data_port);
+	return value;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief インデックスを指定してレジスタに書く
+* @param[in] レジスタ番号、値
+* @param[out] 無し
+* @return 無し
+* @details インデックスを書いてidx_wait_addr分、データを書いてidx_wait_data分待つ。記録中なら記録に残す。
+*/
+void idx_write(uint8_t index, uint8_t value){
+	uint16_t data_port = idx_port + IDX_DATA_GAP;
+
+	rec_put(1, 0, idx_port, index);
+	rec_put(1, 0, data_port, value);
+	port_out8(idx_port, index);
+	idx_wait(idx_wait_addr);
+	port_out8(data_port, value);
+	idx_wait(idx_wait_data);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 全レジスタを一括で読む
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 0～255番を順に読み、前回と反対側の面に格納する。ログにも記録にも残さない。時間はPITで計る。
+*/
+void idx_dump(){
+	uint8_t *dst;
+
+	idx_page ^= 1;
+	dst = idx_regs[idx_page];
+	pit_start();
+	for(uint16_t index = 0; index < IDX_REGS; index++){
+		dst[index] = idx_read((uint8_t)index);
+		if((index & 0x0F) == 0x0F){
+			pit_elapsed();
+		}
+	}
+	idx_ticks = pit_elapsed();
+	pit_stop();
+	idx_dumps++;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief インデックス画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 16x16の表で全レジスタの値を表示する。前回の一括読込から変わった値は黄色、カーソルは反転表示。
+* @details 待ちはROLLで変える方を反転表示する。
+*/
+void idx_draw(){
+	const st_reg *reg  = reg_find(idx_port);
+	uint8_t      *curr = idx_regs[idx_page];
+	uint8_t      *prev = idx_regs[idx_page ^ 1];
+	uint8_t       line[80];
+
+	sprintf((char *)line, "INDEX:0x%04X DATA:0x%04X %-*s 書込値:0x%02X 待ち:",
+		idx_port, (uint16_t)(idx_port + IDX_DATA_GAP), REG_NAME_LEN, (reg ? reg->name : ""), byte_digit);
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 1);
+	sprintf((char *)line, "%3u", idx_wait_addr);
+	VRAM_print(line, (idx_wait_sel ? ATTR_COLOR_WHITE : (ATTR_COLOR_YELLOW | ATTR_REVERSE)), 55, 1);
+	sprintf((char *)line, "%3u", idx_wait_data);
+	VRAM_print(line, (idx_wait_sel ? (ATTR_COLOR_YELLOW | ATTR_REVERSE) : ATTR_COLOR_WHITE), 59, 1);
+	VRAM_print("/", ATTR_COLOR_WHITE, 58, 1);
+	VRAM_print("回", ATTR_COLOR_WHITE, 62, 1);
+	if(idx_dumps){
+		sprintf((char *)line, "一括読込:%5lu回 %6luus", (unsigned long)idx_dumps, (unsigned long)pit_to_us(idx_ticks));
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 2);
+	}
+	sprintf((char *)line, "REG 0x%02X = 0x%02X", idx_cursol, curr[idx_cursol]);
+	VRAM_print(line, ATTR_COLOR_YELLOW, 58, 2);
+
+	for(uint8_t col = 0; col < 16; col++){
+		VRAM_print_byte(byte_str(col), ATTR_COLOR_SKY, 9 + (col * 3), 3);
+	}
+	for(uint8_t row = 0; row < 16; row++){
+		VRAM_print_byte(byte_str(row * 16), ATTR_COLOR_SKY, 3, 4 + row);
+		for(uint8_t col = 0; col < 16; col++){
+			uint8_t index = (row * 16) + col;
+			uint8_t attr  = (((idx_dumps > 1) && (curr[index] != prev[index])) ? ATTR_COLOR_YELLOW : ATTR_COLOR_WHITE);
+
+			if(index == idx_cursol){
+				attr |= ATTR_REVERSE;
+			}
+			VRAM_print_byte(byte_str(curr[index]), attr, 9 + (col * 3), 4 + row);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief インデックス画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details アドレス/データのポート対で操作するチップ（OPN/OPNAなど）用。addr_digitをインデックスポートにする。
+* @details 一括読込は256個のレジスタを1回で読んで表にする。1個ずつの読み書きはメイン画面と同じくログに残す。
+*/
+void idx_mode(){
+	idx_port = addr_digit;
+	draw_sub_frame(" INDEXED ");
+	VRAM_print("[SPC]全読込 [RET]読込 [S+SPC]書込 [S+↑↓]値 [HOME/ROLL]待ち [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	idx_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint8_t  redraw = 1;
+		uint8_t *wait   = (idx_wait_sel ? &idx_wait_data : &idx_wait_addr);
+
+		switch(kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x3A: //UP
+			idx_cursol -= 16;
+			break;
+		case 0x3D: //DOWN
+			idx_cursol += 16;
+			break;
+		case 0x3B: //LEFT
+			idx_cursol--;
+			break;
+		case 0x3C: //RIGHT
+			idx_cursol++;
+			break;
+		case 0xBA: //SHIFT + UP
+			byte_digit++;
+			break;
+		case 0xBD: //SHIFT + DOWN
+			byte_digit--;
+			break;
+		case 0x34: //SPACE
+			idx_dump();
+			break;
+		case 0x1C: //RETURN
+			idx_regs[idx_page][idx_cursol] = idx_read(idx_cursol);
+			rec_put(1, 0, idx_port, idx_cursol);
+			rec_put(0, 0, idx_port + IDX_DATA_GAP, idx_regs[idx_page][idx_cursol]);
+			logger(1, 0, idx_port, idx_cursol);
+			logger(0, 0, idx_port + IDX_DATA_GAP, idx_regs[idx_page][idx_cursol]);
+			break;
+		case 0xB4: //SHIFT + SPACE
+			logger(1, 0, idx_port, idx_cursol);
+			logger(1, 0, idx_port + IDX_DATA_GAP, byte_digit);
+			idx_write(idx_cursol, byte_digit);
+			break;
+		case 0x3E: //HOME CLR
+			idx_wait_sel ^= 1;
+			break;
+		case 0x36: //ROLL UP
+			if(*wait < 255) (*wait)++;
+			break;
+		case 0x37: //ROLL DOWN
+			if(*wait > 0) (*wait)--;
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			idx_draw();
+			screen_flush();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込み監視の集計を0に戻す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 監視をかけ直して回数と記録も0から数え直す。区間の上限はここでPITのカウント数に直す。
+*/
+void irq_clear(){
+	hal_irq_unhook();
+	hal_irq_hook();
+	for(uint8_t bin = 0; bin < (IRQ_BINS - 1); bin++){
+		irq_bin_limit[bin] = (uint32_t)(((unsigned long long)irq_bin_us[bin] * pit_clock) / 1000000UL);
+	}
+	memset(irq_seen, 0, sizeof(irq_seen));
+	memset(irq_hist, 0, sizeof(irq_hist));
+	memset(irq_rate, 0, sizeof(irq_rate));
+	memset(irq_rate_base, 0, sizeof(irq_rate_base));
+	irq_start_tick   = hal_tick_count();
+	irq_refresh_tick = irq_start_tick;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みの記録を集計する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 記録の時刻をsched_clock()と同じPITのカウント数に直し、同じIRQの前回との間隔を分布に加える。
+* @details 割り込み処理は数えて時刻を書くだけなので、計算はすべてここで行う。
+*/
+void irq_drain(){
+	uint8_t  line;
+	uint32_t ticks;
+	uint16_t phase;
+
+	while(hal_irq_get(&line, &ticks, &phase)){
+		uint32_t time = (ticks * sched_divisor) + (uint16_t)(sched_divisor - phase);
+
+		if(irq_seen[line]){
+			uint32_t interval = time - irq_last_time[line];
+			uint8_t  bin = 0;
+
+			while((bin < (IRQ_BINS - 1)) && (interval > irq_bin_limit[bin])){
+				bin++;
+			}
+			irq_hist[line][bin]++;
+		}
+		irq_last_time[line] = time;
+		irq_seen[line]      = 1;
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 回数/秒を更新する
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=更新した（描き直す） 0=まだ
+* @details 前回の更新からIRQ_REFRESH_MS以上たっていれば、その間の回数から回数/秒を求める。
+*/
+uint8_t irq_refresh(){
+	uint32_t tick = hal_tick_count();
+	uint32_t span = tick - irq_refresh_tick;
+
+	if(span < ((uint32_t)IRQ_REFRESH_MS * SCHED_HZ / 1000)){
+		return 0;
+	}
+	for(uint8_t irq = 0; irq < HAL_IRQ_LINES; irq++){
+		uint32_t count = hal_irq_count(irq);
+
+		irq_rate[irq]      = (uint32_t)(((unsigned long long)(count - irq_rate_base[irq]) * SCHED_HZ) / span);
+		irq_rate_base[irq] = count;
+	}
+	irq_refresh_tick = tick;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 回数を4桁に縮めた文字列にする
+* @param[in] 回数
+* @param[out] 文字列（5バイト以上）
+* @return 無し
+* @details 9999までそのまま、それ以上はK、Mを付ける。0は「   .」。
+*/
+void irq_count_str(uint32_t count, uint8_t *str){
+	if(count == 0){
+		strcpy((char *)str, "   .");
+	}else if(count < 10000UL){
+		sprintf((char *)str, "%4lu", (unsigned long)count);
+	}else if(count < 1000000UL){
+		sprintf((char *)str, "%3luK", (unsigned long)(count / 1000UL));
+	}else{
+		sprintf((char *)str, "%3luM", (unsigned long)((count / 1000000UL) % 1000UL));
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込み監視画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 1行に1本のIRQで、回数、回数/秒、最後の割り込みからの秒数、到着間隔の分布を表示する。
+* @details マスクされているIRQは青で表示する。
+*/
+void irq_draw(){
+	uint8_t  master = port_in8(PIC_MASTER_IMR);
+	uint8_t  slave  = port_in8(PIC_SLAVE_IMR);
+	uint16_t mask   = ((uint16_t)slave << 8) | master;
+	uint32_t now    = sched_clock();
+	uint8_t  line[80];
+	uint8_t  count[8];
+
+	sprintf((char *)line, "監視時間:%6lus  記録あふれ:%5u  青=マスク中",
+		(unsigned long)((hal_tick_count() - irq_start_tick) / SCHED_HZ), hal_irq_dropped());
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 1);
+	VRAM_print("到着間隔の分布（区間の上限 u=us m=ms）", ATTR_COLOR_WHITE, 37, 2);
+	VRAM_print("IRQ NAME      COUNT     /s  LAST", ATTR_COLOR_SKY, 2, 3);
+	for(uint8_t bin = 0; bin < IRQ_BINS; bin++){
+		VRAM_print((uint8_t *)irq_bin_label[bin], ATTR_COLOR_SKY, 37 + (bin * 5), 3);
+	}
+
+	for(uint8_t irq = 0; irq < HAL_IRQ_LINES; irq++){
+		uint8_t attr = ((mask & (1 << irq)) ? ATTR_COLOR_BLUE : ATTR_COLOR_WHITE);
+		uint8_t last[8];
+
+		if(irq_seen[irq]){
+			uint32_t tenth = (uint32_t)(((unsigned long long)(now - irq_last_time[irq]) * 10) / pit_clock);
+			sprintf((char *)last, "%4lu.%lu", (unsigned long)(tenth / 10), (unsigned long)(tenth % 10));
+		}else{
+			strcpy((char *)last, "     -");
+		}
+		sprintf((char *)line, "%3u %-5s %10lu %6lu %6s",
+			irq, irq_name[irq], (unsigned long)hal_irq_count(irq), (unsigned long)irq_rate[irq], last);
+		VRAM_print(line, attr, 2, 4 + irq);
+		for(uint8_t bin = 0; bin < IRQ_BINS; bin++){
+			irq_count_str(irq_hist[irq][bin], count);
+			VRAM_print(count, attr, 37 + (bin * 5), 4 + irq);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込み監視画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details マスタとスレーブの8259の16本のベクタを乗っ取り、IRQごとの回数と時刻を取る。乗っ取るのはこの画面の間だけ。
+* @details 割り込み処理は数えて時刻を記録し、元の処理に繋ぐだけ。集計はキー入力の無い間に行い、IRQ_REFRESH_MSごとに描き直す。
+*/
+void irq_mode(){
+	draw_sub_frame(" IRQ MONITOR ");
+	VRAM_print("[SPC]クリア [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	irq_clear();
+	irq_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint8_t redraw = 1;
+
+		switch(kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x34: //SPACE
+			irq_clear();
+			break;
+		case 0x01: //入力なし
+			redraw = 0;
+			irq_drain();
+			if(irq_refresh()){
+				irq_draw();
+				screen_flush();
+			}
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			irq_draw();
+			screen_flush();
+		}
+	}
+	hal_irq_unhook();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief DMAバッファを確保する
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=確保済み 0=確保できない
+* @details DMACのアドレスは16ビットで、上位はバンクで固定なので、バッファは64KB境界をまたげない。
+* @details 倍の大きさを確保し、その中のDMA_BUF_SIZE境界に合わせた所を使う。確保時は0,1,2…で埋める。
+*/
+uint8_t dma_init(){
+	if(dma_alloc == 0){
+		uint16_t paras = (uint16_t)(DMA_BUF_SIZE >> 4);
+
+		dma_alloc = hal_far_alloc(paras * 2);
+		if(dma_alloc == 0){
+			return 0;
+		}
+		dma_seg = (dma_alloc + (paras - 1)) & ~(paras - 1);
+
+		uint8_t __far *buf = (uint8_t __far *)MK_FP(dma_seg, 0);
+		for(uint16_t index = 0; index < (uint16_t)DMA_BUF_SIZE; index++){
+			buf[index] = (uint8_t)index;
+		}
+	}
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief DMACのチャネルを設定する
+* @param[in] 無し
+* @param[out] 無し
+* @return モードレジスタに書いた値
+* @details チャネルをマスクしてから、モード、アドレス、バンク、カウント（転送数-1）を書く。マスクは外さない。
+*/
+uint8_t dma_program(){
+	uint8_t  ch    = dma_channel;
+	uint32_t phys  = (uint32_t)dma_seg << 4;
+	uint16_t count = dma_count - 1;
+	uint8_t  mode  = dma_mode_bits[dma_mode_sel] | (dma_dir ? 0x08 : 0x04) | ch;
+
+	port_out8(DMA_MASK, 0x04 | ch);
+	port_out8(DMA_MODE, mode);
+	port_out8(DMA_CLEAR_FF, 0);
+	port_out8(dma_addr_port[ch], (uint8_t)phys);
+	port_out8(dma_addr_port[ch], (uint8_t)(phys >> 8));
+	port_out8(dma_bank_port[ch], (uint8_t)((phys >> 16) & 0x0F));
+	port_out8(dma_addr_port[ch] + 2, (uint8_t)count);
+	port_out8(dma_addr_port[ch] + 2, (uint8_t)(count >> 8));
+	return mode;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief DMACのチャネルの残りバイト数
+* @param[in] 無し
+* @param[out] 無し
+* @return 残りバイト数
+* @details 現在カウントは残り-1で、ターミナルカウントの後は0FFFFhになる。
+*/
+uint16_t dma_remaining(){
+	uint16_t port = dma_addr_port[dma_channel] + 2;
+	uint16_t count;
+
+	port_out8(DMA_CLEAR_FF, 0);
+	count  = port_in8(port);
+	count |= (uint16_t)port_in8(port) << 8;
+	return count + 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief DMA転送を1回行う
+* @param[in] 0=ボードのDREQを待つ 1=ソフトウェア要求で始める
+* @param[out] 無し
+* @return 無し
+* @details チャネルを設定してマスクを外し、ターミナルカウントに達するか、カウントがDMA_IDLE_MS進まなくなるまで待つ。
+* @details 待つ間はステータスとカウントを読むだけで、データには触らない。終わったらチャネルをマスクする。
+* @details 遅いボードで長く掛かることがあるので、キー入力があれば中断する（キーは読まない）。
+* @details ソフトウェア要求はブロックモードでないと1バイトずつしか進まない。
+*/
+void dma_run(uint8_t request){
+	uint8_t  ch    = dma_channel;
+	uint32_t idle  = (pit_clock * DMA_IDLE_MS) / 1000;
+	uint16_t last  = dma_count;
+	uint32_t since = 0;
+	uint8_t  tc    = 0;
+	uint8_t  abort = 0;
+	uint8_t  mode  = dma_program();
+
+	pit_start();
+	port_out8(DMA_MASK, ch);
+	if(request){
+		port_out8(DMA_REQUEST, 0x04 | ch);
+	}
+	for(;;){
+		uint32_t now = pit_elapsed();
+
+		if(port_in8(DMA_STATUS) & (1 << ch)){
+			tc    = 1;
+			since = now;
+			break;
+		}
+		uint16_t remain = dma_remaining();
+		if(remain != last){
+			last  = remain;
+			since = now;
+		}else if((now - since) > idle){
+			break;
+		}
+		if(key_pending()){
+			abort = 1;
+			since = now;
+			break;
+		}
+	}
+	port_out8(DMA_MASK, 0x04 | ch);
+	if(request){
+		port_out8(DMA_REQUEST, ch);
+	}
+	pit_stop();
+
+	dma_ticks      = since;
+	dma_done       = (tc ? dma_count : (uint16_t)(dma_count - dma_remaining()));
+	dma_done_tc    = tc;
+	dma_done_abort = abort;
+	dma_done_dir   = dma_dir;
+	dma_done_count = dma_count;
+	logger(1, 0, DMA_MODE, mode);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief DMA画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 設定（S+↑↓で変える項目は反転表示）、前回の結果、バッファの16進ダンプを表示する。
+*/
+void dma_draw(){
+	uint8_t line[80];
+	uint8_t attr[4];
+
+	for(uint8_t field = 0; field < 4; field++){
+		attr[field] = ((field == dma_field) ? (ATTR_COLOR_YELLOW | ATTR_REVERSE) : ATTR_COLOR_WHITE);
+	}
+	VRAM_print("CH:",    ATTR_COLOR_WHITE, 2, 1);
+	sprintf((char *)line, "%u", dma_channel);
+	VRAM_print(line,     attr[0], 5, 1);
+	VRAM_print("向き:",  ATTR_COLOR_WHITE, 8, 1);
+	VRAM_print((dma_dir ? "メモリ→ポート" : "ポート→メモリ"), attr[1], 13, 1);
+	VRAM_print("モード:", ATTR_COLOR_WHITE, 29, 1);
+	VRAM_print((uint8_t *)dma_mode_name[dma_mode_sel], attr[2], 36, 1);
+	VRAM_print("転送数:", ATTR_COLOR_WHITE, 44, 1);
+	sprintf((char *)line, "%5u", dma_count);
+	VRAM_print(line,     attr[3], 51, 1);
+
+	if(dma_seg == 0){
+		VRAM_print("バッファを確保できません", ATTR_COLOR_RED, 2, 3);
+		return;
+	}
+	sprintf((char *)line, "バッファ:%05lXh", (unsigned long)((uint32_t)dma_seg << 4));
+	VRAM_print(line, ATTR_COLOR_WHITE, 58, 1);
+
+	if(dma_done_count){
+		sprintf((char *)line, "結果: %s %5u/%5uバイト %s %8luus %8luバイト/秒",
+			(dma_done_dir ? "M→P" : "P→M"), dma_done, dma_done_count, (dma_done_tc ? "TC    " : (dma_done_abort ? "中断  " : "打切り")),
+			(unsigned long)pit_to_us(dma_ticks), (unsigned long)pit_rate(dma_done, dma_ticks));
+		VRAM_print(line, ATTR_COLOR_YELLOW, 2, 2);
+	}
+
+	uint8_t __far *buf  = (uint8_t __far *)MK_FP(dma_seg, 0);
+	uint16_t       rows = (uint16_t)((dma_count + 15) / 16);
+	if((dma_top + DMA_VIEW_ROWS) > rows){
+		dma_top = ((rows > DMA_VIEW_ROWS) ? (rows - DMA_VIEW_ROWS) : 0);
+	}
+	for(uint16_t row = 0; row < DMA_VIEW_ROWS; row++){
+		uint16_t offset = (dma_top + row) * 16;
+		clear_area(ATTR_COLOR_WHITE, 2, 4 + row, 54, 1);
+		if(offset >= dma_count){
+			continue;
+		}
+		VRAM_print_word(word_str(offset), ATTR_COLOR_SKY, 2, 4 + row);
+		for(uint8_t col = 0; (col < 16) && ((offset + col) < dma_count); col++){
+			VRAM_print_byte(byte_str(buf[offset + col]), ATTR_COLOR_WHITE, 8 + (col * 3), 4 + row);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 本体の装置が使うチャネルで転送してよいか確かめる
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=転送してよい 0=中止
+* @details DMA_BOARD_CH以外では、転送するとHDDやFDDのチャネル設定を書き換える。
+* @details RETURNで転送する。確認はチャネルを変えるまで有効。
+*/
+uint8_t dma_confirm(){
+	uint8_t line[80];
+	uint8_t key;
+
+	if((dma_channel == DMA_BOARD_CH) || (dma_channel == dma_confirmed)){
+		return 1;
+	}
+	sprintf((char *)line, "CH%uは本体の装置（HDD、FDD）が使うチャネルです。[RET]で転送、他のキーで中止", dma_channel);
+	clear_area(ATTR_COLOR_WHITE, 2, 2, 76, 1);
+	VRAM_print(line, (ATTR_COLOR_RED | ATTR_REVERSE), 2, 2);
+	screen_flush();
+	while((key = kbread()) == 0x01){
+		hal_idle();
+	}
+	clear_area(ATTR_COLOR_WHITE, 2, 2, 76, 1);
+	if(key != 0x1C){
+		return 0;
+	}
+	dma_confirmed = dma_channel;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief DMA画面の設定を1段変える
+* @param[in] 0=DOWN 1=UP
+* @param[out] 無し
+* @return 無し
+* @details 転送数は2倍、1/2で1～DMA_BUF_SIZEの範囲。他は一周する。
+*/
+void dma_step(uint8_t up){
+	switch(dma_field){
+	case 0:
+		dma_channel   = (dma_channel + (up ? 1 : 3)) & 3;
+		dma_confirmed = 0xFF;
+		break;
+	case 1:
+		dma_dir ^= 1;
+		break;
+	case 2:
+		dma_mode_sel = (dma_mode_sel + (up ? 1 : 2)) % 3;
+		break;
+	default:
+		if(up && (dma_count < DMA_BUF_SIZE)){
+			dma_count <<= 1;
+		}else if(!up && (dma_count > 1)){
+			dma_count >>= 1;
+		}
+		break;
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief DMA画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 8237 DMACの1チャネルで、DMAに対応したボードとバッファの間を転送する。CPUはポートに触らない。
+* @details ポート→メモリはボードのデータをバッファに取り込み、メモリ→ポートはバッファの内容を送る。
+*/
+void dma_mode(){
+	dma_init();
+
+	draw_sub_frame(" DMA ");
+	VRAM_print("[SPC]開始 [S+SPC]要求付 [←→]項目 [S+↑↓]値 [↑↓ROLL]表示 [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	dma_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint16_t rows   = (uint16_t)((dma_count + 15) / 16);
+		uint8_t  redraw = 1;
+		uint8_t  key;
+
+		switch(key = kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x34: //SPACE
+		case 0xB4: //SHIFT + SPACE
+			if(dma_seg && dma_confirm()){
+				VRAM_print("転送中...", (ATTR_COLOR_RED | ATTR_BLINK), 2, 2);
+				screen_flush();
+				dma_run(key == 0xB4);
+				if(dma_done_abort){
+					kbread();				//中断に使ったキーを捨てる
+				}
+				clear_area(ATTR_COLOR_WHITE, 2, 2, 76, 1);
+			}
+			break;
+		case 0x3B: //LEFT
+			dma_field = (dma_field - 1) & 3;
+			break;
+		case 0x3C: //RIGHT
+			dma_field = (dma_field + 1) & 3;
+			break;
+		case 0xBA: //SHIFT + UP
+			dma_step(1);
+			break;
+		case 0xBD: //SHIFT + DOWN
+			dma_step(0);
+			break;
+		case 0x3A: //UP
+			if(dma_top) dma_top--;
+			break;
+		case 0x3D: //DOWN
+			if((dma_top + DMA_VIEW_ROWS) < rows) dma_top++;
+			break;
+		case 0x37: //ROLL DOWN
+			dma_top = ((dma_top > DMA_VIEW_ROWS) ? (dma_top - DMA_VIEW_ROWS) : 0);
+			break;
+		case 0x36: //ROLL UP
+			if((dma_top + (DMA_VIEW_ROWS * 2)) < rows){
+				dma_top += DMA_VIEW_ROWS;
+			}else{
+				dma_top = ((rows > DMA_VIEW_ROWS) ? (rows - DMA_VIEW_ROWS) : 0);
+			}
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			dma_draw();
+			screen_flush();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 条件待ちの統計を0に戻す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 区間の上限はここでPITのカウント数に直す。
+*/
+void cond_clear(){
+	for(uint8_t bin = 0; bin < (COND_BINS - 1); bin++){
+		cond_bin_limit[bin] = (uint32_t)(((unsigned long long)cond_bin_us[bin] * pit_clock) / 1000000UL);
+	}
+	memset(cond_hist, 0, sizeof(cond_hist));
+	cond_runs     = 0;
+	cond_timeouts = 0;
+	cond_min      = 0xFFFFFFFFUL;
+	cond_max      = 0;
+	cond_sum      = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 書き込んでから条件が成立するまでを1回計る
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details cond_port_wにcond_valueを書き、cond_port_rを読んで(値 & cond_mask) == cond_expectになるまで待つ。
+* @details 時間は書き込む直前から、成立した値を読んだ直後まで。1回読むごとにPITも読むので、分解能はその1周分。
+* @details cond_timeoutを過ぎたらタイムアウトとして数える。結果は統計に加える。
+*/
+void cond_trial(){
+	uint32_t limit = (uint32_t)(((unsigned long long)cond_timeout * pit_clock) / 1000);
+	uint32_t polls = 0;
+	uint32_t start, elapsed;
+	uint8_t  value, hit = 0;
+
+	pit_start();
+	start = pit_elapsed();
+	port_out8(cond_port_w, cond_value);
+	do{
+		value   = port_in8(cond_port_r);
+		elapsed = pit_elapsed() - start;
+		polls++;
+		if((value & cond_mask) == cond_expect){
+			hit = 1;
+			break;
+		}
+	}while(elapsed <= limit);
+	pit_stop();
+
+	cond_last_ticks = elapsed;
+	cond_last_value = value;
+	cond_last_polls = polls;
+	cond_last_hit   = hit;
+	cond_runs++;
+	if(!hit){
+		cond_timeouts++;
+		return;
+	}
+
+	uint8_t bin = 0;
+	while((bin < (COND_BINS - 1)) && (elapsed > cond_bin_limit[bin])){
+		bin++;
+	}
+	cond_hist[bin]++;
+	cond_sum += elapsed;
+	if(elapsed < cond_min) cond_min = elapsed;
+	if(elapsed > cond_max) cond_max = elapsed;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 条件待ちを試行回数だけ繰り返す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details ログには最後の試行の書き込みと、最後に読んだ値を残す。
+* @details 試行の合間にキー入力があれば中断し、そこまでの結果を残す（キーは読まない）。
+*/
+void cond_run(){
+	uint16_t total = cond_trial_list[cond_trial_sel];
+
+	cond_aborted   = 0;
+	cond_last_done = 0;
+	while(cond_last_done < total){
+		cond_trial();
+		cond_last_done++;
+		if((cond_last_done < total) && key_pending()){
+			cond_aborted = 1;
+			break;
+		}
+	}
+	logger(1, 0, cond_port_w, cond_value);
+	logger(0, 0, cond_port_r, cond_last_value);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief カーソル位置の桁を1つ上げ下げする
+* @param[in] 1=上げる 0=下げる
+* @param[out] 無し
+* @return 無し
+* @details 0～3は書込ポート、4～5は書込値、6～9は読込ポート、10～11はマスク、12～13は期待値の桁。
+*/
+void cond_digit(uint8_t up){
+	uint8_t  pos  = cond_cursol;
+	uint16_t step;
+
+	if(pos < 4){
+		step = (0x0001 << ((3 - pos) * 4));
+		cond_port_w = (up ? (cond_port_w + step) : (cond_port_w - step));
+	}else if(pos < 6){
+		step = (0x0001 << ((5 - pos) * 4));
+		cond_value = (uint8_t)(up ? (cond_value + step) : (cond_value - step));
+	}else if(pos < 10){
+		step = (0x0001 << ((9 - pos) * 4));
+		cond_port_r = (up ? (cond_port_r + step) : (cond_port_r - step));
+	}else if(pos < 12){
+		step = (0x0001 << ((11 - pos) * 4));
+		cond_mask = (uint8_t)(up ? (cond_mask + step) : (cond_mask - step));
+	}else{
+		step = (0x0001 << ((13 - pos) * 4));
+		cond_expect = (uint8_t)(up ? (cond_expect + step) : (cond_expect - step));
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 条件待ち画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 設定、最後の試行、最小/平均/最大（PITのカウント数とus）、待ち時間の分布を表示する。
+*/
+void cond_draw(){
+	uint8_t line[80];
+
+	sprintf((char *)line, "書込 %04X←%02X  待ち (%04X & %02X) == %02X  上限:%4ums  試行:%4u回",
+		cond_port_w, cond_value, cond_port_r, cond_mask, cond_expect, cond_timeout, cond_trial_list[cond_trial_sel]);
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 1);
+	shadow_set_attr((ATTR_COLOR_YELLOW | ATTR_REVERSE), cond_digit_x[cond_cursol], 1);
+
+	if(cond_runs == 0){
+		return;
+	}
+	sprintf((char *)line, "最後: %s %8luカウント %8luus  値:%02X  読込:%6lu回",
+		(cond_last_hit ? "成立    " : "タイム切"), (unsigned long)cond_last_ticks, (unsigned long)pit_to_us(cond_last_ticks),
+		cond_last_value, (unsigned long)cond_last_polls);
+	VRAM_print(line, (cond_last_hit ? ATTR_COLOR_YELLOW : ATTR_COLOR_RED), 2, 3);
+	if(cond_aborted){
+		sprintf((char *)line, "中断: %u回中 %u回で中断", cond_trial_list[cond_trial_sel], cond_last_done);
+		VRAM_print(line, ATTR_COLOR_RED, 2, 4);
+	}else{
+		clear_area(ATTR_COLOR_WHITE, 2, 4, 76, 1);
+	}
+
+	uint32_t hits = cond_runs - cond_timeouts;
+	sprintf((char *)line, "試行:%8lu回  成立:%8lu回  タイムアウト:%8lu回",
+		(unsigned long)cond_runs, (unsigned long)hits, (unsigned long)cond_timeouts);
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 5);
+	if(hits){
+		uint32_t avg = (uint32_t)(cond_sum / hits);
+
+		sprintf((char *)line, "最小:%8luカウント %8luus", (unsigned long)cond_min, (unsigned long)pit_to_us(cond_min));
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 6);
+		sprintf((char *)line, "平均:%8luカウント %8luus", (unsigned long)avg, (unsigned long)pit_to_us(avg));
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 7);
+		sprintf((char *)line, "最大:%8luカウント %8luus", (unsigned long)cond_max, (unsigned long)pit_to_us(cond_max));
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 8);
+	}
+
+	uint32_t peak = 1;
+	for(uint8_t bin = 0; bin < COND_BINS; bin++){
+		if(cond_hist[bin] > peak) peak = cond_hist[bin];
+	}
+	for(uint8_t bin = 0; bin < COND_BINS; bin++){
+		uint8_t *dst = line;
+		uint8_t  bar = (uint8_t)(((unsigned long long)cond_hist[bin] * COND_BAR_WIDTH + (peak - 1)) / peak);
+
+		dst += sprintf((char *)dst, "%s %8lu ", cond_bin_label[bin], (unsigned long)cond_hist[bin]);
+		for(uint8_t col = 0; col < COND_BAR_WIDTH; col++){
+			*dst++ = ((col < bar) ? '#' : ' ');
+		}
+		*dst = 0;
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 10 + bin);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 条件待ち画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details ポートに書き込んでから、別の（同じでもよい）ポートの値がマスク付きで期待値になるまでの時間を計る。
+* @details ボードにコマンドを書いてからREADYになるまでの待ち時間を、繰り返し計って分布にする。
+* @details ポートの初期値はメイン画面のアドレスと8bitの書込値。
+*/
+void cond_mode(){
+	cond_port_w = addr_digit;
+	cond_port_r = addr_digit;
+	cond_value  = byte_digit;
+	if(cond_runs == 0){
+		cond_clear();
+	}
+
+	draw_sub_frame(" WAIT UNTIL ");
+	VRAM_print("[SPC]試行 [S+SPC]クリア [←→]桁 [S+↑↓]値 [ROLL]上限 [HOME]回数 [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	cond_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint8_t redraw = 1;
+
+		switch(kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x34: //SPACE
+			VRAM_print("計測中...", (ATTR_COLOR_RED | ATTR_BLINK), 2, 2);
+			screen_flush();
+			cond_run();
+			if(cond_aborted){
+				kbread();				//中断に使ったキーを捨てる
+			}
+			clear_area(ATTR_COLOR_WHITE, 2, 2, 10, 1);
+			break;
+		case 0xB4: //SHIFT + SPACE
+			cond_clear();
+			clear_area(ATTR_COLOR_WHITE, 2, 3, 76, 15);
+			break;
+		case 0x3B: //LEFT
+			cond_cursol = ((cond_cursol == 0) ? (COND_DIGITS - 1) : (cond_cursol - 1));
+			break;
+		case 0x3C: //RIGHT
+			cond_cursol = ((cond_cursol == (COND_DIGITS - 1)) ? 0 : (cond_cursol + 1));
+			break;
+		case 0xBA: //SHIFT + UP
+			cond_digit(1);
+			break;
+		case 0xBD: //SHIFT + DOWN
+			cond_digit(0);
+			break;
+		case 0x36: //ROLL UP
+			if(cond_timeout < COND_TIMEOUT_MAX) cond_timeout <<= 1;
+			break;
+		case 0x37: //ROLL DOWN
+			if(cond_timeout > 1) cond_timeout >>= 1;
+			break;
+		case 0x3E: //HOME CLR
+			cond_trial_sel = (cond_trial_sel + 1) & 3;
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			cond_draw();
+			screen_flush();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief RS-232Cの設定を覚えておく
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details システムポートCのRS-232C割り込み許可ビットを読んで覚える。
+* @details PITカウンタ2の分周比は読み出せないので、カウンタをREMOTE_PIT_SAMPLES回ラッチして最大値を取り、
+* @details それに一番近い標準の速度（remote_std_baud）の分周比とする。モード3は2ずつ減るので最大値は分周比か1少ない値になる。
+* @details カウンタが0のまま（動いていない）なら分周比は戻さない。8251のモードとコマンドは書き込み専用なので覚えられない。
+*/
+void remote_save(){
+	uint16_t top  = 0;
+	uint16_t diff = 0xFFFF;
+
+	remote_saved_portc   = port_in8(SYS_PORTC_READ) & SYS_RS_INT_BITS;
+	remote_saved_divisor = 0;
+	for(uint16_t count = 0; count < REMOTE_PIT_SAMPLES; count++){
+		port_out8(PIT_CONTROL, 0x80);			//カウンタ2 ラッチ
+		uint16_t value = port_in8(PIT_COUNTER2);
+		value |= ((uint16_t)port_in8(PIT_COUNTER2) << 8);
+		if(value > top){
+			top = value;
+		}
+	}
+	if(top == 0){
+		return;
+	}
+	for(uint8_t index = 0; index < 10; index++){
+		uint32_t divisor = (pit_clock + (8UL * remote_std_baud[index])) / (16UL * remote_std_baud[index]);
+		uint32_t gap     = ((divisor > top) ? (divisor - top) : (top - divisor));
+
+		if((divisor <= 0xFFFF) && (gap < diff)){
+			diff = (uint16_t)gap;
+			remote_saved_divisor = (uint16_t)divisor;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief RS-232Cの設定を画面に入る前に戻す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details remote_save()で覚えた分周比をPITカウンタ2に書き、システムポートCの割り込み許可ビットを戻す。
+* @details 8251は非同期x16 8N1のまま（BIOSの標準と同じ）にしておき、落としていたRTSを上げる。
+*/
+void remote_close(){
+	if(remote_saved_divisor){
+		port_out8(PIT_CONTROL, 0xB6);			//カウンタ2 下位→上位 モード3 バイナリ
+		port_out8(PIT_COUNTER2, (uint8_t)remote_saved_divisor);
+		port_out8(PIT_COUNTER2, (uint8_t)(remote_saved_divisor >> 8));
+	}
+	for(uint8_t bit = 0; bit < 3; bit++){
+		port_out8(SYS_PORTC_SET, (uint8_t)((bit << 1) | ((remote_saved_portc >> bit) & 1)));
+	}
+	port_out8(RS_CONTROL, RS_COMMAND);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief RS-232Cを初期化する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details RS-232Cの割り込みを止め、PITカウンタ2で通信速度を設定し、8251をリセットして非同期8N1、x16にする。
+* @details 分周比はPITのクロック/(16×速度)。8MHz系では19200bps以上は誤差が大きく使えない。
+* @details RTSは落としておき、remote_serve()の中でだけ上げる。
+*/
+void remote_open(){
+	uint16_t divisor = (uint16_t)(pit_clock / (16UL * remote_baud_list[remote_baud_sel]));
+
+	port_out8(SYS_PORTC_SET, 0x00);				//システムポートC bit0 RXRE=0
+	port_out8(SYS_PORTC_SET, 0x02);				//bit1 TXEE=0
+	port_out8(SYS_PORTC_SET, 0x04);				//bit2 TXRE=0
+	port_out8(PIT_CONTROL, 0xB6);				//カウンタ2 下位→上位 モード3 バイナリ
+	port_out8(PIT_COUNTER2, (uint8_t)divisor);
+	port_out8(PIT_COUNTER2, (uint8_t)(divisor >> 8));
+
+	for(uint8_t count = 0; count < 3; count++){	//どの状態からでもコマンド待ちに戻す
+		port_out8(RS_CONTROL, 0x00);
+		idx_wait(REMOTE_RS_WAIT);
+	}
+	port_out8(RS_CONTROL, RS_RESET);
+	idx_wait(REMOTE_RS_WAIT);
+	port_out8(RS_CONTROL, RS_MODE);
+	idx_wait(REMOTE_RS_WAIT);
+	port_out8(RS_CONTROL, RS_COMMAND_HOLD);
+	idx_wait(REMOTE_RS_WAIT);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief RS-232Cから1バイト受け取る
+* @param[in] 待つ時間[ms]
+* @param[out] 受け取ったバイト
+* @return 1=受け取った 0=時間切れ
+* @details 受信エラーがあれば数えて、エラーをリセットする（そのバイトは受け取る）。
+*/
+uint8_t remote_getc(uint8_t *byte, uint16_t ms){
+	uint32_t start = hal_tick_count();
+	uint8_t  status;
+
+	while(!((status = port_in8(RS_CONTROL)) & RS_RXRDY)){
+		if((hal_tick_count() - start) > ms){
+			return 0;
+		}
+	}
+	if(status & RS_ERRORS){
+		remote_errors++;
+		port_out8(RS_CONTROL, RS_COMMAND);
+	}
+	*byte = port_in8(RS_DATA);
+	remote_rx_bytes++;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief RS-232Cに1バイト送る
+* @param[in] バイト
+* @param[out] 無し
+* @return 無し
+* @details 送信可になるまで待つ。
+*/
+void remote_putc(uint8_t byte){
+	while(!(port_in8(RS_CONTROL) & RS_TXRDY)){
+	}
+	port_out8(RS_DATA, byte);
+	remote_tx_bytes++;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief リトルエンディアンの16ビット値を取り出す
+* @param[in] バイト列
+* @param[out] 無し
+* @return 値
+* @details
+*/
+uint16_t remote_get16(const uint8_t __far *bytes){
+	return (uint16_t)(bytes[0] | ((uint16_t)bytes[1] << 8));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief リトルエンディアンで32ビット値を書く
+* @param[in] 値
+* @param[out] バイト列
+* @return 無し
+* @details
+*/
+void remote_put32(uint8_t __far *bytes, uint32_t value){
+	bytes[0] = (uint8_t)value;
+	bytes[1] = (uint8_t)(value >> 8);
+	bytes[2] = (uint8_t)(value >> 16);
+	bytes[3] = (uint8_t)(value >> 24);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 条件待ちコマンド
+* @param[in] ポート、マスク、期待値、上限[ms]
+* @param[out] 結果（成立、最後の値、経過カウント）
+* @return 無し
+* @details 条件待ち画面と同じく、(値 & マスク) == 期待値 になるまで読み続け、経過をPITで計る。
+*/
+void remote_poll(uint16_t port, uint8_t mask, uint8_t expect, uint16_t ms, uint8_t __far *result){
+	uint32_t limit = (uint32_t)(((unsigned long long)ms * pit_clock) / 1000);
+	uint32_t start, elapsed;
+	uint8_t  value, hit = 0;
+
+	pit_start();
+	start = pit_elapsed();
+	do{
+		value   = port_in8(port);
+		elapsed = pit_elapsed() - start;
+		if((value & mask) == expect){
+			hit = 1;
+			break;
+		}
+	}while(elapsed <= limit);
+	pit_stop();
+	logger(0, 0, port, value);
+
+	result[0] = hit;
+	result[1] = value;
+	remote_put32(result + 2, elapsed);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 要求の本体のコマンドを順に実行する
+* @param[in] 本体のバイト数
+* @param[out] 無し
+* @return 応答の本体のバイト数
+* @details 本体は要求バッファの先頭、応答は応答バッファの先頭に[状態][実行したコマンド数]を置いてその後に結果を詰める。
+* @details 知らないコマンド、途中で切れたコマンド、応答に入りきらない結果があれば、そこで止めてエラーを返す。
+* @details 1個ずつの読み書きはメイン画面と同じくログと記録に残し、連続読み書きと条件待ちは最後の値だけログに残す。
+*/
+uint16_t remote_exec(uint16_t len){
+	uint8_t __far *req    = (uint8_t __far *)MK_FP(remote_seg, 0);
+	uint8_t __far *rep    = (uint8_t __far *)MK_FP(remote_seg, REMOTE_FRAME_MAX + REMOTE_FRAME_EXTRA);
+	uint16_t       pos    = 0;
+	uint16_t       out    = REMOTE_REPLY_HEAD;
+	uint16_t       done   = 0;
+	uint8_t        status = REMOTE_OK;
+
+	while(pos < len){
+		uint8_t        op  = req[pos];
+		uint8_t __far *arg = req + pos + 1;
+		uint16_t       need, result, port, count = 0, value;
+
+		if((op > REMOTE_OP_POLL) || ((uint32_t)pos + 1 + remote_arg_size[op] > len)){
+			status = REMOTE_ERR_OP;
+			break;
+		}
+		need   = 1 + remote_arg_size[op];
+		result = remote_result_size[op];
+		port   = remote_get16(arg);
+		if((op == REMOTE_OP_INS8) || (op == REMOTE_OP_OUTS8)){
+			count = remote_get16(arg + 2);
+			if(op == REMOTE_OP_INS8){
+				result = count;
+			}else if(((uint32_t)pos + need + count) > len){
+				status = REMOTE_ERR_OP;
+				break;
+			}else{
+				need += count;
+			}
+		}
+		if(((uint32_t)out + result) > REMOTE_FRAME_MAX){
+			status = REMOTE_ERR_LONG;
+			break;
+		}
+
+		switch(op){
+		case REMOTE_OP_INFO:
+			rep[out]     = REMOTE_VERSION;
+			rep[out + 1] = cpu_type;
+			remote_put32(rep + out + 2, pit_clock);
+			break;
+		case REMOTE_OP_IN8:
+			rep[out] = port_in8(port);
+			rec_put(0, 0, port, rep[out]);
+			logger(0, 0, port, rep[out]);
+			break;
+		case REMOTE_OP_IN16:
+			value = port_in16(port);
+			rep[out]     = (uint8_t)value;
+			rep[out + 1] = (uint8_t)(value >> 8);
+			rec_put(0, 1, port, value);
+			logger(0, 1, port, value);
+			break;
+		case REMOTE_OP_OUT8:
+			rec_put(1, 0, port, arg[2]);
+			logger(1, 0, port, arg[2]);
+			port_out8(port, arg[2]);
+			break;
+		case REMOTE_OP_OUT16:
+			value = remote_get16(arg + 2);
+			rec_put(1, 1, port, value);
+			logger(1, 1, port, value);
+			port_out16(port, value);
+			break;
+		case REMOTE_OP_INS8:
+			if(count){
+				burst_in8(port, rep + out, count);
+				logger(0, 0, port, rep[out + count - 1]);
+			}
+			break;
+		case REMOTE_OP_OUTS8:
+			if(count){
+				logger(1, 0, port, arg[4 + count - 1]);
+				burst_out8(port, arg + 4, count);
+			}
+			break;
+		case REMOTE_OP_POLL:
+			remote_poll(port, arg[2], arg[3], remote_get16(arg + 4), rep + out);
+			break;
+		}
+		pos += need;
+		out += result;
+		done++;
+	}
+
+	rep[0] = status;
+	rep[1] = (uint8_t)done;
+	rep[2] = (uint8_t)(done >> 8);
+	remote_commands += done;
+	remote_last_status = status;
+	remote_last_done   = done;
+	if(status != REMOTE_OK){
+		remote_errors++;
+	}
+	return out;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 要求フレームを1つ受け取って実行し、応答を返す
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=応答した 0=フレームでなかった（捨てた）
+* @details RTSを上げてから呼ぶ。REMOTE_LISTEN_MSの間にSOFが来なければ何もしない。
+* @details 途中でREMOTE_BYTE_MS途切れたり、長すぎたりしたフレームは捨てる。
+* @details 受け取る間と送る間は画面もキーも見ない。チェックが合わなければ何も実行せずREMOTE_ERR_CHECKを返す。
+*/
+uint8_t remote_frame(){
+	uint8_t __far *req   = (uint8_t __far *)MK_FP(remote_seg, 0);
+	uint8_t __far *rep   = (uint8_t __far *)MK_FP(remote_seg, REMOTE_FRAME_MAX + REMOTE_FRAME_EXTRA);
+	uint32_t       start = hal_tick_count();
+	uint8_t        head[4];
+	uint8_t        sum, check;
+	uint16_t       len, out;
+
+	if(!remote_getc(&head[0], REMOTE_LISTEN_MS) || (head[0] != REMOTE_SOF_REQ)){
+		return 0;
+	}
+	for(uint8_t index = 1; index < 4; index++){
+		if(!remote_getc(&head[index], REMOTE_BYTE_MS)){
+			remote_errors++;
+			return 0;
+		}
+	}
+	len = head[2] | ((uint16_t)head[3] << 8);
+	if(len > REMOTE_FRAME_MAX){
+		remote_errors++;
+		return 0;
+	}
+	sum = head[0] + head[1] + head[2] + head[3];
+	for(uint16_t index = 0; index < len; index++){
+		if(!remote_getc(&req[index], REMOTE_BYTE_MS)){
+			remote_errors++;
+			return 0;
+		}
+		sum += req[index];
+	}
+	if(!remote_getc(&check, REMOTE_BYTE_MS)){
+		remote_errors++;
+		return 0;
+	}
+	remote_frames++;
+	remote_last_seq = head[1];
+
+	if((uint8_t)(sum + check) != 0){
+		rep[0] = REMOTE_ERR_CHECK;
+		rep[1] = 0;
+		rep[2] = 0;
+		out = REMOTE_REPLY_HEAD;
+		remote_last_status = REMOTE_ERR_CHECK;
+		remote_last_done   = 0;
+		remote_errors++;
+	}else{
+		out = remote_exec(len);
+	}
+
+	sum = REMOTE_SOF_REPLY + head[1] + (uint8_t)out + (uint8_t)(out >> 8);
+	remote_putc(REMOTE_SOF_REPLY);
+	remote_putc(head[1]);
+	remote_putc((uint8_t)out);
+	remote_putc((uint8_t)(out >> 8));
+	for(uint16_t index = 0; index < out; index++){
+		remote_putc(rep[index]);
+		sum += rep[index];
+	}
+	remote_putc((uint8_t)-sum);
+	remote_last_ms = hal_tick_count() - start;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief RTSを上げている間だけ要求フレームを受け付ける
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=応答した 0=フレームが来なかった（回線が空いている）
+* @details 8251はFIFOを持たないので、画面やキーを見ている間に来たバイトはあふれる。
+* @details RTSはこの中でだけ上げ、相手にはCTSを見て送ってもらう。RTSを落とした時に送り始めていた
+* @details 1バイトは8251に残るので、次に上げた時に受け取れる。
+*/
+uint8_t remote_serve(){
+	uint8_t served;
+
+	port_out8(RS_CONTROL, RS_COMMAND);
+	served = remote_frame();
+	port_out8(RS_CONTROL, RS_COMMAND_HOLD);
+	return served;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief リモート画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 通信速度、フレームとコマンドとエラーの数、送受信バイト数、最後のフレームの結果を表示する。
+*/
+void remote_draw(){
+	uint8_t line[80];
+
+	sprintf((char *)line, "8251 (30h/32h)  速度:%5u bps  8N1 RTS/CTS  分周:%3u",
+		remote_baud_list[remote_baud_sel], (uint16_t)(pit_clock / (16UL * remote_baud_list[remote_baud_sel])));
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 1);
+	if(remote_seg == 0){
+		VRAM_print("バッファを確保できません", ATTR_COLOR_RED, 2, 3);
+		return;
+	}
+	sprintf((char *)line, "フレーム:%8lu  コマンド:%8lu  エラー:%6lu",
+		(unsigned long)remote_frames, (unsigned long)remote_commands, (unsigned long)remote_errors);
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 3);
+	sprintf((char *)line, "受信:%9luバイト  送信:%9luバイト",
+		(unsigned long)remote_rx_bytes, (unsigned long)remote_tx_bytes);
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 4);
+	if(remote_frames){
+		sprintf((char *)line, "最後: SEQ %3u  %s  コマンド%5u個  %6lums",
+			remote_last_seq, remote_status_name[remote_last_status & 3], remote_last_done, (unsigned long)remote_last_ms);
+		VRAM_print(line, ((remote_last_status == REMOTE_OK) ? ATTR_COLOR_YELLOW : ATTR_COLOR_RED), 2, 6);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief リモート画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 本体のRS-232C（8251）で、Linux上のiopm_remoteからの要求フレームを受けて実行するサーバになる。
+* @details 1フレームに読み書き、連続読み書き、条件待ちのコマンドをまとめて送れるので、遅い回線でも往復の回数が少なくて済む。
+* @details 通信形式はiopm_remote.hを参照。
+* @details 入る時にRS-232Cの速度と割り込み許可を覚え、抜ける時に戻す。バッファを確保できなければ8251には触らない。
+* @details フレームが続く間は回線が空くまで（長くてもREMOTE_REDRAW_MSごとに）表示の更新を延ばし、垂直帰線期間も待たない。
+*/
+void remote_mode(){
+	if(remote_seg == 0){
+		remote_seg = hal_far_alloc((uint16_t)((((REMOTE_FRAME_MAX + REMOTE_FRAME_EXTRA) * 2UL) + 15) >> 4));
+	}
+	if(remote_seg){
+		remote_save();
+		remote_open();
+	}
+
+	draw_sub_frame(" REMOTE ");
+	VRAM_print("[HOME]速度 [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	remote_draw();
+	screen_flush();
+
+	uint32_t drawn = hal_tick_count();
+	uint8_t  stale = 0;
+	uint8_t  alive = 1;
+	while(alive){
+		uint8_t redraw = 1;
+
+		switch(kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x3E: //HOME CLR
+			remote_baud_sel = (remote_baud_sel + 1) % 5;
+			if(remote_seg){
+				remote_open();
+			}
+			break;
+		case 0x01: //入力なし
+			redraw = 0;
+			if(remote_seg){
+				uint8_t served = remote_serve();
+
+				stale |= served;
+				if(stale && (!served || ((hal_tick_count() - drawn) >= REMOTE_REDRAW_MS))){
+					remote_draw();
+					screen_copy();						//RTSを落としてあるので帰線期間は待たない
+					stale = 0;
+					drawn = hal_tick_count();
+				}
+			}
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			remote_draw();
+			screen_flush();
+		}
+	}
+	if(remote_seg){
+		remote_close();
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ポート範囲を1回掃引する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details scan_baseからscan_stride間隔でSCAN_PORTS個を読み、前回と反対側の面に格納する。
+* @details 描画やログは挟まず、読み込みだけを先にまとめて行う。
+*/
+void scan_sweep(){
+	uint16_t port   = scan_base;
+	uint8_t  stride = scan_stride;
+	uint8_t *dst;
+
+	scan_page ^= 1;
+	dst = scan_buf[scan_page];
+	for(uint16_t index = 0; index < SCAN_PORTS; index++){
+		*dst++ = port_in8(port);
+		port  += stride;
+	}
+	scan_sweeps++;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief スキャン画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 前回の掃引から値が変わったポートは反転表示する。
+* @details レジスタ定義のあるポートは水色にし、最下行にその名前を並べる（入る分だけ）。
+*/
+void scan_draw(){
+	uint8_t *curr = scan_buf[scan_page];
+	uint8_t *prev = scan_buf[scan_page ^ 1];
+	uint8_t  line[32];
+	uint8_t  names[77] = "";
+	uint8_t  used = 0;
+
+	VRAM_print("開始: 0x",   ATTR_COLOR_WHITE, 2, 1);
+	VRAM_print_word(word_str(scan_base), ATTR_COLOR_WHITE, 10, 1);
+	VRAM_print("間隔:",      ATTR_COLOR_WHITE, 16, 1);
+	VRAM_print_byte(byte_str(scan_stride), ATTR_COLOR_WHITE, 22, 1);
+	sprintf((char *)line, "掃引:%10lu回", (unsigned long)scan_sweeps);
+	VRAM_print(line,         ATTR_COLOR_WHITE, 26, 1);
+	VRAM_print((scan_running ? "RUN " : "STOP"), (scan_running ? ATTR_COLOR_GREEN : ATTR_COLOR_RED), 46, 1);
+
+	for(uint8_t col = 0; col < 16; col++){
+		VRAM_print_byte(byte_str(col * scan_stride), ATTR_COLOR_SKY, 9 + (col * 3), 3);
+	}
+	for(uint8_t row = 0; row < 16; row++){
+		VRAM_print_word(word_str(scan_base + (row * 16 * scan_stride)), ATTR_COLOR_SKY, 2, 4 + row);
+		for(uint8_t col = 0; col < 16; col++){
+			uint8_t       index = (row * 16) + col;
+			const st_reg *reg   = reg_find(scan_base + (index * scan_stride));
+			uint8_t       attr  = (reg ? ATTR_COLOR_SKY : ATTR_COLOR_WHITE);
+
+			if(curr[index] != prev[index]){
+				attr = (ATTR_COLOR_YELLOW | ATTR_REVERSE);
+			}
+			VRAM_print_byte(byte_str(curr[index]), attr, 9 + (col * 3), 4 + row);
+			if(reg && (used < (sizeof(names) - (REG_NAME_LEN + 7)))){
+				used += sprintf((char *)&names[used], "%04X %s  ", reg->port, reg->name);
+			}
+		}
+	}
+	clear_area(ATTR_COLOR_WHITE, 2 + used, 21, 76 - used, 1);
+	VRAM_print(names, ATTR_COLOR_SKY, 2, 21);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief スキャン画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details addr_digitから256ポートを連続して掃引し、16x16の表で表示する。
+* @details 掃引はキー入力が無い間ずっと繰り返し、描画は掃引ごとに1回だけ行う。
+*/
+void scan_mode(){
+	scan_base = addr_digit;
+	scan_sweep();
+	scan_sweep();
+
+	draw_sub_frame(" PORT SCAN ");
+	VRAM_print("[SPC]停止/再開 [S+↑↓]間隔 [↑↓]1行 [ROLL]1画面 [RET]→アドレス [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	scan_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint8_t restart = 0;
+
+		switch(kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x34: //SPACE
+			scan_running ^= 1;
+			break;
+		case 0x1C: //RETURN
+			addr_digit = scan_base;
+			break;
+		case 0xBA: //SHIFT + UP
+			if(scan_stride < 16){
+				scan_stride++;
+				restart = 1;
+			}
+			break;
+		case 0xBD: //SHIFT + DOWN
+			if(scan_stride > 1){
+				scan_stride--;
+				restart = 1;
+			}
+			break;
+		case 0x3A: //UP
+			scan_base -= (16 * scan_stride);
+			restart = 1;
+			break;
+		case 0x3D: //DOWN
+			scan_base += (16 * scan_stride);
+			restart = 1;
+			break;
+		case 0x37: //ROLL DOWN
+			scan_base -= (SCAN_PORTS * scan_stride);
+			restart = 1;
+			break;
+		case 0x36: //ROLL UP
+			scan_base += (SCAN_PORTS * scan_stride);
+			restart = 1;
+			break;
+		default:
+			break;
+		}
+		if(!alive){
+			break;
+		}
+
+		if(restart){
+			scan_sweep();					//範囲が変わったら比較元も取り直す
+			scan_sweep();
+		}else if(scan_running){
+			scan_sweep();
+		}
+		scan_draw();
+		screen_flush();
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キャプチャの変化点を抽出する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 古いサンプルから順にPITカウンタの差分を積算して時刻にし、値が変わった所を変化点バッファに記録する。
+* @details サンプル間隔はPITの一周より十分短いので、差分の桁あふれで一周を吸収できる。
+*/
+void cap_analyze(){
+	uint16_t __far *rec  = (uint16_t __far *)MK_FP(cap_seg, 0);
+	st_edge  __far *edge = (st_edge __far *)MK_FP(cap_edge_seg, 0);
+	uint16_t index      = cap_oldest * 2;
+	uint16_t prev_tick  = rec[index];
+	uint16_t prev_value = rec[index + 1];
+	uint32_t time       = 0;
+
+	cap_first = prev_value;
+	cap_edges = 0;
+	cap_top   = 0;
+	for(uint16_t count = 1; count < cap_kept; count++){
+		index = ((cap_oldest + count) & CAP_SAMPLE_MASK) * 2;
+		time += (uint16_t)(prev_tick - rec[index]);
+		prev_tick = rec[index];
+		if(rec[index + 1] != prev_value){
+			if(cap_edges < CAP_EDGE_MAX){
+				edge[cap_edges].time  = time;
+				edge[cap_edges].value = rec[index + 1];
+				edge[cap_edges].prev  = prev_value;
+			}
+			prev_value = rec[index + 1];
+			cap_edges++;
+		}
+	}
+	cap_span = time;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キャプチャを実行する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details addr_digitをできるだけ速く読み続け、PITカウンタ0の値と一緒にリングバッファに記録する。
+* @details CAP_KEY_CHECK回ごとにBIOSのキーバッファを直接見て、キーが押されていたら止める。
+* @details 1回モードではバッファが一杯になった時点で止める。
+*/
+void cap_run(){
+	uint16_t __far *rec    = (uint16_t __far *)MK_FP(cap_seg, 0);
+	uint16_t        port   = addr_digit;
+	uint16_t        index  = 0;
+	uint32_t        total  = 0;
+
+	pit_start();
+	for(;;){
+		if(cap_width){
+			for(uint8_t count = 0; count < CAP_KEY_CHECK; count++){
+				port_out8(PIT_CONTROL, 0x00);
+				uint16_t tick = port_in8(PIT_COUNTER0);
+				tick |= ((uint16_t)port_in8(PIT_COUNTER0) << 8);
+				rec[index]     = tick;
+				rec[index + 1] = port_in16(port);
+				index = (index + 2) & ((CAP_SAMPLE_MASK << 1) | 1);
+			}
+		}else{
+			for(uint8_t count = 0; count < CAP_KEY_CHECK; count++){
+				port_out8(PIT_CONTROL, 0x00);
+				uint16_t tick = port_in8(PIT_COUNTER0);
+				tick |= ((uint16_t)port_in8(PIT_COUNTER0) << 8);
+				rec[index]     = tick;
+				rec[index + 1] = port_in8(port);
+				index = (index + 2) & ((CAP_SAMPLE_MASK << 1) | 1);
+			}
+		}
+		total += CAP_KEY_CHECK;
+		if(key_pending()){
+			break;
+		}
+		if(cap_oneshot && (total >= CAP_SAMPLES)){
+			break;
+		}
+	}
+	pit_stop();
+
+	cap_port   = port;
+	cap_bits   = cap_width;
+	cap_total  = total;
+	cap_kept   = ((total >= CAP_SAMPLES) ? CAP_SAMPLES : (uint16_t)total);
+	cap_oldest = ((total >= CAP_SAMPLES) ? (index / 2) : 0);
+	cap_analyze();
+
+	logger(0, cap_width, port, rec[((index - 1) & ((CAP_SAMPLE_MASK << 1) | 1))]);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キャプチャ画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 設定、サンプル数・実効レート、変化点の一覧を表示する。
+* @details 変化点は最初のサンプルからの時刻、直前の変化点からの間隔、変化前後の値、変化したビットを表示する。
+*/
+void cap_draw(){
+	uint8_t line[80];
+
+	VRAM_print("ポート: 0x", ATTR_COLOR_WHITE, 2, 1);
+	VRAM_print_word(word_str(addr_digit), ATTR_COLOR_WHITE, 12, 1);
+	VRAM_print("幅:",        ATTR_COLOR_WHITE, 18, 1);
+	VRAM_print((cap_width ? "16bit" : " 8bit"), ATTR_COLOR_WHITE, 22, 1);
+	VRAM_print("停止:",      ATTR_COLOR_WHITE, 29, 1);
+	VRAM_print((cap_oneshot ? "バッファ一杯" : "キー入力　　"), ATTR_COLOR_WHITE, 35, 1);
+
+	if((cap_seg == 0) || (cap_edge_seg == 0)){
+		VRAM_print("バッファを確保できません", ATTR_COLOR_RED, 2, 3);
+		return;
+	}
+	if(cap_total == 0){
+		return;
+	}
+
+	sprintf((char *)line, "総数:%9lu 保持:%5u 時間:%9luus レート:%8lu/秒",
+		(unsigned long)cap_total, cap_kept, (unsigned long)pit_to_us(cap_span),
+		(unsigned long)pit_rate(cap_kept - 1, cap_span));
+	VRAM_print(line, ATTR_COLOR_YELLOW, 2, 2);
+	sprintf((char *)line, "変化点:%7lu 初期値:", (unsigned long)cap_edges);
+	VRAM_print(line, ATTR_COLOR_YELLOW, 2, 3);
+	VRAM_print_word(word_str(cap_first), ATTR_COLOR_YELLOW, 24, 3);
+	VRAM_print("   No.      時刻[us]      間隔[us]  変化前 変化後 変化bit", (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 2, 4);
+
+	st_edge __far *edge  = (st_edge __far *)MK_FP(cap_edge_seg, 0);
+	uint16_t       shown = ((cap_edges > CAP_EDGE_MAX) ? CAP_EDGE_MAX : (uint16_t)cap_edges);
+	for(uint16_t row = 0; row < CAP_VIEW_ROWS; row++){
+		uint16_t number = cap_top + row;
+		clear_area(ATTR_COLOR_WHITE, 2, 5 + row, 60, 1);
+		if(number >= shown){
+			continue;
+		}
+		uint32_t delta = edge[number].time - (number ? edge[number - 1].time : 0);
+		sprintf((char *)line, "%6u %13lu %13lu", number,
+			(unsigned long)pit_to_us(edge[number].time), (unsigned long)pit_to_us(delta));
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 5 + row);
+		VRAM_print_word(word_str(edge[number].prev),  ATTR_COLOR_WHITE,  39, 5 + row);
+		VRAM_print_word(word_str(edge[number].value), ATTR_COLOR_YELLOW, 46, 5 + row);
+		VRAM_print_word(word_str(edge[number].prev ^ edge[number].value), ATTR_COLOR_SKY, 53, 5 + row);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief トレースファイルを作り、ヘッダをバッファに置く
+* @param[in] 出どころ、ヘッダの属性、レコード数
+* @param[out] 無し
+* @return 1=成功 0=失敗
+* @details ファイル名はIOPM0000.IOTから順に、まだ無い名前を探して作る。既存のファイルは上書きしない。
+*/
+uint8_t trace_open(uint8_t source, uint16_t flags, uint32_t records){
+	if(trace_seg == 0){
+		trace_seg = hal_far_alloc((uint16_t)(TRACE_BUF_SIZE >> 4));
+		if(trace_seg == 0){
+			return 0;
+		}
+	}
+
+	uint8_t count = 0;
+	do{
+		if(count++ >= TRACE_NAME_TRY){
+			return 0;
+		}
+		sprintf(trace_name, "IOPM%04u.IOT", trace_serial);
+		trace_serial = (trace_serial + 1) % 10000;
+	}while(!hal_file_create(trace_name, &trace_handle));
+
+	st_trace_head __far *head = (st_trace_head __far *)MK_FP(trace_seg, 0);
+	for(uint8_t index = 0; index < 4; index++){
+		head->magic[index] = TRACE_MAGIC[index];
+	}
+	head->version = TRACE_VERSION;
+	head->source  = source;
+	head->flags   = flags;
+	head->clock   = pit_clock;
+	head->records = records;
+	trace_fill  = sizeof(st_trace_head);
+	trace_error = 0;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief トレースのバッファをファイルに書き出す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details バッファ全体をINT 21hの1回の書き込みで出す。書き切れなければtrace_errorを立てる。
+*/
+void trace_flush(){
+	if(trace_fill && (hal_file_write(trace_handle, MK_FP(trace_seg, 0), trace_fill) != trace_fill)){
+		trace_error = 1;
+	}
+	trace_fill = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief トレースのレコードを1件バッファに置く
+* @param[in] 属性、アドレス、データ、前のレコードからの間隔
+* @param[out] 無し
+* @return 無し
+* @details 間隔が16ビットに収まらなければ、先にTRACE_FLAG_SKIPのレコードで時間を進める。
+*/
+void trace_put(uint8_t flags, uint16_t addr, uint16_t data, uint32_t delta){
+	if(delta > 0xFFFF){
+		trace_put(TRACE_FLAG_SKIP, (uint16_t)(delta >> 16), (uint16_t)delta, 0);
+		delta = 0;
+	}
+	if((trace_fill + sizeof(st_trace_rec)) > TRACE_BUF_SIZE){
+		trace_flush();
+	}
+
+	st_trace_rec __far *rec = (st_trace_rec __far *)MK_FP(trace_seg, trace_fill);
+	rec->flags = flags;
+	rec->addr  = addr;
+	rec->data  = data;
+	rec->delta = (uint16_t)delta;
+	trace_fill += sizeof(st_trace_rec);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief トレースファイルを閉じる
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=成功 0=書き込みに失敗した
+* @details
+*/
+uint8_t trace_close(){
+	trace_flush();
+	hal_file_close(trace_handle);
+	return !trace_error;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ログをトレースファイルに書き出す
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=成功 0=失敗
+* @details 保持している分を古い順に書く。ログには時刻が無いので間隔は0。
+*/
+uint8_t trace_save_log(){
+	if(!trace_open(TRACE_SOURCE_LOG, 0, log_retained())){
+		return 0;
+	}
+	for(uint32_t number = log_total - log_retained(); number < log_total; number++){
+		st_logcell __far *log = log_cell(number);
+		uint8_t flags = ((log->flags & LOG_FLAG_WRITE) ? TRACE_FLAG_WRITE : 0) | ((log->flags & LOG_FLAG_16BIT) ? TRACE_FLAG_16BIT : 0);
+		trace_put(flags, log->addr, log->data, 0);
+	}
+	return trace_close();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キャプチャをトレースファイルに書き出す
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=成功 0=失敗
+* @details 変化点ではなく、バッファに残っている全サンプルを古い順に書く。間隔はPITカウンタの差分。
+*/
+uint8_t trace_save_capture(){
+	uint16_t __far *rec = (uint16_t __far *)MK_FP(cap_seg, 0);
+
+	if((cap_seg == 0) || (cap_kept == 0) || !trace_open(TRACE_SOURCE_CAPTURE, TRACE_HEAD_TIMED, cap_kept)){
+		return 0;
+	}
+
+	uint16_t prev_tick = rec[cap_oldest * 2];
+	for(uint16_t count = 0; count < cap_kept; count++){
+		uint16_t index = ((cap_oldest + count) & CAP_SAMPLE_MASK) * 2;
+		trace_put((cap_bits ? TRACE_FLAG_16BIT : 0), cap_port, rec[index + 1], (uint16_t)(prev_tick - rec[index]));
+		prev_tick = rec[index];
+	}
+	return trace_close();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 記録をトレースファイルに書き出す
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=成功 0=失敗
+* @details レコードは記録したものをそのまま書く。'iopm -r'で読み込んで再生できる。
+*/
+uint8_t trace_save_session(){
+	st_trace_rec __far *rec = (st_trace_rec __far *)MK_FP(rec_seg, 0);
+
+	if((rec_count == 0) || !trace_open(TRACE_SOURCE_SESSION, TRACE_HEAD_TIMED, rec_reads + rec_writes)){
+		return 0;
+	}
+	for(uint16_t number = 0; number < rec_count; number++, rec++){
+		trace_put(rec->flags, rec->addr, rec->data, rec->delta);
+	}
+	return trace_close();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 記録の読み書きの数と時間を数え直す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details ファイルから読み込んだ時に使う。最初の操作より前の間隔は数えない。
+*/
+void rec_summarize(){
+	st_trace_rec __far *rec = (st_trace_rec __far *)MK_FP(rec_seg, 0);
+
+	rec_reads  = 0;
+	rec_writes = 0;
+	rec_span   = 0;
+	for(uint16_t number = 0; number < rec_count; number++, rec++){
+		uint8_t started = ((rec_reads + rec_writes) != 0);
+		if(rec->flags & TRACE_FLAG_SKIP){
+			if(started) rec_span += ((uint32_t)rec->addr << 16) | rec->data;
+			continue;
+		}
+		if(started) rec_span += rec->delta;
+		((rec->flags & TRACE_FLAG_WRITE) ? rec_writes++ : rec_reads++);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief トレースファイルを記録として読み込む
+* @param[in] ファイル名
+* @param[out] 無し
+* @return 1=成功 0=失敗
+* @details レコードはINT 21hの1回の読み込みで記録用のセグメントに直接入れる。REC_MAX件を超える分は読まない。
+*/
+uint8_t rec_load(char *filename){
+	st_trace_head head;
+	uint16_t      handle;
+	uint16_t      bytes;
+
+	if(!rec_init() || !hal_file_open(filename, &handle)){
+		return 0;
+	}
+	if((hal_file_read(handle, &head, sizeof(head)) != sizeof(head)) ||
+	   memcmp(head.magic, TRACE_MAGIC, 4) || (head.version != TRACE_VERSION)){
+		hal_file_close(handle);
+		return 0;
+	}
+	bytes = hal_file_read(handle, MK_FP(rec_seg, 0), (uint16_t)(REC_MAX * sizeof(st_trace_rec)));
+	hal_file_close(handle);
+
+	if(head.clock != pit_clock){
+		printf("%s: PIT clock differs (%lu Hz recorded), timing is scaled by tick\n", MY_NAME, (unsigned long)head.clock);
+	}
+	rec_count = bytes / sizeof(st_trace_rec);
+	rec_summarize();
+	replay_result = REPLAY_NONE;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 記録を再生する
+* @param[in] 0=最速 1=元の間隔
+* @param[out] 無し
+* @return 無し
+* @details 書き込みはそのまま出し、読み込みは読んだ値を記録した値と比べる。
+* @details 元の間隔で再生する場合は、最初の操作からの経過カウントが記録と同じになるまでPITを見て待つ。
+* @details 最速の場合もREPLAY_POLL件ごとにPITを読んで時間を測る。BIOSのキーバッファにキーが入ったら中断する。
+*/
+void replay_run(uint8_t timed){
+	st_trace_rec __far *rec    = (st_trace_rec __far *)MK_FP(rec_seg, 0);
+	uint32_t            target = 0;
+
+	replay_result = REPLAY_DONE;
+	replay_timed  = timed;
+	replay_ops    = 0;
+	replay_reads  = 0;
+	replay_misses = 0;
+	pit_start();
+	for(uint16_t number = 0; number < rec_count; number++, rec++){
+		uint8_t flags = rec->flags;
+
+		if(flags & TRACE_FLAG_SKIP){
+			if(replay_ops) target += ((uint32_t)rec->addr << 16) | rec->data;
+			continue;
+		}
+		if(replay_ops) target += rec->delta;
+
+		if(timed){
+			while(pit_elapsed() < target){
+				if(key_pending()) break;
+			}
+		}else if((replay_ops % REPLAY_POLL) == 0){
+			pit_elapsed();
+		}
+		if(key_pending()){
+			replay_result = REPLAY_ABORT;
+			break;
+		}
+
+		if(flags & TRACE_FLAG_WRITE){
+			((flags & TRACE_FLAG_16BIT) ? port_out16(rec->addr, rec->data) : port_out8(rec->addr, (uint8_t)rec->data));
+		}else{
+			uint16_t value = ((flags & TRACE_FLAG_16BIT) ? port_in16(rec->addr) : port_in8(rec->addr));
+			if(value != rec->data){
+				if(replay_misses < REPLAY_MISS_MAX){
+					replay_miss[replay_misses].number = replay_ops;
+					replay_miss[replay_misses].addr   = rec->addr;
+					replay_miss[replay_misses].expect = rec->data;
+					replay_miss[replay_misses].actual = value;
+				}
+				replay_misses++;
+			}
+			replay_reads++;
+		}
+		replay_ops++;
+	}
+	replay_ticks = pit_elapsed();
+	pit_stop();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 再生画面を再描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 記録の内容、最後の再生結果、読み込みの不一致を表示する。
+*/
+void replay_draw(){
+	uint8_t line[80];
+
+	if(rec_seg == 0){
+		VRAM_print("記録がありません（メイン画面のf･5で記録）", ATTR_COLOR_RED, 2, 1);
+		return;
+	}
+	sprintf((char *)line, "記録:%5u件 書込:%5u 読込:%5u 時間:%10luus",
+		rec_reads + rec_writes, rec_writes, rec_reads, (unsigned long)pit_to_us(rec_span));
+	VRAM_print(line, ATTR_COLOR_WHITE, 2, 1);
+	if(replay_result == REPLAY_NONE){
+		return;
+	}
+
+	sprintf((char *)line, "%s %s 操作:%5u 不一致:%5u/%5u 時間:%10luus",
+		(replay_timed ? "元の間隔" : "最速　　"), ((replay_result == REPLAY_DONE) ? "完了" : "中断"),
+		replay_ops, replay_misses, replay_reads, (unsigned long)pit_to_us(replay_ticks));
+	VRAM_print(line, (replay_misses ? ATTR_COLOR_RED : ATTR_COLOR_YELLOW), 2, 3);
+	sprintf((char *)line, "レート:%8lu回/秒", (unsigned long)pit_rate(replay_ops, replay_ticks));
+	VRAM_print(line, ATTR_COLOR_YELLOW, 2, 4);
+
+	VRAM_print("   No.  ADDR  記録  実際  差bit", (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 2, 6);
+	for(uint8_t row = 0; row < REPLAY_MISS_MAX; row++){
+		clear_area(ATTR_COLOR_WHITE, 2, 7 + row, 40, 1);
+		if(row >= replay_misses){
+			continue;
+		}
+		st_miss *miss = &replay_miss[row];
+		sprintf((char *)line, "%6u  %04X  %04X  %04X  %04X", miss->number, miss->addr, miss->expect, miss->actual, (miss->expect ^ miss->actual));
+		VRAM_print(line, ATTR_COLOR_WHITE, 2, 7 + row);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 再生画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details メイン画面で記録した読み書きを、元の間隔か最速で出し直し、読み込みの値を記録と比べる。
+* @details 記録中に来た場合は記録を止める。
+*/
+void replay_mode(){
+	uint8_t line[32];
+
+	rec_stop();
+	draw_sub_frame(" REPLAY ");
+	VRAM_print("[SPC]元の間隔で再生 [S+SPC]最速で再生 (キー入力で中断) [f4]保存 [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	replay_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint8_t redraw = 1;
+		uint8_t key;
+
+		switch(key = kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x34: //SPACE
+		case 0xB4: //SHIFT + SPACE
+			if(rec_count){
+				VRAM_print("再生中...", (ATTR_COLOR_RED | ATTR_BLINK), 60, 1);
+				screen_flush();
+				replay_run(key == 0x34);
+				if(replay_result == REPLAY_ABORT){
+					kbread();				//中断に使ったキーを捨てる
+				}
+				clear_area(ATTR_COLOR_WHITE, 60, 1, 10, 1);
+			}
+			break;
+		case 0x65: //f･4
+			if(trace_save_session()){
+				sprintf((char *)line, "保存:%-12s", trace_name);
+				VRAM_print(line, ATTR_COLOR_YELLOW, 50, 4);
+			}else{
+				VRAM_print("保存できません   ", ATTR_COLOR_RED, 50, 4);
+			}
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			replay_draw();
+			screen_flush();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief トレースファイルを再生する（画面を使わないモード）
+* @param[in] ファイル名、0=最速 1=元の間隔
+* @param[out] 無し
+* @return 終了コード SCRIPT_EXIT_xxx
+* @details 読み込みの不一致は最初のREPLAY_MISS_MAX件を表示する。
+*/
+int replay_main(char *filename, uint8_t timed){
+	if(!rec_load(filename)){
+		printf("%s: cannot load %s\n", MY_NAME, filename);
+		return SCRIPT_EXIT_ERROR;
+	}
+
+	replay_run(timed);
+	for(uint8_t index = 0; (index < replay_misses) && (index < REPLAY_MISS_MAX); index++){
+		st_miss *miss = &replay_miss[index];
+		printf("NG op %u: %04X = %04X, recorded %04X\n", miss->number, miss->addr, miss->actual, miss->expect);
+	}
+	printf("%u operations, %u reads, %u mismatches, %lu us%s\n", replay_ops, replay_reads, replay_misses,
+		(unsigned long)pit_to_us(replay_ticks), ((replay_result == REPLAY_ABORT) ? ", aborted" : ""));
+	return (replay_misses ? SCRIPT_EXIT_NG : SCRIPT_EXIT_OK);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キャプチャ画面
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details ロジックアナライザのように1つのポートを高速にサンプリングし、変化点とその間隔を表示する。
+*/
+void cap_mode(){
+	uint8_t line[32];
+
+	if(cap_seg == 0){
+		cap_seg = hal_far_alloc((uint16_t)((CAP_SAMPLES * 4UL) >> 4));
+	}
+	if(cap_edge_seg == 0){
+		cap_edge_seg = hal_far_alloc((uint16_t)(((uint32_t)CAP_EDGE_MAX * sizeof(st_edge)) >> 4));
+	}
+
+	draw_sub_frame(" CAPTURE ");
+	VRAM_print("[SPC]開始 [RET]幅 [S+RET]停止条件 [↑↓ROLL]表示 [f4]保存 [ESC]戻る", ATTR_COLOR_WHITE, 2, 22);
+	cap_draw();
+	screen_flush();
+
+	uint8_t alive = 1;
+	while(alive){
+		uint16_t shown  = ((cap_edges > CAP_EDGE_MAX) ? CAP_EDGE_MAX : (uint16_t)cap_edges);
+		uint8_t  redraw = 1;
+
+		switch(kbread()){
+		case 0x80: //ESC
+			alive = 0;
+			break;
+		case 0x34: //SPACE
+			if(cap_seg && cap_edge_seg){
+				VRAM_print("キャプチャ中...", (ATTR_COLOR_RED | ATTR_BLINK), 50, 1);
+				screen_flush();
+				cap_run();
+				kbread();					//停止に使ったキーを捨てる
+				clear_area(ATTR_COLOR_WHITE, 2, 2, 77, 2);
+				clear_area(ATTR_COLOR_WHITE, 50, 1, 20, 1);
+			}
+			break;
+		case 0x65: //f･4
+			if(trace_save_capture()){
+				sprintf((char *)line, "保存:%-12s", trace_name);
+				VRAM_print(line, ATTR_COLOR_YELLOW, 50, 1);
+			}else{
+				VRAM_print("保存できません   ", ATTR_COLOR_RED, 50, 1);
+			}
+			break;
+		case 0x1C: //RETURN
+			cap_width ^= 1;
+			break;
+		case 0x9C: //SHIFT + RETURN
+			cap_oneshot ^= 1;
+			break;
+		case 0x3A: //UP
+			if(cap_top) cap_top--;
+			break;
+		case 0x3D: //DOWN
+			if((cap_top + CAP_VIEW_ROWS) < shown) cap_top++;
+			break;
+		case 0x37: //ROLL DOWN
+			cap_top = ((cap_top > CAP_VIEW_ROWS) ? (cap_top - CAP_VIEW_ROWS) : 0);
+			break;
+		case 0x36: //ROLL UP
+			if((cap_top + (CAP_VIEW_ROWS * 2)) < shown){
+				cap_top += CAP_VIEW_ROWS;
+			}else{
+				cap_top = ((shown > CAP_VIEW_ROWS) ? (shown - CAP_VIEW_ROWS) : 0);
+			}
+			break;
+		default:
+			redraw = 0;
+			break;
+		}
+		if(redraw && alive){
+			cap_draw();
+			screen_flush();
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief メイン画面にトレースの書き出し結果を表示する
+* @param[in] 1=成功 0=失敗
+* @param[out] 無し
+* @return 無し
+* @details ログの件数表示の位置に出す。次にログを描き直した時に件数表示に戻る。
+*/
+void trace_report(uint8_t result){
+	uint8_t line[32];
 
-		switch(keydata){
-		case 0x00: //ESC
-			keydata |= 0x80;
+	if(result){
+		sprintf((char *)line, "保存:%-15s", trace_name);
+		VRAM_print(line, ATTR_COLOR_YELLOW, 2, 18);
+	}else{
+		VRAM_print("保存できません      ", ATTR_COLOR_RED, 2, 18);
+	}
+	log_status_valid = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ウォッチする1ポートを読む
+* @param[in] ウォッチ
+* @param[out] 無し
+* @return 値
+* @details
+*/
+uint16_t watch_read(st_watch *watch){
+	return (watch->b_w ? port_in16(watch->addr) : port_in8(watch->addr));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ポートをウォッチに登録する、または登録を外す
+* @param[in] アドレス、0=8bit 1=16bit
+* @param[out] 無し
+* @return 無し
+* @details 同じアドレスが登録済みなら外す。WATCH_MAX個を超えては登録しない。登録した時に1回読む。
+*/
+void watch_toggle(uint16_t addr, uint8_t b_w){
+	for(uint8_t index = 0; index < watch_count; index++){
+		if(watch_list[index].addr == addr){
+			for(watch_count--; index < watch_count; index++){
+				watch_list[index] = watch_list[index + 1];
+				watch_list[index].dirty = 1;
+			}
+			watch_list[watch_count].dirty = 1;
+			return;
+		}
+	}
+	if(watch_count >= WATCH_MAX){
+		return;
+	}
+
+	st_watch *watch = &watch_list[watch_count++];
+	watch->addr    = addr;
+	watch->b_w     = b_w;
+	watch->hold    = 0;
+	watch->value   = watch_read(watch);
+	watch->prev    = watch->value;
+	watch->changes = 0;
+	watch->dirty   = 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ウォッチの変化回数を0に戻す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void watch_reset(){
+	for(uint8_t index = 0; index < watch_count; index++){
+		watch_list[index].changes = 0;
+		watch_list[index].hold    = 0;
+		watch_list[index].prev    = watch_list[index].value;
+		watch_list[index].dirty   = 1;
+	}
+	watch_sweeps = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ウォッチの表示を更新する
+* @param[in] 0=変化した行だけ 1=全部
+* @param[out] 無し
+* @return 無し
+* @details 右側の2列を1行1ポートで使う。左の列が幅・アドレス・値、右の列が変化前の値・変化したビット・変化回数。
+* @details 変化してから表示の更新WATCH_HOLD_COUNT回の間は反転表示する。
+*/
+void watch_draw(uint8_t all){
+	uint8_t line[32];
+
+	if(all){
+		VRAM_print((reg_names ? "NAME       ADDR : DATA  " : "No. : 8/16 : ADDR : DATA"), (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 27, 1);
+		VRAM_print("PREV : BITS :    CHANGES", (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 54, 1);
+		clear_area(ATTR_COLOR_WHITE, 26, 2 + WATCH_MAX, 26, 20 - WATCH_MAX);
+		clear_area(ATTR_COLOR_WHITE, 53, 2 + WATCH_MAX, 26, 20 - WATCH_MAX);
+		VRAM_print("[f8]登録/解除 [S+f8]16bit", ATTR_COLOR_SKY, 27, 21);
+		VRAM_print("[S+f7]回数クリア",         ATTR_COLOR_SKY, 54, 21);
+	}
+	for(uint8_t index = 0; index < WATCH_MAX; index++){
+		st_watch *watch = &watch_list[index];
+
+		if(!all && !watch->dirty){
+			continue;
+		}
+		watch->dirty = 0;
+		if(index >= watch_count){
+			VRAM_print("--- : ---- : ---- : ----", ATTR_COLOR_WHITE, 27, 2 + index);
+			VRAM_print("---- : ---- : ----------", ATTR_COLOR_WHITE, 54, 2 + index);
+			continue;
+		}
+
+		uint8_t attr = (watch->hold ? (ATTR_COLOR_YELLOW | ATTR_REVERSE) : ATTR_COLOR_WHITE);
+		if(reg_names){
+			const st_reg *reg = reg_find(watch->addr);
+			sprintf((char *)line, "%-*s %04X : %s%0*X  ", REG_NAME_LEN, (reg ? reg->name : "-"), watch->addr,
+				(watch->b_w ? "" : "__"), (watch->b_w ? 4 : 2), watch->value);
+		}else if(watch->b_w){
+			sprintf((char *)line, "%3u :  16  : %04X : %04X", index + 1, watch->addr, watch->value);
+		}else{
+			sprintf((char *)line, "%3u :   8  : %04X : __%02X", index + 1, watch->addr, watch->value);
+		}
+		VRAM_print(line, attr, 27, 2 + index);
+		sprintf((char *)line, "%04X : %04X : %10lu", watch->prev, (watch->prev ^ watch->value), (unsigned long)watch->changes);
+		VRAM_print(line, attr, 54, 2 + index);
+	}
+	sprintf((char *)line, "掃引:%10lu回", (unsigned long)watch_sweeps);
+	VRAM_print(line, ATTR_COLOR_WHITE, 27, 19);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ウォッチのポートを読む
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details スケジューラのタスク。WATCH_POLL_TICKSごとに全ポートを1回ずつ読む。
+*/
+void watch_poll(){
+	for(uint8_t index = 0; index < watch_count; index++){
+		st_watch *watch = &watch_list[index];
+		uint16_t  value = watch_read(watch);
+
+		if(value != watch->value){
+			watch->prev  = watch->value;
+			watch->value = value;
+			watch->hold  = WATCH_HOLD_COUNT;
+			watch->dirty = 1;
+			watch->changes++;
+		}
+	}
+	if(watch_count){
+		watch_sweeps++;
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ウォッチの表示を更新する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details スケジューラのタスク。WATCH_REFRESH_TICKSごとに反転表示の残りを減らし、変化した行だけ描き直す。
+* @details テキストVRAMへの転送は画面転送のタスクが帰線期間に行う。
+*/
+void watch_refresh(){
+	if(watch_count == 0){
+		return;
+	}
+
+	for(uint8_t index = 0; index < watch_count; index++){
+		if(watch_list[index].hold && !--watch_list[index].hold){
+			watch_list[index].dirty = 1;
+		}
+	}
+	if(watch_visible && log_visible){
+		watch_draw(0);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファンクションキーの割り当てを最下行に表示する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 表示位置はBIOSのファンクションキー表示に合わせて5個ずつ2組に分ける。
+*/
+void draw_fkey_bar(){
+	clear_area(ATTR_COLOR_WHITE, 0, 24, TVRAM_WIDTH, 1);
+	for(uint8_t index = 0; index < 10; index++){
+		VRAM_print(fkey_label[index], (ATTR_COLOR_SKY | ATTR_REVERSE), 4 + (index * 7) + ((index < 5) ? 0 : 3), 24);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief メイン画面を描画する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 起動時と、サブ画面から戻った時に呼ぶ。
+* @details 固定文字列はiopm_ui.hで定義し、ビルド時に変換済みのセル列をそのまま書き込む。
+*/
+void draw_main_screen(){
+	frame_draw(frame_main);
+	shadow_invalidate();
+
+	for(uint8_t index = 0; index < (sizeof(ui_main_labels) / sizeof(ui_main_labels[0])); index++){
+		const st_ui_label *label = &ui_main_labels[index];
+		shadow_write_cells(&ui_cells[label->offset], label->len, label->attr, label->x, label->y);
+	}
+	if(reg_names){
+		VRAM_print(" R ADDR NAME       DATA ", (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 27, 1);
+		VRAM_print(" R ADDR NAME       DATA ", (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 54, 1);
+	}
+	reg_line_valid = 0;
+	draw_fkey_bar();
+
+	log_visible = 1;
+	log_status_valid = 0;
+	disp_log();
+	if(watch_visible){
+		watch_draw(1);
+	}
+	rec_status();
+	redraw_digit();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief スクリプトの数値を1つ読む
+* @param[in] 文字列、基数、格納先
+* @param[out] 格納先
+* @return 1=成功 0=数値ではない
+* @details 16進数の場合は先頭の0xを許す。
+*/
+uint8_t script_number(char *token, uint8_t base, uint32_t *value){
+	char *end;
+
+	if(token == NULL){
+		return 0;
+	}
+	*value = strtoul(token, &end, base);
+	return ((end != token) && (*end == '\0'));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief スクリプトファイルを命令列に変換する
+* @param[in] ファイル名
+* @param[out] 無し
+* @return 1=成功 0=失敗
+* @details 1行1命令。'#'以降はコメント。ポートと値は16進数、waitのマイクロ秒とloopの回数は10進数で書く。
+* @details read8/read16 ポート
+* @details write8/write16 ポート 値
+* @details expect8/expect16 ポート 値 [マスク]
+* @details wait マイクロ秒
+* @details loop 回数 ～ end
+* @details waitはここでPITのカウント数に換算しておく。loopとendは互いの命令番号を持たせる。
+*/
+uint8_t script_compile(char *filename){
+	FILE    *fp;
+	char     text[SCRIPT_LINE_MAX];
+	uint16_t stack[SCRIPT_MAX_DEPTH];
+	uint8_t  depth = 0;
+	uint16_t line  = 0;
+
+	if((fp = fopen(filename, "r")) == NULL){
+		printf("%s: cannot open %s\n", MY_NAME, filename);
+		return 0;
+	}
+
+	script_count = 0;
+	while(fgets(text, sizeof(text), fp) != NULL){
+		char    *comment = strchr(text, '#');
+		char    *name;
+		uint32_t arg1 = 0, arg2 = 0, arg3 = 0;
+		st_op   *op = &script_ops[script_count];
+		uint8_t  ok = 1;
+
+		line++;
+		if((strchr(text, '\n') == NULL) && !feof(fp)){
+			printf("%s: line %u: line too long\n", MY_NAME, line);
+			fclose(fp);
+			return 0;
+		}
+		if(comment != NULL){
+			*comment = '\0';
+		}
+		if((name = strtok(text, " \t\r\n")) == NULL){
+			continue;
+		}
+		if(script_count >= SCRIPT_MAX_OPS){
+			printf("%s: line %u: too many operations\n", MY_NAME, line);
+			fclose(fp);
+			return 0;
+		}
+
+		char *token1 = strtok(NULL, " \t\r\n");
+		char *token2 = strtok(NULL, " \t\r\n");
+		char *token3 = strtok(NULL, " \t\r\n");
+
+		op->line = line;
+		op->data = 0;
+		op->mask = 0xFFFF;
+		if(!strcmp(name, "read8") || !strcmp(name, "read16")){
+			op->code = ((name[4] == '8') ? OP_READ8 : OP_READ16);
+			ok = script_number(token1, 16, &arg1) && (token2 == NULL) && (arg1 <= 0xFFFF);
+			op->addr = (uint16_t)arg1;
+		}else if(!strcmp(name, "write8") || !strcmp(name, "write16")){
+			op->code = ((name[5] == '8') ? OP_WRITE8 : OP_WRITE16);
+			ok = script_number(token1, 16, &arg1) && script_number(token2, 16, &arg2) && (token3 == NULL)
+				&& (arg1 <= 0xFFFF) && (arg2 <= ((op->code == OP_WRITE8) ? 0xFF : 0xFFFF));
+			op->addr = (uint16_t)arg1;
+			op->data = (uint16_t)arg2;
+		}else if(!strcmp(name, "expect8") || !strcmp(name, "expect16")){
+			op->code = ((name[6] == '8') ? OP_EXPECT8 : OP_EXPECT16);
+			uint32_t limit = ((op->code == OP_EXPECT8) ? 0xFF : 0xFFFF);
+			arg3 = limit;
+			ok = script_number(token1, 16, &arg1) && script_number(token2, 16, &arg2)
+				&& ((token3 == NULL) || script_number(token3, 16, &arg3))
+				&& (arg1 <= 0xFFFF) && (arg2 <= limit) && (arg3 <= limit);
+			op->addr = (uint16_t)arg1;
+			op->mask = (uint16_t)arg3;
+			op->data = (uint16_t)arg2 & op->mask;
+		}else if(!strcmp(name, "wait")){
+			op->code = OP_WAIT;
+			ok = script_number(token1, 10, &arg1) && (token2 == NULL) && (arg1 <= 1000000UL);
+			uint32_t ticks = (uint32_t)(((unsigned long long)arg1 * pit_clock) / 1000000UL);
+			op->data = (uint16_t)ticks;
+			op->mask = (uint16_t)(ticks >> 16);
+		}else if(!strcmp(name, "loop")){
+			op->code = OP_LOOP;
+			ok = script_number(token1, 10, &arg1) && (token2 == NULL) && (arg1 >= 1) && (arg1 <= 0xFFFF);
+			op->data = (uint16_t)arg1;
+			if(ok){
+				if(depth >= SCRIPT_MAX_DEPTH){
+					printf("%s: line %u: loop nested too deep\n", MY_NAME, line);
+					fclose(fp);
+					return 0;
+				}
+				stack[depth++] = script_count;
+			}
+		}else if(!strcmp(name, "end")){
+			op->code = OP_END;
+			ok = (token1 == NULL);
+			if(ok){
+				if(depth == 0){
+					printf("%s: line %u: end without loop\n", MY_NAME, line);
+					fclose(fp);
+					return 0;
+				}
+				op->addr = stack[--depth];
+				script_ops[op->addr].addr = script_count;
+			}
+		}else{
+			ok = 0;
+		}
+
+		if(!ok){
+			printf("%s: line %u: syntax error\n", MY_NAME, line);
+			fclose(fp);
+			return 0;
+		}
+		script_count++;
+	}
+	fclose(fp);
+
+	if(depth){
+		printf("%s: line %u: loop without end\n", MY_NAME, script_ops[stack[depth - 1]].line);
+		return 0;
+	}
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 命令列を実行する
+* @param[in] 無し
+* @param[out] 無し
+* @return expectの不一致の数
+* @details 画面は使わず、readの結果とexpectの不一致だけを標準出力に出す。
+*/
+uint16_t script_run(){
+	uint16_t counter[SCRIPT_MAX_DEPTH];
+	uint8_t  depth = 0;
+	uint16_t fails = 0;
+	st_op   *op    = script_ops;
+	st_op   *last  = &script_ops[script_count];
+
+	while(op < last){
+		uint16_t value;
+
+		switch(op->code){
+		case OP_READ8:
+			printf("R  8 %04X %02X\n", op->addr, port_in8(op->addr));
 			break;
-		case 0x1C: //RETURN
-			if(shift & 0x01) keydata |= 0x80;
+		case OP_READ16:
+			printf("R 16 %04X %04X\n", op->addr, port_in16(op->addr));
 			break;
-		case 0x34: //SPACE
-			if(shift & 0x01) keydata |= 0x80;
+		case OP_WRITE8:
+			port_out8(op->addr, op->data);
 			break;
-		case 0x3A: //UP
-			if(shift & 0x01) keydata |= 0x80;
+		case OP_WRITE16:
+			port_out16(op->addr, op->data);
 			break;
-		case 0x3B: //LEFT
+		case OP_EXPECT8:
+		case OP_EXPECT16:
+			value = ((op->code == OP_EXPECT8) ? port_in8(op->addr) : port_in16(op->addr));
+			if((value & op->mask) != op->data){
+				printf("NG line %u: %04X = %04X, expect %04X mask %04X\n", op->line, op->addr, value, op->data, op->mask);
+				fails++;
+			}
 			break;
-		case 0x3C: //RIGHT
+		case OP_WAIT:
+			{
+				uint32_t ticks = ((uint32_t)op->mask << 16) | op->data;
+				pit_start();
+				while(pit_elapsed() < ticks);
+				pit_stop();
+			}
 			break;
-		case 0x3D: //DOWN
-			if(shift & 0x01) keydata |= 0x80;
+		case OP_LOOP:
+			counter[depth++] = op->data;
+			break;
+		case OP_END:
+			if(--counter[depth - 1]){
+				op = &script_ops[op->addr];
+			}else{
+				depth--;
+			}
 			break;
-		default:
-			return 0;
 		}
-		return keydata;
-	}else{
-		return 1;
+		op++;
+	}
+	return fails;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief スクリプトを実行する（画面を使わないモード）
+* @param[in] ファイル名
+* @param[out] 無し
+* @return 終了コード SCRIPT_EXIT_xxx
+* @details 読み込みと変換を全部済ませてから実行を始める。
+*/
+int script_main(char *filename){
+	if(!script_compile(filename)){
+		return SCRIPT_EXIT_ERROR;
+	}
+
+	uint16_t fails = script_run();
+	printf("%u operations, %u expect failures\n", script_count, fails);
+	return (fails ? SCRIPT_EXIT_NG : SCRIPT_EXIT_OK);
+}
+
+#ifndef IOPM_NO_MAIN
+//-------------------------------------------------------------------------
+/**
+* @brief キー入力を1回見て処理する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details スケジューラのタスク。SCHED_KEY_TICKSごとに呼ばれる。ESCでsched_aliveを0にする。
+* @details サブ画面はこの中で閉じるまで動くので、その間は他のタスクは止まる。
+*/
+void main_key(){
+	switch(kbread()){
+	case 0x80:	//ESC
+		sched_alive = 0;
+		break;
+	case 0x1C: //RETURN
+		io_read_16bit();
+		break;
+	case 0x9C: //SHIFT + RETURN
+		io_write_16bit();
+		break;
+	case 0x34: //SPACE
+		io_read_8bit();
+		break;
+	case 0xB4: //SHIFT + SPACE
+		io_write_8bit();
+		break;
+	case 0x3A: //UP
+		cursol_up();
+		break;
+	case 0xBA: //SHIFT + UP
+		value_up();
+		break;
+	case 0x3B: //LEFT
+		cursol_left();
+		break;
+	case 0x3C: //RIGHT
+		cursol_right();
+		break;
+	case 0x3D: //DOWN
+		cursol_down();
+		break;
+	case 0xBD: //SHIFT + DOWN
+		value_down();
+		break;
+	case 0x37: //ROLL DOWN
+		log_page(1);
+		break;
+	case 0x36: //ROLL UP
+		log_page(0);
+		break;
+	case 0x3E: //HOME CLR
+		log_page(2);
+		break;
+	case 0x62: //f･1
+		burst_mode();
+		draw_main_screen();
+		break;
+	case 0x63: //f･2
+		scan_mode();
+		draw_main_screen();
+		break;
+	case 0x64: //f･3
+		cap_mode();
+		draw_main_screen();
+		break;
+	case 0x65: //f･4
+		trace_report(trace_save_log());
+		break;
+	case 0x66: //f･5
+		(rec_active ? rec_stop() : rec_start());
+		rec_status();
+		break;
+	case 0x67: //f･6
+		replay_mode();
+		draw_main_screen();
+		break;
+	case 0x68: //f･7
+		watch_visible ^= 1;
+		draw_main_screen();
+		break;
+	case 0xE8: //SHIFT + f･7
+		watch_reset();
+		if(watch_visible) watch_draw(0);
+		break;
+	case 0x69: //f･8
+		watch_toggle(addr_digit, 0);
+		if(watch_visible) watch_draw(0);
+		break;
+	case 0xE9: //SHIFT + f･8
+		watch_toggle(addr_digit, 1);
+		if(watch_visible) watch_draw(0);
+		break;
+	case 0x6A: //f･9
+		pat_mode();
+		draw_main_screen();
+		break;
+	case 0x6B: //f･10
+		speed_mode();
+		draw_main_screen();
+		break;
+	case 0xE2: //SHIFT + f･1
+		mem_mode();
+		draw_main_screen();
+		break;
+	case 0xE3: //SHIFT + f･2
+		snap_mode();
+		draw_main_screen();
+		break;
+	case 0xE4: //SHIFT + f･3
+		reg_names ^= 1;
+		draw_main_screen();
+		break;
+	case 0xE5: //SHIFT + f･4
+		idx_mode();
+		draw_main_screen();
+		break;
+	case 0xE6: //SHIFT + f･5
+		irq_mode();
+		draw_main_screen();
+		break;
+	case 0xE7: //SHIFT + f･6
+		dma_mode();
+		draw_main_screen();
+		break;
+	case 0xEA: //SHIFT + f･9
+		cond_mode();
+		draw_main_screen();
+		break;
+	case 0xEB: //SHIFT + f･10
+		remote_mode();
+		draw_main_screen();
+		break;
+	default:
+		break;
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief シャドウVRAMの更新をテキストVRAMに転送する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details スケジューラのタスク。垂直帰線期間に入っていれば転送する。
+* @details 帰線期間に当たらないままSCHED_FLUSH_LATE回過ぎたら、待たずに転送する。
+*/
+void sched_flush(){
+	if(dirty_rows == 0){
+		sched_flush_wait = 0;
+		return;
+	}
+	if((port_in8(GDC_STATUS) & GDC_VSYNC) || (++sched_flush_wait >= SCHED_FLUSH_LATE)){
+		screen_copy();
+		sched_flush_wait = 0;
+	}
+}
+
+///スケジューラのタスク　上から順に実行する
+static st_task sched_tasks[] = {
+	{main_key,      SCHED_KEY_TICKS,     0},
+	{watch_poll,    WATCH_POLL_TICKS,    0},
+	{watch_refresh, WATCH_REFRESH_TICKS, 0},
+	{sched_flush,   SCHED_FLUSH_TICKS,   0},
+};
+
+//-------------------------------------------------------------------------
+/**
+* @brief 実行する時刻になったタスクを実行する
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=1つ以上実行した 0=何も実行しなかった
+* @details 次の実行はその時点のtickから間隔分先にする。遅れた分は取り戻さない。
+* @details サブ画面などで長く止まって予定が過去になったタスクも、次の呼び出しで実行される。
+*/
+uint8_t sched_run(){
+	uint16_t now = (uint16_t)hal_tick_count();
+	uint8_t  ran = 0;
+
+	for(uint8_t index = 0; index < sizeof(sched_tasks) / sizeof(sched_tasks[0]); index++){
+		st_task *task = &sched_tasks[index];
+
+		if((uint16_t)(task->due - now - 1) >= task->period){
+			task->due = now + task->period;
+			task->proc();
+			ran = 1;
+		}
 	}
+	return ran;
 }
 
 //-------------------------------------------------------------------------
@@ -584,105 +5584,75 @@ uint8_t kbread(){
 * @param[in] 無し
 * @param[out] 無し
 * @return かならず0
-* @details 画面を描画し、キー入力を待ち、キーに合わせて、実行内容を選択する。
+* @details 画面を描画し、タイマ割り込みで動くスケジューラにキー入力、ウォッチ、画面転送のタスクを任せる。
+* @details 実行するタスクが無い間はHLTで次の割り込みを待つ。
 * @details 
 * @details 画面説明
 * @details 
 * @details 左上のペインのうち、アドレス、データの数字のところをカーソルが動きます。
 * @details 読み書きを行った場合、結果が右のペインに 20x2行分ログとして残ります。
 * @details ログ表示は循環し、最新の読み書き行がハイライトされます。
+* @details 
+* @details -s ファイル名 を指定すると、画面を使わずにスクリプトを実行して終了します。
+* @details -r／-rf ファイル名 を指定すると、画面を使わずに記録したトレースを元の間隔／最速で再生して終了します。
+* @details -k を指定すると、キー入力をBIOSを通さずキーボード割り込みから直接受け取ります。
 */
 int main(int argc, char *argv[]){
+	hal_init();
+	if((argc == 3) && !strcmp(argv[1], "-s")){
+		pit_detect_clock();
+		cpu_type = hal_detect_cpu();
+		return script_main(argv[2]);
+	}
+	if((argc == 3) && (!strcmp(argv[1], "-r") || !strcmp(argv[1], "-rf"))){
+		pit_detect_clock();
+		return replay_main(argv[2], (argv[1][2] != 'f'));
+	}
+	if((argc == 2) && !strcmp(argv[1], "-k")){
+		key_direct = 1;
+	}else if(argc != 1){
+		printf("USAGE: %s [-k] [-s script] [-r|-rf trace]\n", MY_NAME);
+		return SCRIPT_EXIT_ERROR;
+	}
+
 	{//フレーム描画
 		printf("\f");
-		outp(0x0068, 0x04); //テキスト画面 80桁
-		outp(0x0068, 0x07); //font 7x13
-		outp(0x0068, 0x0A); //漢字アクセス可
-		outp(0x0068, 0x0F); //画面表示可
-		uint16_t __far *dst  = (uint16_t __far *)0xA0000000;
-		uint16_t __far *src  = (uint16_t __far *)op_frame;
-		uint16_t __far *attr = (uint16_t __far *)0xA0002000;
-		for(uint16_t index=0; index < (80*23); index++){
-			*dst++ = *src++;
-			*attr++ = (ATTR_COLOR_SKY | ATTR_VISIBLE);
-		}
-
-		VRAM_print("アドレス:    [0x0188]",    ATTR_COLOR_WHITE, 2, 1);
-		VRAM_print("データ16:    [0x----]",    ATTR_COLOR_WHITE, 2, 3);
-		VRAM_print("データ 8:      [0x--]",    ATTR_COLOR_WHITE, 2, 5);
-		VRAM_print("R/W : 8/16 : ADDR : DATA", (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 27, 1);
-		VRAM_print("R/W : 8/16 : ADDR : DATA", (ATTR_COLOR_GREEN | ATTR_UNDERLINE), 54, 1);
-		VRAM_print("　↑　　　　　　　　　　", ATTR_COLOR_WHITE ,1, 7);
-		VRAM_print("←　→　　　　　　　MOVE", ATTR_COLOR_WHITE ,1, 8);
-		VRAM_print("　↓　　　　　　　　　　", ATTR_COLOR_WHITE ,1, 9);
-		VRAM_print("[SHIFT]+[↑]　　数値　UP", ATTR_COLOR_WHITE ,1, 11);
-		VRAM_print("[SHIFT]+[↓]　　数値DOWN", ATTR_COLOR_WHITE ,1, 12);
-		VRAM_print("[SPACE] 　　 8ビット読込", ATTR_COLOR_WHITE ,1, 13);
-		VRAM_print("[SHIFT]+[SPACE] 　　書込", ATTR_COLOR_WHITE ,1, 14);
-		VRAM_print("[RETURN]　　16ビット読込", ATTR_COLOR_WHITE ,1, 15);
-		VRAM_print("[SHIFT]+[RETURN]　　書込", ATTR_COLOR_WHITE ,1, 16);
-		VRAM_print("[ESC] 　　　　　　　終了", ATTR_COLOR_WHITE ,1, 17);
-		VRAM_print("I/O Port manipulator",     ATTR_COLOR_YELLOW ,1, 20);
-		VRAM_print("  Ver 1.01",               ATTR_COLOR_YELLOW ,15, 21);
+		port_out8(0x0068, 0x04); //テキスト画面 80桁
+		port_out8(0x0068, 0x07); //font 7x13
+		port_out8(0x0068, 0x0A); //漢字アクセス可
+		port_out8(0x0068, 0x0F); //画面表示可
+		pit_detect_clock();
+		cpu_type = hal_detect_cpu();
+		reg_index_build();
 	}
 
-	{//メインループ
-		union REGS  regs_param;						//BIOSコールパラメタ
-		union REGS  regs_result;					//BIOSコール戻り値
-
-		regs_param.h.ah = 0x03; 					//指定：キーボードインタフェースの初期化
-		int86( 0x18, &regs_param, &regs_result);	//BIOSコール実行
-
-		disp_log();
-		redraw_digit();
+	if(!log_init()){
+		printf("%s: ログ用のメモリが足りません\n", MY_NAME);
+		return 1;
+	}
 
-		uint8_t alive = 1;
-		while(alive){
+	{//メインループ
+		kb_init();
+		if(key_direct){
+			hal_kb_hook();
+		}
+		draw_main_screen();
 
-			uint8_t kbresult;
-			switch(kbresult = kbread()){
-			case 0x80:	//ESC
-				alive = 0;
-				break;
-			case 0x1C: //RETURN
-				io_read_16bit();
-				break;
-			case 0x9C: //SHIFT + RETURN
-				io_write_16bit();
-				break;
-			case 0x34: //SPACE
-				io_read_8bit();
-				break;
-			case 0xB4: //SHIFT + SPACE
-				io_write_8bit();
-				break;
-			case 0x3A: //UP
-				cursol_up();
-				break;
-			case 0xBA: //SHIFT + UP
-				value_up();
-				break;
-			case 0x3B: //LEFT
-				cursol_left();
-				break;
-			case 0x3C: //RIGHT
-				cursol_right();
-				break;
-			case 0x3D: //DOWN
-				cursol_down();
-				break;
-			case 0xBD: //SHIFT + DOWN
-				value_down();
-				break;
-			default:
-				break;
+		sched_start();
+		sched_alive = 1;
+		while(sched_alive){
+			if(!sched_run()){
+				hal_idle();
 			}
 		}
+		sched_stop();
+		if(key_direct){
+			hal_kb_unhook();
+			kb_init();
+		}
 	}
 
 	return 0;
 
 }
-
-
-
+#endif
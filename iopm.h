@@ -18,15 +18,18 @@ You should have received a copy of the GNU General Public License along with thi
 * @details PC-9801/9821シリーズのI/O Portを自由に読み書きするためのms-dos/freedosプログラムです。
 * @details 
 * @details 注：ファイルは必ずUTF-8で保存すること。コンパイル時にコンパイラ側でUTF-8からSJISに変換します。
-* @details makeを使わずコンパイルはする場合はこう→　ia16-elf-gcc -march=i8086 -mtune=i8086 -mcmodel=small -fexec-charset=CP932 -o iopm.exe iopm.c
+* @details makeを使わずコンパイルはする場合はこう→　ia16-elf-gcc -march=i8086 -mtune=i8086 -mcmodel=small -fexec-charset=CP932 -o iopm.exe iopm.c iopm_dos.c -li86
 */
 
 #define MY_NAME "iopm.exe"
 
 #include <stdio.h>
-#include <conio.h>
-#include <i86.h>
-#include <dos.h>
+#include "iopm_hal.h"
+#include "iopm_sjis.h"
+#include "iopm_trace.h"
+#include "iopm_remote.h"
+#include <stdlib.h>
+#include <string.h>
 
 /// VRAM属性　色：黒
 #define ATTR_COLOR_BLACK   0x00
@@ -55,9 +58,33 @@ You should have received a copy of the GNU General Public License along with thi
 /// VRAM属性　表示
 #define ATTR_VISIBLE       0x01
 
+/// 8253 PIT　カウンタ0
+#define PIT_COUNTER0  0x0071
+/// 8253 PIT　カウンタ2（RS-232Cのボーレート）
+#define PIT_COUNTER2  0x0075
+/// 8253 PIT　モード設定
+#define PIT_CONTROL   0x0077
+/// 8259 PIC（マスタ）　割り込みマスク
+#define PIC_MASTER_IMR 0x0002
+/// 8259 PIC（スレーブ）　割り込みマスク
+#define PIC_SLAVE_IMR  0x000A
+/// PITの入力クロック　5MHz系
+#define PIT_CLOCK_5MHZ 2457600UL
+/// PITの入力クロック　8MHz系
+#define PIT_CLOCK_8MHZ 1996800UL
+
+/// CPU種別の表示名
+static uint8_t *cpu_name[] = {"8086", "V30 ", "186 ", "286+"};
+
  ///数値表示用の文字要素
 uint8_t nible_digit[] = "0123456789ABCDEF";
 
+///ファンクションキーの表示　1個6文字
+static uint8_t *fkey_label[10] = {
+	"BURST ", "SCAN  ", "CAPT  ", "SAVE  ", "REC   ",
+	"PLAY  ", "WATCH ", "W-ADD ", "PATN  ", "SPEED ",
+};
+
 ///デバッグ用カウンタ
 uint16_t degub_cnt  = 0;
 ///数値操作用のアドレス値　初期値はFM音源を指す0x0188
@@ -67,32 +94,753 @@ uint16_t word_digit = 0x55AA;
 ///数値書込用の 8ビット値　初期値は0xA5
 uint8_t  byte_digit = 0xA5;
 
-///ログの1セル分
+/// ログの保持件数　2のべき乗にすること
+#define LOG_CAPACITY   8192
+/// ログ1画面分の件数（2列×20行）
+#define LOG_PAGE       40
+/// ログの属性　書き込み
+#define LOG_FLAG_WRITE 0x01
+/// ログの属性　16ビット
+#define LOG_FLAG_16BIT 0x02
+
+///ログの1件分　ファーメモリに詰めて置くので5バイト
 typedef struct type_logcell {
-	/// 0=無効 2=有効
-	uint8_t avail;
-	/// 0=Read 1=Write
-	uint8_t r_w;
-	/// 0=8bit 1=16bit
-	uint8_t b_w;
-	/// 位置合わせ
-	uint8_t padding;
+	/// LOG_FLAG_WRITE、LOG_FLAG_16BIT
+	uint8_t  flags;
 	/// アドレス
 	uint16_t addr;
 	/// データ
 	uint16_t data;
 } st_logcell;
 
-///次に書き込むログ x
-static uint8_t log_x = 0;
-///次に書き込むログ y
-static uint8_t log_y = 0;
-///最終ログ x
-static uint8_t lastlog_x = 0;
-///最終ログ y
-static uint8_t lastlog_y = 0;
-///ログ格納用領域
-static st_logcell logs[2][20] = {};
+///ログ格納用領域のセグメント　LOG_CAPACITY件のリングバッファ
+static uint16_t log_seg = 0;
+///これまでに記録したログの総数　次に書き込むログの番号でもある
+static uint32_t log_total = 0;
+///表示中のページ　0=最新 1以上=その分だけ過去
+static uint16_t log_scroll = 0;
+///ログ表示　0=サブ画面表示中なので描かない 1=描く
+static uint8_t log_visible = 0;
+///ログの件数表示　0=描き直しが必要 1=表示済み
+static uint8_t log_status_valid = 0;
+
+///PITの入力クロック[Hz]
+static uint32_t pit_clock = PIT_CLOCK_5MHZ;
+///PIT計測開始前の割り込みマスク
+static uint8_t  pit_saved_imr = 0;
+///PITカウンタの前回読み出し値
+static uint16_t pit_last = 0;
+///PIT計測開始からの経過カウント
+static uint32_t pit_ticks = 0;
+
+///スケジューラ　タイマ割り込みの周期[Hz]
+#define SCHED_HZ          1000
+///スケジューラ　キー入力を見る間隔（tick数）
+#define SCHED_KEY_TICKS   10
+///スケジューラ　画面の転送を見る間隔（tick数）
+#define SCHED_FLUSH_TICKS 1
+///スケジューラ　垂直帰線期間を待たずに転送するまでの回数
+#define SCHED_FLUSH_LATE  40
+
+///スケジューラのタスク1個分
+typedef struct type_task {
+	/// 処理
+	void   (*proc)(void);
+	/// 実行する間隔（tick数）
+	uint16_t period;
+	/// 次に実行するtick
+	uint16_t due;
+} st_task;
+
+///スケジューラ　PITカウンタ0の初期値（1tick分のカウント数）　0なら止まっている
+static uint16_t sched_divisor = 0;
+///スケジューラ　開始前の割り込みマスク
+static uint8_t  sched_saved_imr = 0;
+///スケジューラ　0=メインループを抜ける 1=続ける
+static uint8_t  sched_alive = 0;
+///スケジューラ　画面の更新が溜まってから帰線期間を待った回数
+static uint8_t  sched_flush_wait = 0;
+
+///キー入力　スキャンコード　SHIFT
+#define KEY_CODE_SHIFT    0x70
+///キー入力　スキャンコード　CTRL（0x70～0x74がシフト系のキー）
+#define KEY_CODE_CTRL     0x74
+///キー入力　スキャンコード　離した
+#define KEY_CODE_BREAK    0x80
+///キー入力　押し続けているキーが無い
+#define KEY_HELD_NONE     0xFF
+///キー入力　キューの大きさ　2のべき乗にすること
+#define KEY_QUEUE         16
+///キー入力　押してからリピートが始まるまで（tick数）
+#define KEY_REPEAT_DELAY  400
+///キー入力　リピートの最初の間隔（tick数）
+#define KEY_REPEAT_FIRST  80
+///キー入力　リピートの最短の間隔（tick数）
+#define KEY_REPEAT_MIN    10
+///キー入力　リピート1回ごとに間隔を縮める量（tick数）
+#define KEY_REPEAT_STEP   10
+
+///キー入力　0=BIOS(INT 18h) 1=キーボード割り込みから直接（-k）
+static uint8_t  key_direct = 0;
+///キー入力　シフト系のキーの状態　INT 18h AH=02hと同じ並び（bit0=SHIFT bit1=CAPS bit2=カナ bit3=GRPH bit4=CTRL）
+static uint8_t  key_shift_state = 0;
+///キー入力　キュー　上位8ビットがシフト状態、下位8ビットがキーコード
+static uint16_t key_queue[KEY_QUEUE];
+///キー入力　キューの次に書き込む位置
+static uint8_t  key_queue_head = 0;
+///キー入力　キューの次に読む位置
+static uint8_t  key_queue_tail = 0;
+///キー入力　押し続けているキー　KEY_HELD_NONEなら無し
+static uint8_t  key_held = KEY_HELD_NONE;
+///キー入力　次にリピートするtick
+static uint16_t key_repeat_due = 0;
+///キー入力　今のリピートの間隔（tick数）
+static uint16_t key_repeat_gap = 0;
+
+///CPU種別
+static uint8_t  cpu_type = CPU_8086;
+
+///バーストバッファのセグメント　0なら未確保
+static uint16_t burst_seg = 0;
+///バーストバッファの大きさ[byte]
+#define BURST_BUF_SIZE  0x10000UL
+///バーストの1区切りの転送数　PITが一周する前に経過時間を読むため
+#define BURST_CHUNK     512
+///バースト転送数の上限
+#define BURST_MAX       32768U
+///バースト表示の行数
+#define BURST_VIEW_ROWS 18
+///バースト転送数
+static uint16_t burst_count = 256;
+///バースト転送幅　0=8bit 1=16bit
+static uint8_t  burst_width = 0;
+///バースト表示の先頭行
+static uint16_t burst_top = 0;
+///前回のバースト　0=Read 1=Write
+static uint8_t  burst_done_rw = 0;
+///前回のバースト　0=8bit 1=16bit
+static uint8_t  burst_done_width = 0;
+///前回のバースト　転送数　0なら未実行
+static uint16_t burst_done_count = 0;
+///前回のバースト　経過カウント
+static uint32_t burst_ticks = 0;
+
+///スキャンするポート数
+#define SCAN_PORTS      256
+///スキャン結果　2面を交互に使い、前回の掃引と比べる
+static uint8_t  scan_buf[2][SCAN_PORTS];
+///最新の掃引結果の面
+static uint8_t  scan_page = 0;
+///スキャン開始ポート
+static uint16_t scan_base = 0;
+///スキャンのポート間隔
+static uint8_t  scan_stride = 1;
+///掃引回数
+static uint32_t scan_sweeps = 0;
+///0=停止中 1=連続掃引中
+static uint8_t  scan_running = 1;
+
+///キャプチャ　1バッファのサンプル数（1サンプル=時刻+値で4バイト、64KB）
+#define CAP_SAMPLES     16384U
+///キャプチャ　サンプル番号のマスク
+#define CAP_SAMPLE_MASK (CAP_SAMPLES - 1)
+///キャプチャ　キー入力を確認する間隔（サンプル数）
+#define CAP_KEY_CHECK   128
+///キャプチャ　記録する変化点の上限（1件8バイト、64KB）
+#define CAP_EDGE_MAX    8192U
+///キャプチャ　表示行数
+#define CAP_VIEW_ROWS   17
+///BIOSワークエリア　キーバッファの入力数
+#define BIOS_KB_COUNT   ((uint8_t __far *)MK_FP(0x0000, 0x0528))
+
+///キャプチャの変化点1件分
+typedef struct type_edge {
+	/// 最初のサンプルからの経過カウント
+	uint32_t time;
+	/// 変化後の値
+	uint16_t value;
+	/// 変化前の値
+	uint16_t prev;
+} st_edge;
+
+///キャプチャ　サンプルバッファのセグメント　0なら未確保
+static uint16_t cap_seg = 0;
+///キャプチャ　変化点バッファのセグメント　0なら未確保
+static uint16_t cap_edge_seg = 0;
+///キャプチャ　0=8bit 1=16bit
+static uint8_t  cap_width = 0;
+///キャプチャ　0=キーを押すまで連続 1=バッファ1周で停止
+static uint8_t  cap_oneshot = 1;
+///キャプチャ　取ったサンプルの総数
+static uint32_t cap_total = 0;
+///キャプチャ　バッファに残っているサンプル数
+static uint16_t cap_kept = 0;
+///キャプチャ　バッファ内で最も古いサンプル
+static uint16_t cap_oldest = 0;
+///キャプチャ　最初のサンプルの値
+static uint16_t cap_first = 0;
+///キャプチャ　最初から最後のサンプルまでの経過カウント
+static uint32_t cap_span = 0;
+///キャプチャ　変化点の数（記録できなかった分も含む）
+static uint32_t cap_edges = 0;
+///キャプチャ　変化点表示の先頭
+static uint16_t cap_top = 0;
+///キャプチャ　最後にキャプチャしたポート
+static uint16_t cap_port = 0;
+///キャプチャ　最後にキャプチャした幅　0=8bit 1=16bit
+static uint8_t  cap_bits = 0;
+
+///トレース　書き出し用バッファの大きさ（INT 21hでまとめて書く単位）
+#define TRACE_BUF_SIZE  0x4000U
+///トレース　ファイル名を変えて作り直す回数の上限
+#define TRACE_NAME_TRY  100
+
+///トレース　書き出し用バッファのセグメント　0なら未確保
+static uint16_t trace_seg = 0;
+///トレース　バッファに溜まっているバイト数
+static uint16_t trace_fill = 0;
+///トレース　書き出し中のファイルのハンドル
+static uint16_t trace_handle = 0;
+///トレース　0=正常 1=書き込みに失敗した
+static uint8_t  trace_error = 0;
+///トレース　次に試すファイル名の番号
+static uint16_t trace_serial = 0;
+///トレース　最後に作ったファイル名
+static char     trace_name[16] = "";
+
+///記録　レコードの最大数（1セグメントに収まる数）
+#define REC_MAX          9360U
+///再生　控えておく不一致の数
+#define REPLAY_MISS_MAX  12
+///再生　最速再生でPITとキー入力を確かめる間隔（レコード数）
+#define REPLAY_POLL      64
+///再生　結果　未実行
+#define REPLAY_NONE      0
+///再生　結果　最後まで再生した
+#define REPLAY_DONE      1
+///再生　結果　キー入力で中断した
+#define REPLAY_ABORT     2
+
+///記録　レコードのセグメント（トレースファイルのレコードと同じ形式）　0なら未確保
+static uint16_t rec_seg = 0;
+///記録　レコード数（TRACE_FLAG_SKIPのレコードを含む）
+static uint16_t rec_count = 0;
+///記録　0=停止中 1=記録中
+static uint8_t  rec_active = 0;
+///記録　最後に記録した時のスケジューラの時計（sched_clock()）
+static uint32_t rec_stamp = 0;
+///記録　最初の操作から最後の操作までの経過カウント
+static uint32_t rec_span = 0;
+///記録　読み込みの数
+static uint16_t rec_reads = 0;
+///記録　書き込みの数
+static uint16_t rec_writes = 0;
+
+///再生で見つかった不一致1件
+typedef struct type_miss {
+	/// 操作の番号
+	uint16_t number;
+	/// アドレス
+	uint16_t addr;
+	/// 記録した値
+	uint16_t expect;
+	/// 読んだ値
+	uint16_t actual;
+} st_miss;
+
+///再生　REPLAY_NONE、REPLAY_DONE、REPLAY_ABORT
+static uint8_t  replay_result = REPLAY_NONE;
+///再生　0=最速 1=元の間隔
+static uint8_t  replay_timed = 1;
+///再生　実行した操作の数
+static uint16_t replay_ops = 0;
+///再生　読み込みの数
+static uint16_t replay_reads = 0;
+///再生　不一致の数
+static uint16_t replay_misses = 0;
+///再生　かかった時間（PITのカウント数）
+static uint32_t replay_ticks = 0;
+///再生　最初のREPLAY_MISS_MAX件の不一致
+static st_miss  replay_miss[REPLAY_MISS_MAX];
+
+///パターン　種類　ウォーキング1
+#define PAT_WALK1      0
+///パターン　種類　ウォーキング0
+#define PAT_WALK0      1
+///パターン　種類　ランプ（0,1,2…）
+#define PAT_RAMP       2
+///パターン　種類　LFSR疑似乱数
+#define PAT_LFSR       3
+///パターン　種類　一定値（書込用の数値）
+#define PAT_CONST      4
+///パターン　種類の数
+#define PAT_KINDS      5
+///パターン　転送数の上限
+#define PAT_MAX        32768U
+///パターン　ポート範囲の上限
+#define PAT_PORTS_MAX  256
+///パターン　PITが一周する前に経過時間を読む間隔（転送数）
+#define PAT_CHUNK      256
+///パターン　画面に表示する不一致の数
+#define PAT_MISS_MAX   12
+///パターン　I/Oログに残す不一致の数
+#define PAT_LOG_MAX    8
+///パターン　LFSRの初期値
+#define PAT_LFSR_SEED  0xACE1
+///パターン　LFSRのタップ（x^16+x^14+x^13+x^11+1）
+#define PAT_LFSR_TAPS  0xB400
+
+///パターン　種類の表示名
+static uint8_t *pat_name[PAT_KINDS] = {"Walking 1", "Walking 0", "Ramp     ", "LFSR     ", "Constant "};
+
+///パターン　種類　PAT_xxx
+static uint8_t  pat_kind = PAT_WALK1;
+///パターン　転送幅　0=8bit 1=16bit
+static uint8_t  pat_width = 0;
+///パターン　ポートの間隔　1か2
+static uint8_t  pat_stride = 1;
+///パターン　ポート範囲（addr_digitから何ポート分を順に回すか）
+static uint16_t pat_ports = 1;
+///パターン　転送数（書込と読戻しの組の数）
+static uint16_t pat_count = 256;
+///パターン　前回の転送数　0なら未実行
+static uint16_t pat_done_count = 0;
+///パターン　前回の種類
+static uint8_t  pat_done_kind = 0;
+///パターン　前回の幅
+static uint8_t  pat_done_width = 0;
+///パターン　前回の不一致の数
+static uint16_t pat_misses = 0;
+///パターン　前回の経過カウント
+static uint32_t pat_ticks = 0;
+///パターン　最初のPAT_MISS_MAX件の不一致
+static st_miss  pat_miss[PAT_MISS_MAX];
+
+///速度計測　1回の計測でアクセスする回数（8回ずつ展開したループで回す）
+#define SPEED_LOOPS     4096
+///速度計測　同じ計測を繰り返す回数（一番速かった回を採る）
+#define SPEED_PASSES    4
+///速度計測　PITの経過時間を読む間隔（アクセス回数）　1回約100us以内なら一周の27msに収まる
+#define SPEED_CHUNK     256
+#if ((SPEED_LOOPS % SPEED_CHUNK) != 0) || ((SPEED_CHUNK % 8) != 0)
+#error "SPEED_CHUNK must divide SPEED_LOOPS and be a multiple of 8"
+#endif
+///速度計測　比べる基準のポート　マスタPICの割り込みマスク（本体内蔵で待ちが無い）
+#define SPEED_REF_PORT  PIC_MASTER_IMR
+///速度計測　項目　8bit読込
+#define SPEED_IN8       0
+///速度計測　項目　16bit読込
+#define SPEED_IN16      1
+///速度計測　項目　8bit書込
+#define SPEED_OUT8      2
+///速度計測　項目　16bit書込
+#define SPEED_OUT16     3
+///速度計測　項目の数
+#define SPEED_KINDS     4
+
+///速度計測　項目の表示名
+static uint8_t *speed_name[SPEED_KINDS] = {"R  8bit inp  ", "R 16bit inpw ", "W  8bit outp ", "W 16bit outpw"};
+
+///速度計測　計測したポート
+static uint16_t speed_port = 0;
+///速度計測　SPEED_LOOPS回分の経過カウント　[0]=計測したポート [1]=基準のポート　0なら未計測
+static uint32_t speed_ticks[2][SPEED_KINDS];
+
+///メモリ表示　1画面のバイト数
+#define MEM_VIEW_BYTES  256
+///メモリ表示　1行のバイト数
+#define MEM_ROW_BYTES   16
+///メモリ表示　行数
+#define MEM_VIEW_ROWS   (MEM_VIEW_BYTES / MEM_ROW_BYTES)
+
+///メモリ表示　セグメント　初期値は拡張ボードのROM/RAMが来るC000h
+static uint16_t mem_seg = 0xC000;
+///メモリ表示　オフセット　書き込み先でもある
+static uint16_t mem_off = 0x0000;
+///メモリ表示　カーソル位置　0～3=セグメントの桁 4～7=オフセットの桁
+static uint8_t  mem_cursol = 0;
+///メモリ表示　0=キーを押した時だけ読む 1=垂直帰線ごとに読む
+static uint8_t  mem_auto = 1;
+///メモリ表示　前回見た時のGDCのVSYNCビット
+static uint8_t  mem_vsync = 0;
+///メモリ表示　読み取った内容（1回のブロック転送で取る）
+static uint16_t mem_view[MEM_VIEW_BYTES / 2];
+///メモリ表示　前回表示した内容
+static uint16_t mem_shown[MEM_VIEW_BYTES / 2];
+
+///インデックス　レジスタの数
+#define IDX_REGS        256
+///インデックス　データポートはインデックスポートのいくつ後か
+#define IDX_DATA_GAP    2
+///インデックス　待ちに使うポート（書くと約0.6us待つ）
+#define IDX_WAIT_PORT   0x005F
+
+///インデックス　インデックスポート
+static uint16_t idx_port = 0x0188;
+///インデックス　カーソル位置（レジスタ番号）
+static uint8_t  idx_cursol = 0;
+///インデックス　インデックスを書いてからデータポートに触るまでの待ち（IDX_WAIT_PORTへの書込回数）
+static uint8_t  idx_wait_addr = 4;
+///インデックス　データを書いてから次に触るまでの待ち（IDX_WAIT_PORTへの書込回数）
+static uint8_t  idx_wait_data = 20;
+///インデックス　ROLLで変える待ち　0=idx_wait_addr 1=idx_wait_data
+static uint8_t  idx_wait_sel = 0;
+///インデックス　一括読込の結果　2面を交互に使い、前回と比べる
+static uint8_t  idx_regs[2][IDX_REGS];
+///インデックス　最新の面
+static uint8_t  idx_page = 0;
+///インデックス　一括読込した回数（2回目から変化を表示する）
+static uint32_t idx_dumps = 0;
+///インデックス　一括読込にかかった経過カウント
+static uint32_t idx_ticks = 0;
+
+///割り込み監視　到着間隔の分布の区間数
+#define IRQ_BINS        8
+///割り込み監視　回数/秒と経過の表示を更新する間隔[ms]
+#define IRQ_REFRESH_MS  500
+
+///割り込み監視　IRQの表示名
+static const char *irq_name[HAL_IRQ_LINES] = {
+	"TIMR", "KEY",  "VSYN",  "INT0",  "232C", "INT1", "INT2", "SLV",
+	"IR8",  "INT3", "INT41", "INT42", "INT5", "INT6", "IR14", "IR15",
+};
+///割り込み監視　到着間隔の区間の上限[us]　最後の区間は上限なし
+static const uint32_t irq_bin_us[IRQ_BINS - 1] = {100, 300, 1000, 3000, 10000, 30000, 100000};
+///割り込み監視　到着間隔の区間の見出し
+static const char *irq_bin_label[IRQ_BINS] = {"100u", "300u", "  1m", "  3m", " 10m", " 30m", "100m", "OVER"};
+///割り込み監視　到着間隔の区間の上限（PITのカウント数）　irq_clear()でirq_bin_usから求める
+static uint32_t irq_bin_limit[IRQ_BINS - 1];
+///割り込み監視　IRQごとの最後の割り込みの時刻（sched_clock()と同じPITのカウント数）
+static uint32_t irq_last_time[HAL_IRQ_LINES];
+///割り込み監視　IRQごとに一度でも割り込みがあったか
+static uint8_t  irq_seen[HAL_IRQ_LINES];
+///割り込み監視　IRQごとの到着間隔の分布
+static uint32_t irq_hist[HAL_IRQ_LINES][IRQ_BINS];
+///割り込み監視　IRQごとの回数/秒（前回の更新からの平均）
+static uint32_t irq_rate[HAL_IRQ_LINES];
+///割り込み監視　前回の更新の時のIRQごとの回数
+static uint32_t irq_rate_base[HAL_IRQ_LINES];
+///割り込み監視　前回の更新の時刻（hal_tick_count()）
+static uint32_t irq_refresh_tick = 0;
+///割り込み監視　監視を始めた時刻（hal_tick_count()）
+static uint32_t irq_start_tick = 0;
+
+/// 8237 DMAC　ステータス（読み）　bit0～3=TC bit4～7=要求
+#define DMA_STATUS      0x0011
+/// 8237 DMAC　リクエスト
+#define DMA_REQUEST     0x0013
+/// 8237 DMAC　シングルマスク
+#define DMA_MASK        0x0015
+/// 8237 DMAC　モード
+#define DMA_MODE        0x0017
+/// 8237 DMAC　バイトポインタのフリップフロップのクリア
+#define DMA_CLEAR_FF    0x0019
+///DMA　バッファの大きさ　同じ大きさの境界に置くので64KB境界をまたがない
+#define DMA_BUF_SIZE    0x4000UL
+///DMA　ダンプの行数
+#define DMA_VIEW_ROWS   18
+///DMA　カウントが進まなくなってから打ち切るまで[ms]
+#define DMA_IDLE_MS     50
+///DMA　拡張ボード用のチャネル　他は本体のHDD、FDDが使うので、転送の前に確認する
+#define DMA_BOARD_CH    1
+
+///DMA　チャネルごとのアドレスポート（カウントはその2つ後）
+static const uint16_t dma_addr_port[4] = {0x0001, 0x0005, 0x0009, 0x000D};
+///DMA　チャネルごとのバンク（A16～A19）ポート
+static const uint16_t dma_bank_port[4] = {0x0027, 0x0021, 0x0023, 0x0025};
+///DMA　転送モードのモードレジスタのビット（シングル、デマンド、ブロック）
+static const uint8_t  dma_mode_bits[3] = {0x40, 0x00, 0x80};
+///DMA　転送モードの表示名
+static const char    *dma_mode_name[3] = {"SINGLE", "DEMAND", "BLOCK "};
+///DMA　確保したメモリのセグメント
+static uint16_t dma_alloc = 0;
+///DMA　バッファのセグメント（確保したメモリの中でDMA_BUF_SIZE境界に合わせた所）
+static uint16_t dma_seg = 0;
+///DMA　チャネル　2、3はFDDが使う
+static uint8_t  dma_channel = 1;
+///DMA　向き　0=ポート→メモリ（ライト転送） 1=メモリ→ポート（リード転送）
+static uint8_t  dma_dir = 0;
+///DMA　転送モード　dma_mode_bitsの番号
+static uint8_t  dma_mode_sel = 0;
+///DMA　転送数（バイト）
+static uint16_t dma_count = 256;
+///DMA　S+↑↓で変える項目　0=チャネル 1=向き 2=転送モード 3=転送数
+static uint8_t  dma_field = 0;
+///DMA　ダンプの先頭行
+static uint16_t dma_top = 0;
+///DMA　前回の転送数（0=まだ）
+static uint16_t dma_done_count = 0;
+///DMA　前回転送できたバイト数
+static uint16_t dma_done = 0;
+///DMA　前回ターミナルカウントに達したか
+static uint8_t  dma_done_tc = 0;
+///DMA　前回の結果　キー入力で中断した
+static uint8_t  dma_done_abort = 0;
+///DMA　転送してよいと確認した本体用のチャネル（0xFF=無し）　チャネルを変えると取り消す
+static uint8_t  dma_confirmed = 0xFF;
+///DMA　前回の向き
+static uint8_t  dma_done_dir = 0;
+///DMA　前回の経過カウント
+static uint32_t dma_ticks = 0;
+
+///条件待ち　カーソルで変える16進の桁数（書込ポート4、書込値2、読込ポート4、マスク2、期待値2）
+#define COND_DIGITS     14
+///条件待ち　待ち時間の分布の区間数
+#define COND_BINS       8
+///条件待ち　上限時間の最大[ms]
+#define COND_TIMEOUT_MAX 4096
+///条件待ち　分布の棒の最大長
+#define COND_BAR_WIDTH  40
+
+///条件待ち　カーソルの桁の表示位置
+static const uint8_t  cond_digit_x[COND_DIGITS] = {7, 8, 9, 10, 13, 14, 23, 24, 25, 26, 30, 31, 37, 38};
+///条件待ち　HOMEで切り替える試行回数
+static const uint16_t cond_trial_list[4] = {1, 10, 100, 1000};
+///条件待ち　待ち時間の区間の上限[us]　最後の区間は上限時間まで
+static const uint32_t cond_bin_us[COND_BINS - 1] = {10, 30, 100, 300, 1000, 3000, 10000};
+///条件待ち　待ち時間の区間の見出し
+static const char    *cond_bin_label[COND_BINS] = {" ～10us", " ～30us", "～100us", "～300us", "  ～1ms", "  ～3ms", " ～10ms", "10ms～ "};
+///条件待ち　書き込むポート
+static uint16_t cond_port_w = 0x0188;
+///条件待ち　書き込む値
+static uint8_t  cond_value = 0x00;
+///条件待ち　読むポート
+static uint16_t cond_port_r = 0x0188;
+///条件待ち　読んだ値にかけるマスク
+static uint8_t  cond_mask = 0x80;
+///条件待ち　マスクした値がこれになったら成立
+static uint8_t  cond_expect = 0x00;
+///条件待ち　上限時間[ms]
+static uint16_t cond_timeout = 10;
+///条件待ち　1回で行う試行回数（cond_trial_listの番号）
+static uint8_t  cond_trial_sel = 2;
+///条件待ち　カーソル位置（16進の桁）
+static uint8_t  cond_cursol = 0;
+///条件待ち　区間の上限（PITのカウント数）　cond_clear()でcond_bin_usから求める
+static uint32_t cond_bin_limit[COND_BINS - 1];
+///条件待ち　区間ごとの成立回数
+static uint32_t cond_hist[COND_BINS];
+///条件待ち　試行回数
+static uint32_t cond_runs = 0;
+///条件待ち　上限時間までに成立しなかった回数
+static uint32_t cond_timeouts = 0;
+///条件待ち　成立までのカウント数の最小
+static uint32_t cond_min = 0;
+///条件待ち　成立までのカウント数の最大
+static uint32_t cond_max = 0;
+///条件待ち　成立までのカウント数の合計
+static unsigned long long cond_sum = 0;
+///条件待ち　最後の試行の経過カウント
+static uint32_t cond_last_ticks = 0;
+///条件待ち　最後の試行で読んだ値
+static uint8_t  cond_last_value = 0;
+///条件待ち　最後の試行で読んだ回数
+static uint32_t cond_last_polls = 0;
+///条件待ち　最後の試行で成立したか
+static uint8_t  cond_last_hit = 0;
+///条件待ち　最後に試行した回数
+static uint16_t cond_last_done = 0;
+///条件待ち　最後の試行をキー入力で中断したか
+static uint8_t  cond_aborted = 0;
+
+/// 8251 RS-232C　データ
+#define RS_DATA         0x0030
+/// 8251 RS-232C　モード/コマンド（書き）、ステータス（読み）
+#define RS_CONTROL      0x0032
+/// 8251 RS-232C　ステータス　送信可
+#define RS_TXRDY        0x01
+/// 8251 RS-232C　ステータス　受信あり
+#define RS_RXRDY        0x02
+/// 8251 RS-232C　ステータス　パリティ、オーバーラン、フレーミングエラー
+#define RS_ERRORS       0x38
+/// 8251 RS-232C　モード　非同期x16 8ビット パリティなし ストップ1
+#define RS_MODE         0x4E
+/// 8251 RS-232C　コマンド　送受信許可、DTR、RTS、エラーリセット
+#define RS_COMMAND      0x37
+/// 8251 RS-232C　コマンド　RS_COMMANDからRTSを抜いたもの（相手の送信を止めておく）
+#define RS_COMMAND_HOLD 0x17
+/// 8251 RS-232C　コマンド　内部リセット
+#define RS_RESET        0x40
+/// システムポートC（8255）　読み
+#define SYS_PORTC_READ  0x0035
+/// システムポートC（8255）　ビットごとのセット/リセット
+#define SYS_PORTC_SET   0x0037
+/// システムポートC　RS-232Cの割り込み許可（bit0 RXRE、bit1 TXEE、bit2 TXRE）
+#define SYS_RS_INT_BITS 0x07
+///リモート　画面に入る前の速度を推定するためにPITカウンタ2を読む回数
+#define REMOTE_PIT_SAMPLES 1024
+///リモート　フレームの途中でバイトが途切れたら捨てるまで[ms]
+#define REMOTE_BYTE_MS  200
+///リモート　8251に続けて書く時の待ち（IDX_WAIT_PORTへの書込回数）
+#define REMOTE_RS_WAIT  8
+///リモート　RTSを上げてSOFを待つ時間[ms]　来なければRTSを落としてキーと画面を見る
+#define REMOTE_LISTEN_MS 20
+///リモート　フレームが続く間に画面を更新する間隔[ms]（回線が空けばすぐ更新する）
+#define REMOTE_REDRAW_MS 500
+
+///リモート　コマンドごとの引数のバイト数（連続書込はこの後に回数分の値が続く）
+static const uint8_t  remote_arg_size[8]    = {0, 2, 2, 3, 4, 4, 4, 6};
+///リモート　コマンドごとの結果のバイト数（連続読込は回数分）
+static const uint8_t  remote_result_size[8] = {6, 1, 2, 0, 0, 0, 0, 6};
+///リモート　応答の状態の表示名
+static const char    *remote_status_name[4] = {"正常        ", "チェック違い", "コマンド誤り", "応答あふれ  "};
+///リモート　選べる通信速度[bps]
+static const uint16_t remote_baud_list[5] = {2400, 4800, 9600, 19200, 38400};
+///リモート　通信速度（remote_baud_listの番号）
+static uint8_t  remote_baud_sel = 2;
+///リモート　画面に入る前の速度を戻す時の候補[bps]
+static const uint16_t remote_std_baud[10] = {75, 150, 300, 600, 1200, 2400, 4800, 9600, 19200, 38400};
+///リモート　画面に入る前のシステムポートCの割り込み許可ビット
+static uint8_t  remote_saved_portc = 0;
+///リモート　画面に入る前のPITカウンタ2の分周比（0=分からないので戻さない）
+static uint16_t remote_saved_divisor = 0;
+///リモート　要求と応答のバッファのセグメント　要求は先頭、応答はREMOTE_FRAME_MAX+REMOTE_FRAME_EXTRAから
+static uint16_t remote_seg = 0;
+///リモート　受け取ったフレーム数
+static uint32_t remote_frames = 0;
+///リモート　実行したコマンド数
+static uint32_t remote_commands = 0;
+///リモート　エラー数（チェック違い、途切れ、受信エラー、実行エラー）
+static uint32_t remote_errors = 0;
+///リモート　受信バイト数
+static uint32_t remote_rx_bytes = 0;
+///リモート　送信バイト数
+static uint32_t remote_tx_bytes = 0;
+///リモート　最後のフレームのSEQ
+static uint8_t  remote_last_seq = 0;
+///リモート　最後のフレームの状態
+static uint8_t  remote_last_status = REMOTE_OK;
+///リモート　最後のフレームで実行したコマンド数
+static uint16_t remote_last_done = 0;
+///リモート　最後のフレームの処理にかかった時間[ms]（受信の始めから送信の終わりまで）
+static uint32_t remote_last_ms = 0;
+
+///スナップショット　一度に取れる最大ポート数
+#define SNAP_PORTS_MAX  65536UL
+///スナップショット　一覧に覚える変化の最大数
+#define SNAP_LIST_MAX   1024
+///スナップショット　一覧の列数
+#define SNAP_LIST_COLS  4
+///スナップショット　一覧の行数
+#define SNAP_LIST_ROWS  17
+///スナップショット　PITを読む間隔（ポート数／ワード数）
+#define SNAP_CHUNK      1024
+///スナップショット　状態　未取得
+#define SNAP_NONE       0
+///スナップショット　状態　変化前を取った
+#define SNAP_BEFORE     1
+///スナップショット　状態　変化後を取って比較した
+#define SNAP_COMPARED   2
+
+///スナップショット　ファーバッファのセグメント　[0]=変化前 [1]=変化後　0なら未確保
+static uint16_t snap_seg[2] = {0, 0};
+///スナップショット　取るポート数　16～65536の2のべき乗
+static uint32_t snap_ports = 256;
+///スナップショット　変化前を取った時の先頭ポート
+static uint16_t snap_base = 0;
+///スナップショット　変化前を取った時のポート数
+static uint32_t snap_done_ports = 0;
+///スナップショット　状態 SNAP_xxx
+static uint8_t  snap_state = SNAP_NONE;
+///スナップショット　変化したポート（先頭からの番号）
+static uint16_t snap_list[SNAP_LIST_MAX];
+///スナップショット　変化したポートの数（一覧に入りきらない分も数える）
+static uint32_t snap_diffs = 0;
+///スナップショット　一覧の表示開始位置
+static uint16_t snap_top = 0;
+///スナップショット　変化後の読み込みにかかった経過カウント
+static uint32_t snap_read_ticks = 0;
+///スナップショット　比較にかかった経過カウント
+static uint32_t snap_cmp_ticks = 0;
+
+///ウォッチ　登録できるポートの数
+#define WATCH_MAX            16
+///ウォッチ　ポートを読む間隔（tick数）
+#define WATCH_POLL_TICKS     1
+///ウォッチ　表示を更新する間隔（tick数）
+#define WATCH_REFRESH_TICKS  66
+///ウォッチ　変化したポートを反転表示しておく長さ（表示更新の回数）
+#define WATCH_HOLD_COUNT     8
+
+///ウォッチするポート1個分
+typedef struct type_watch {
+	/// アドレス
+	uint16_t addr;
+	/// 0=8bit 1=16bit
+	uint8_t  b_w;
+	/// 反転表示の残り（表示更新の回数）
+	uint8_t  hold;
+	/// 今の値
+	uint16_t value;
+	/// 変化する前の値
+	uint16_t prev;
+	/// 変化した回数
+	uint32_t changes;
+	/// 1=表示を更新する必要がある
+	uint8_t  dirty;
+} st_watch;
+
+///ウォッチ　登録したポート
+static st_watch watch_list[WATCH_MAX];
+///ウォッチ　登録した数
+static uint8_t  watch_count = 0;
+///ウォッチ　0=右側にログを表示 1=右側にウォッチを表示
+static uint8_t  watch_visible = 0;
+///ウォッチ　全ポートを読んだ回数
+static uint32_t watch_sweeps = 0;
+
+///スクリプト　命令の最大数
+#define SCRIPT_MAX_OPS   512
+///スクリプト　loopの最大入れ子
+#define SCRIPT_MAX_DEPTH 8
+///スクリプト　1行の最大長
+#define SCRIPT_LINE_MAX  128
+///スクリプト　終了コード　全て成功
+#define SCRIPT_EXIT_OK    0
+///スクリプト　終了コード　expect不一致あり
+#define SCRIPT_EXIT_NG    1
+///スクリプト　終了コード　ファイルや書式の誤り
+#define SCRIPT_EXIT_ERROR 2
+
+///スクリプト命令　8ビット読み込み
+#define OP_READ8     0
+///スクリプト命令　16ビット読み込み
+#define OP_READ16    1
+///スクリプト命令　8ビット書き込み
+#define OP_WRITE8    2
+///スクリプト命令　16ビット書き込み
+#define OP_WRITE16   3
+///スクリプト命令　8ビット読み込みと比較
+#define OP_EXPECT8   4
+///スクリプト命令　16ビット読み込みと比較
+#define OP_EXPECT16  5
+///スクリプト命令　待ち
+#define OP_WAIT      6
+///スクリプト命令　繰り返し開始
+#define OP_LOOP      7
+///スクリプト命令　繰り返し終端
+#define OP_END       8
+
+///スクリプトの命令1個分
+typedef struct type_op {
+	/// 命令 OP_xxx
+	uint8_t  code;
+	/// 位置合わせ
+	uint8_t  padding;
+	/// ポート　loopとendでは対になる命令の番号
+	uint16_t addr;
+	/// 書き込む値、比較する値、繰り返し回数　waitではPITカウント数の下位
+	uint16_t data;
+	/// 比較マスク　waitではPITカウント数の上位
+	uint16_t mask;
+	/// スクリプトの行番号
+	uint16_t line;
+} st_op;
+
+///スクリプト　命令列
+static st_op    script_ops[SCRIPT_MAX_OPS];
+///スクリプト　命令数
+static uint16_t script_count = 0;
 
 ///数値操作用カーソル　x
 static uint8_t cursol_x = 0;
@@ -100,208 +848,141 @@ static uint8_t cursol_x = 0;
 static uint8_t cursol_y = 0;
 
 ///バーチャルカーソル　x
-volatile uint16_t vposx = 0;
+static uint16_t vposx = 0;
 ///バーチャルカーソル　y
-volatile uint16_t vposy = 0;
-
-///メイン画面
-static uint16_t op_frame[] = {
-	0x009C,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	 0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	  0x0095,0x0095,0x0095,0x0095,0x0095,0x0091,0x0095,0x0095,0x0095,0x0095,
-	   0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	    0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	     0x0095,0x0095,0x0091,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	      0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	       0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x009D,
-
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-
-	0x0093,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	 0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	  0x0095,0x0095,0x0095,0x0095,0x0095,0x0092,0x0000,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	       	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	       	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	       	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-/*
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-*/
-	0x0093,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	 0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	  0x0095,0x0095,0x0095,0x0095,0x0095,0x0092,0x0000,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	 0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	  0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,
-	   0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	    0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	     0x0020,0x0020,0x0096,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	      0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,
-	       0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0020,0x0096,
-	0x009E,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	 0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	  0x0095,0x0095,0x0095,0x0095,0x0095,0x0090,0x0095,0x0095,0x0095,0x0095,
-	   0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	    0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	     0x0095,0x0095,0x0090,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	      0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,
-	       0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x0095,0x009F,
+static uint16_t vposy = 0;
+
+/// テキストVRAM　桁数
+#define TVRAM_WIDTH   80
+/// テキストVRAM　行数
+#define TVRAM_HEIGHT  25
+/// テキストVRAM　セル数
+#define TVRAM_CELLS   (TVRAM_WIDTH * TVRAM_HEIGHT)
+/// テキストVRAM　文字コード領域
+#define TVRAM_CODE    ((uint16_t __far *)MK_FP(0xA000, 0x0000))
+/// テキストVRAM　属性領域
+#define TVRAM_ATTR    ((uint16_t __far *)MK_FP(0xA200, 0x0000))
+/// GDCステータスポート（テキスト側）
+#define GDC_STATUS    0x0060
+/// GDCステータス　垂直帰線期間中
+#define GDC_VSYNC     0x20
+
+///シャドウVRAM　文字コード
+static uint16_t shadow_code[TVRAM_CELLS];
+///シャドウVRAM　属性
+static uint16_t shadow_attr[TVRAM_CELLS];
+///行ごとの更新範囲　先頭桁
+static uint8_t  dirty_x0[TVRAM_HEIGHT];
+///行ごとの更新範囲　終端桁+1　0なら更新なし
+static uint8_t  dirty_x1[TVRAM_HEIGHT];
+///更新範囲を持つ行の数
+static uint8_t  dirty_rows = 0;
+
+///変換済み固定文字列の1個分
+typedef struct type_ui_label {
+	/// ｘ
+	uint8_t  x;
+	/// ｙ
+	uint8_t  y;
+	/// 属性
+	uint8_t  attr;
+	/// セル数
+	uint8_t  len;
+	/// ui_cells[]の中の位置
+	uint16_t offset;
+} st_ui_label;
+
+///変換済み固定文字列（iopm_ui.hからビルド時に生成）
+#include "iopm_cells.h"
+
+///画面の描画リスト　命令　矩形をcellで埋める
+#define FRAME_FILL  0
+///画面の描画リスト　命令　矩形の外周に罫線の枠を描く（cellは使わない）
+#define FRAME_BOX   1
+///画面の描画リスト　命令　終わり
+#define FRAME_END   2
+
+///画面の描画リストの1命令
+typedef struct type_frame {
+	/// 命令 FRAME_xxx
+	uint8_t code;
+	/// 埋める文字（半角1バイト）
+	uint8_t cell;
+	/// 属性
+	uint8_t attr;
+	/// 左上ｘ
+	uint8_t x;
+	/// 左上ｙ
+	uint8_t y;
+	/// 幅
+	uint8_t w;
+	/// 高さ
+	uint8_t h;
+} st_frame;
+
+///メイン画面の枠　左から設定欄、ログ左列、ログ右列の3区画。設定欄は6行目と19行目で仕切る
+static const st_frame frame_main[] = {
+	{FRAME_FILL, 0x20, ATTR_COLOR_SKY,  0,  0, 80, 23},
+	{FRAME_BOX,  0x00, ATTR_COLOR_SKY,  0,  0, 80, 23},
+	{FRAME_FILL, 0x96, ATTR_COLOR_SKY, 25,  1,  1, 21},
+	{FRAME_FILL, 0x96, ATTR_COLOR_SKY, 52,  1,  1, 21},
+	{FRAME_FILL, 0x91, ATTR_COLOR_SKY, 25,  0,  1,  1},
+	{FRAME_FILL, 0x91, ATTR_COLOR_SKY, 52,  0,  1,  1},
+	{FRAME_FILL, 0x90, ATTR_COLOR_SKY, 25, 22,  1,  1},
+	{FRAME_FILL, 0x90, ATTR_COLOR_SKY, 52, 22,  1,  1},
+	{FRAME_FILL, 0x95, ATTR_COLOR_SKY,  1,  6, 24,  1},
+	{FRAME_FILL, 0x95, ATTR_COLOR_SKY,  1, 19, 24,  1},
+	{FRAME_FILL, 0x93, ATTR_COLOR_SKY,  0,  6,  1,  1},
+	{FRAME_FILL, 0x93, ATTR_COLOR_SKY,  0, 19,  1,  1},
+	{FRAME_FILL, 0x92, ATTR_COLOR_SKY, 25,  6,  1,  1},
+	{FRAME_FILL, 0x92, ATTR_COLOR_SKY, 25, 19,  1,  1},
+	{FRAME_END,  0x00, 0,               0,  0,  0,  0},
+};
+
+///サブ画面の枠　全面を消して外枠だけ描く
+static const st_frame frame_sub[] = {
+	{FRAME_FILL, 0x20, ATTR_COLOR_WHITE, 0,  0, 80, 25},
+	{FRAME_BOX,  0x00, ATTR_COLOR_SKY,   0,  0, 80, 24},
+	{FRAME_END,  0x00, 0,                0,  0,  0,  0},
 };
 
+///レジスタ定義の1個分
+typedef struct type_reg {
+	/// ポート
+	uint16_t    port;
+	/// 名前（最大REG_NAME_LEN文字）
+	const char *name;
+	/// ビット欄　"名前:ビット"か"名前:上位-下位"を空白区切りで上位から
+	const char *fields;
+} st_reg;
+
+///ボードのレジスタ定義（REG_LIST）
+#include "iopm_regs.h"
+
+///レジスタ定義　iopm_regs.hのREG_LISTを展開したもの
+#define REG(port, name, fields) {port, name, fields},
+static const st_reg reg_list[] = {
+	REG_LIST
+};
+#undef REG
+
+///レジスタ定義　数（索引に1バイトで入れるので255まで）
+#define REG_COUNT       (sizeof(reg_list) / sizeof(reg_list[0]))
+///レジスタ定義　名前の最大長
+#define REG_NAME_LEN    10
+///レジスタ索引　持てるページ（256ポート単位）の数
+#define REG_PAGES_MAX   8
+
+///レジスタ索引　ポートの上位8ビットごとのページ番号+1　0ならそのページにレジスタは無い
+static uint8_t  reg_page[256];
+///レジスタ索引　ページ内のポートごとのreg_list[]の番号+1　0なら未登録
+static uint8_t  reg_slot[REG_PAGES_MAX][256];
+///レジスタ索引　使っているページ数
+static uint8_t  reg_pages = 0;
+///レジスタ名表示　0=数値だけ 1=ログとウォッチに名前、最下行にビット欄を出す
+static uint8_t  reg_names = 0;
+///レジスタ名表示　最下行に出したログの件数
+static uint32_t reg_shown_total = 0;
+///レジスタ名表示　0=最下行を描き直す
+static uint8_t  reg_line_valid = 0;
+
@@ -0,0 +1,310 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+//-------------------------------------------------------------------------
+/**
+* @file iopm_bench.c
+* @brief iopm 描画・ログ処理のベンチマーク（Linux上の模擬環境用）
+* @author antarcticlion
+* @date 17Oct2026
+* @details 'make bench'でビルドして実行する。iopm.cをmain()抜きで取り込み、描画とログの関数を繰り返し呼んで
+* @details 1回あたりの時間[ns]とテキストVRAMへの書き込みセル数を表示する。
+* @details
+* @details 引数に基準ファイルを渡すと比較する。セル数が基準より増えたもの、時間が基準の2倍を超えたものを
+* @details 劣化として表示し、終了コード1を返す。セル数は模擬環境では毎回同じになるので、こちらが主な判定になる。
+* @details 基準ファイルは 'make bench-baseline' で作り直す。
+*/
+//-------------------------------------------------------------------------
+
+#define IOPM_NO_MAIN
+#include "iopm.c"
+
+#include <time.h>
+
+/// 基準に対して時間が何倍を超えたら劣化とするか
+#define BENCH_TIME_LIMIT 2.0
+/// 項目名の最大長
+#define BENCH_NAME_MAX   32
+
+///ベンチマークの1項目
+typedef struct type_bench {
+	/// 項目名
+	const char *name;
+	/// 繰り返し回数
+	uint32_t    loops;
+	/// 1回分の処理
+	void      (*proc)(uint32_t count);
+} st_bench;
+
+///最適化で消されないように結果を捨てる先
+static volatile uint32_t bench_sink = 0;
+
+//-------------------------------------------------------------------------
+/**
+* @brief byte_str()
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+static void bench_byte_str(uint32_t count){
+	bench_sink += byte_str((uint8_t)count);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief word_str()
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+static void bench_word_str(uint32_t count){
+	bench_sink += word_str((uint16_t)count);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief SJIS_to_VRAM()
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details 1バイト目0x88～0x9F、2バイト目0x40～0xFCを順に回す。
+*/
+static void bench_sjis_to_vram(uint32_t count){
+	bench_sink += SJIS_to_VRAM((uint8_t)(0x88 + (count % 24)), (uint8_t)(0x40 + (count % 189)));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief VRAM_print() 半角、毎回属性を変えて全セルを書き換える
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+static void bench_print_ascii(uint32_t count){
+	VRAM_print("R/W : 8/16 : ADDR : DATA", ((count & 1) ? ATTR_COLOR_YELLOW : ATTR_COLOR_WHITE), 27, 1);
+	screen_flush();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief VRAM_print() 全角、毎回属性を変えて全セルを書き換える
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+static void bench_print_sjis(uint32_t count){
+	VRAM_print("[SHIFT]+[↑]　　数値　UP", ((count & 1) ? ATTR_COLOR_YELLOW : ATTR_COLOR_WHITE), 1, 11);
+	screen_flush();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief VRAM_print() 同じ内容の描き直し
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+static void bench_print_same(uint32_t count){
+	VRAM_print("[SHIFT]+[↑]　　数値　UP", ATTR_COLOR_WHITE, 1, 11);
+	screen_flush();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief disp_log() ログに変化なし
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+static void bench_disp_log(uint32_t count){
+	disp_log();
+	screen_flush();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief logger() 毎回違うアドレスとデータで1件追加する
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details メインループで1回読み書きした時と同じ処理量になる。
+*/
+static void bench_logger(uint32_t count){
+	logger((uint8_t)(count & 1), (uint8_t)((count >> 1) & 1), (uint16_t)count, (uint16_t)(count * 7));
+	screen_flush();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief redraw_digit() アドレスを1つずつ上げる
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details SHIFT+↑を押し続けた時と同じ処理量になる。
+*/
+static void bench_redraw_digit(uint32_t count){
+	addr_digit = (uint16_t)count;
+	redraw_digit();
+	screen_flush();
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief disp_log() レジスタ名表示、ログに変化なし
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+static void bench_disp_log_names(uint32_t count){
+	reg_names = 1;
+	disp_log();
+	screen_flush();
+	reg_names = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief logger() レジスタ名表示、毎回違うアドレスとデータで1件追加する
+* @param[in] 繰り返しの番号
+* @param[out] 無し
+* @return 無し
+* @details 最下行のビット欄も毎回描き直しになる。アドレスはレジスタ定義のある0000h～00FFhを回す。
+*/
+static void bench_logger_names(uint32_t count){
+	reg_names = 1;
+	logger((uint8_t)(count & 1), (uint8_t)((count >> 1) & 1), (uint16_t)(count & 0xFF), (uint16_t)(count * 7));
+	screen_flush();
+	reg_names = 0;
+}
+
+///ベンチマークの項目
+static const st_bench bench_list[] = {
+	{"byte_str",           10000000, bench_byte_str},
+	{"word_str",           10000000, bench_word_str},
+	{"SJIS_to_VRAM",       10000000, bench_sjis_to_vram},
+	{"VRAM_print_ascii",     200000, bench_print_ascii},
+	{"VRAM_print_sjis",      200000, bench_print_sjis},
+	{"VRAM_print_same",      200000, bench_print_same},
+	{"disp_log",              50000, bench_disp_log},
+	{"logger",                50000, bench_logger},
+	{"redraw_digit",         200000, bench_redraw_digit},
+	{"disp_log_names",        50000, bench_disp_log_names},
+	{"logger_names",          50000, bench_logger_names},
+};
+
+//-------------------------------------------------------------------------
+/**
+* @brief 経過時間[ns]
+* @param[in] 開始時刻
+* @param[out] 無し
+* @return 経過時間[ns]
+* @details
+*/
+static double bench_elapsed(const struct timespec *start){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((double)(now.tv_sec - start->tv_sec) * 1e9) + (double)(now.tv_nsec - start->tv_nsec);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 基準ファイルから1項目の値を探す
+* @param[in] 基準ファイル、項目名
+* @param[out] 時間[ns]、セル数
+* @return 1=見つかった 0=無い
+* @details 基準ファイルは「項目名 時間 セル数」の行の並び。#で始まる行はコメント。
+*/
+static int bench_baseline(FILE *fp, const char *name, double *ns, double *cells){
+	char line[128];
+	char key[BENCH_NAME_MAX + 1];
+
+	rewind(fp);
+	while(fgets(line, sizeof(line), fp) != NULL){
+		if((line[0] == '#') || (sscanf(line, "%32s %lf %lf", key, ns, cells) != 3)){
+			continue;
+		}
+		if(!strcmp(key, name)){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ベンチマーク本体
+* @param[in] 引数の数、引数（基準ファイル名）
+* @param[out] 無し
+* @return 0=劣化なし 1=劣化あり 2=基準ファイルを開けない
+* @details 出力はそのまま基準ファイルとして使える書式にしてある。
+*/
+int main(int argc, char *argv[]){
+	FILE *baseline = NULL;
+	int   regress  = 0;
+
+	if(argc > 1){
+		if((baseline = fopen(argv[1], "r")) == NULL){
+			fprintf(stderr, "iopm_bench: cannot open %s\n", argv[1]);
+			return 2;
+		}
+	}
+
+	hal_init();
+	cpu_type = hal_detect_cpu();
+	reg_index_build();
+	log_init();
+	draw_main_screen();
+	screen_flush();
+
+	printf("# %-20s %12s %12s\n", "name", "ns/op", "cells/op");
+	for(size_t index = 0; index < sizeof(bench_list) / sizeof(bench_list[0]); index++){
+		const st_bench *bench = &bench_list[index];
+		struct timespec start;
+
+		sim_vram_cells = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(uint32_t count = 0; count < bench->loops; count++){
+			bench->proc(count);
+		}
+		double ns    = bench_elapsed(&start) / bench->loops;
+		double cells = (double)sim_vram_cells / bench->loops;
+
+		printf("  %-20s %12.1f %12.2f", bench->name, ns, cells);
+
+		double base_ns, base_cells;
+		if((baseline != NULL) && bench_baseline(baseline, bench->name, &base_ns, &base_cells)){
+			if(cells > (base_cells + 0.005)){
+				printf("   REGRESSION cells %.2f -> %.2f", base_cells, cells);
+				regress = 1;
+			}else if(ns > (base_ns * BENCH_TIME_LIMIT)){
+				printf("   REGRESSION time %.1f -> %.1f", base_ns, ns);
+				regress = 1;
+			}else{
+				printf("   ok (%+.0f%%)", ((ns / base_ns) - 1.0) * 100.0);
+			}
+		}
+		printf("\n");
+	}
+
+	if(baseline != NULL){
+		fclose(baseline);
+	}
+	return regress;
+}
@@ -0,0 +1,949 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+//-------------------------------------------------------------------------
+/**
+* @file iopm_dos.c
+* @brief iopm ハードウェア抽象化層　PC-98実機用
+* @author antarcticlion
+* @date 17Oct2026
+* @details BIOSコール、DOSコール、インラインアセンブラを使う処理をまとめたもの。
+* @details
+* @details 注：ファイルは必ずUTF-8で保存すること。
+*/
+//-------------------------------------------------------------------------
+
+#include "iopm_hal.h"
+
+//-------------------------------------------------------------------------
+/**
+* @brief 初期化
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 実機では何もしない。
+*/
+void hal_init(void){
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief CPUの種別を調べる
+* @param[in] 無し
+* @param[out] 無し
+* @return CPU_8086、CPU_V30、CPU_186、CPU_286のいずれか
+* @details シフト回数のマスクの有無で8086系と186以降を分ける。
+* @details 8086系はAADの基数が無視されるかでV30を見分け、186以降はPUSH SPの値で286以降を見分ける。
+*/
+uint8_t hal_detect_cpu(void){
+	uint16_t result;
+
+	__asm volatile (
+		"mov $1, %%ax\n\t"
+		"mov $33, %%cl\n\t"
+		"shl %%cl, %%ax"
+		: "=a" (result) : : "cx");
+	if(result == 0){
+		__asm volatile (
+			"mov $0x0101, %%ax\n\t"
+			".byte 0xD5, 0x10"				//AAD 16
+			: "=a" (result));
+		return (((result & 0xFF) == 0x0B) ? CPU_V30 : CPU_8086);
+	}
+
+	__asm volatile (
+		"push %%sp\n\t"
+		"pop %%ax\n\t"
+		"sub %%sp, %%ax"
+		: "=a" (result));
+	return ((result == 0) ? CPU_286 : CPU_186);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief DOSからファーメモリを確保する
+* @param[in] 大きさ（パラグラフ数）
+* @param[out] 無し
+* @return セグメント　確保できなければ0
+* @details 確保したメモリはプログラム終了時にDOSが解放する。
+*/
+uint16_t hal_far_alloc(uint16_t paras){
+	unsigned seg;
+
+	if(_dos_allocmem(paras, &seg) != 0){
+		return 0;
+	}
+	return (uint16_t)seg;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ニアメモリからファーメモリへワード単位でブロック転送する
+* @param[in] 転送先、転送元、ワード数
+* @param[out] 無し
+* @return 無し
+* @details REP MOVSWで転送する。8086でも動く命令だけを使う。
+*/
+void hal_copy_to_far(uint16_t __far *dst, const uint16_t *src, uint16_t count){
+	uint16_t seg = FP_SEG(dst);
+	uint16_t off = FP_OFF(dst);
+
+	__asm volatile (
+		"push %%es\n\t"
+		"mov %3, %%es\n\t"
+		"cld\n\t"
+		"rep movsw\n\t"
+		"pop %%es"
+		: "+D" (off), "+S" (src), "+c" (count)
+		: "r" (seg)
+		: "memory");
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファーメモリからニアメモリへワード単位でブロック転送する
+* @param[in] 転送先、転送元、ワード数
+* @param[out] 無し
+* @return 無し
+* @details REP MOVSWで転送する。転送の間だけDSを転送元のセグメントにする。
+* @details ESがDSと同じとは限らないので、転送先のESは元のDSから明示的に設定する。
+*/
+void hal_copy_from_far(uint16_t *dst, const uint16_t __far *src, uint16_t count){
+	uint16_t seg = FP_SEG(src);
+	uint16_t off = FP_OFF(src);
+
+	__asm volatile (
+		"push %%es\n\t"
+		"push %%ds\n\t"
+		"push %%ds\n\t"
+		"pop %%es\n\t"
+		"mov %3, %%ds\n\t"
+		"cld\n\t"
+		"rep movsw\n\t"
+		"pop %%ds\n\t"
+		"pop %%es"
+		: "+D" (dst), "+S" (off), "+c" (count)
+		: "r" (seg)
+		: "memory");
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファーメモリ同士をワード単位で比べ、最初に違うワードを探す
+* @param[in] 比べる2つの領域、ワード数
+* @param[out] 無し
+* @return 最初に違うワードの番号　全部同じならワード数
+* @details REPE CMPSWで比べる。最後に比べたワードが違っていれば、CXはそのワードの分まで減っているので1戻す。
+*/
+uint16_t hal_far_compare(const uint16_t __far *a, const uint16_t __far *b, uint16_t count){
+	uint16_t seg_a = FP_SEG(a);
+	uint16_t off_a = FP_OFF(a);
+	uint16_t seg_b = FP_SEG(b);
+	uint16_t off_b = FP_OFF(b);
+	uint16_t total = count;
+
+	if(count == 0){
+		return 0;
+	}
+	__asm volatile (
+		"push %%ds\n\t"
+		"push %%es\n\t"
+		"mov %3, %%ds\n\t"
+		"mov %4, %%es\n\t"
+		"cld\n\t"
+		"repe cmpsw\n\t"
+		"je 1f\n\t"
+		"inc %%cx\n"
+		"1:\n\t"
+		"pop %%es\n\t"
+		"pop %%ds"
+		: "+S" (off_a), "+D" (off_b), "+c" (count)
+		: "r" (seg_a), "r" (seg_b)
+		: "cc", "memory");
+	return total - count;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 8ビット連続読み込み（REP INSB）
+* @param[in] ポート、格納先、回数
+* @param[out] 無し
+* @return 無し
+* @details V30/186以降専用。-march=i8086でもアセンブルできるよう命令はバイト列で書く。
+*/
+void hal_ins8(uint16_t port, uint8_t __far *buf, uint16_t count){
+	uint16_t seg = FP_SEG(buf);
+	uint16_t off = FP_OFF(buf);
+
+	__asm volatile (
+		"push %%es\n\t"
+		"mov %3, %%es\n\t"
+		"cld\n\t"
+		".byte 0xF3, 0x6C\n\t"				//REP INSB
+		"pop %%es"
+		: "+D" (off), "+c" (count)
+		: "d" (port), "r" (seg)
+		: "memory");
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 16ビット連続読み込み（REP INSW）
+* @param[in] ポート、格納先、回数
+* @param[out] 無し
+* @return 無し
+* @details V30/186以降専用。
+*/
+void hal_ins16(uint16_t port, uint16_t __far *buf, uint16_t count){
+	uint16_t seg = FP_SEG(buf);
+	uint16_t off = FP_OFF(buf);
+
+	__asm volatile (
+		"push %%es\n\t"
+		"mov %3, %%es\n\t"
+		"cld\n\t"
+		".byte 0xF3, 0x6D\n\t"				//REP INSW
+		"pop %%es"
+		: "+D" (off), "+c" (count)
+		: "d" (port), "r" (seg)
+		: "memory");
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 8ビット連続書き込み（REP OUTSB）
+* @param[in] ポート、書き込むデータ、回数
+* @param[out] 無し
+* @return 無し
+* @details V30/186以降専用。
+*/
+void hal_outs8(uint16_t port, uint8_t __far *buf, uint16_t count){
+	uint16_t seg = FP_SEG(buf);
+	uint16_t off = FP_OFF(buf);
+
+	__asm volatile (
+		"push %%ds\n\t"
+		"mov %3, %%ds\n\t"
+		"cld\n\t"
+		".byte 0xF3, 0x6E\n\t"				//REP OUTSB
+		"pop %%ds"
+		: "+S" (off), "+c" (count)
+		: "d" (port), "r" (seg)
+		: "memory");
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 16ビット連続書き込み（REP OUTSW）
+* @param[in] ポート、書き込むデータ、回数
+* @param[out] 無し
+* @return 無し
+* @details V30/186以降専用。
+*/
+void hal_outs16(uint16_t port, uint16_t __far *buf, uint16_t count){
+	uint16_t seg = FP_SEG(buf);
+	uint16_t off = FP_OFF(buf);
+
+	__asm volatile (
+		"push %%ds\n\t"
+		"mov %3, %%ds\n\t"
+		"cld\n\t"
+		".byte 0xF3, 0x6F\n\t"				//REP OUTSW
+		"pop %%ds"
+		: "+S" (off), "+c" (count)
+		: "d" (port), "r" (seg)
+		: "memory");
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファイルを新しく作る
+* @param[in] ファイル名
+* @param[out] ハンドル
+* @return 1=成功 0=失敗（同じ名前のファイルがある場合も失敗）
+* @details INT 21h AH=5Bh　既存のファイルは上書きしない。
+*/
+uint8_t hal_file_create(const char *name, uint16_t *handle){
+	union REGS   regs;
+	struct SREGS sregs;
+
+	segread(&sregs);
+	regs.h.ah = 0x5B;							//指定：ファイルの新規作成
+	regs.x.cx = 0x0000;							//通常属性
+	sregs.ds  = FP_SEG(name);
+	regs.x.dx = FP_OFF(name);
+	intdosx(&regs, &regs, &sregs);
+	if(regs.x.cflag){
+		return 0;
+	}
+	*handle = regs.x.ax;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファイルを読み込み用に開く
+* @param[in] ファイル名
+* @param[out] ハンドル
+* @return 1=成功 0=失敗
+* @details INT 21h AH=3Dh
+*/
+uint8_t hal_file_open(const char *name, uint16_t *handle){
+	union REGS   regs;
+	struct SREGS sregs;
+
+	segread(&sregs);
+	regs.h.ah = 0x3D;							//指定：ファイルのオープン
+	regs.h.al = 0x00;							//読み込みのみ
+	sregs.ds  = FP_SEG(name);
+	regs.x.dx = FP_OFF(name);
+	intdosx(&regs, &regs, &sregs);
+	if(regs.x.cflag){
+		return 0;
+	}
+	*handle = regs.x.ax;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファイルから読み込む
+* @param[in] ハンドル、格納先、バイト数
+* @param[out] 無し
+* @return 読み込めたバイト数
+* @details INT 21h AH=3Fh　ファーメモリのバッファに直接読む。
+*/
+uint16_t hal_file_read(uint16_t handle, void __far *buf, uint16_t count){
+	union REGS   regs;
+	struct SREGS sregs;
+
+	segread(&sregs);
+	sregs.ds  = FP_SEG(buf);
+	regs.h.ah = 0x3F;							//指定：ファイルからの読み込み
+	regs.x.bx = handle;
+	regs.x.cx = count;
+	regs.x.dx = FP_OFF(buf);
+	intdosx(&regs, &regs, &sregs);
+	return (regs.x.cflag ? 0 : regs.x.ax);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファイルに書き込む
+* @param[in] ハンドル、書き込むデータ、バイト数
+* @param[out] 無し
+* @return 書き込めたバイト数
+* @details INT 21h AH=40h　ファーメモリのバッファをそのまま1回で書く。
+*/
+uint16_t hal_file_write(uint16_t handle, const void __far *buf, uint16_t count){
+	union REGS   regs;
+	struct SREGS sregs;
+
+	segread(&sregs);
+	sregs.ds  = FP_SEG(buf);
+	regs.h.ah = 0x40;							//指定：ファイルへの書き込み
+	regs.x.bx = handle;
+	regs.x.cx = count;
+	regs.x.dx = FP_OFF(buf);
+	intdosx(&regs, &regs, &sregs);
+	return (regs.x.cflag ? 0 : regs.x.ax);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファイルを閉じる
+* @param[in] ハンドル
+* @param[out] 無し
+* @return 無し
+* @details INT 21h AH=3Eh
+*/
+void hal_file_close(uint16_t handle){
+	union REGS regs;
+
+	regs.h.ah = 0x3E;							//指定：ファイルのクローズ
+	regs.x.bx = handle;
+	intdos(&regs, &regs);
+}
+
+/// キーボードのリングバッファの大きさ　2のべき乗にすること
+#define HAL_KB_RING 32
+/// アセンブラに埋め込むための文字列化
+#define HAL_STR(x)  HAL_STR2(x)
+#define HAL_STR2(x) #x
+
+/// タイマ割り込み(IRQ0)の回数　割り込み処理で増やす
+volatile uint32_t hal_ticks = 0;
+/// 乗っ取る前のタイマ割り込みベクタ　オフセット
+static uint16_t hal_tick_old_off = 0;
+/// 乗っ取る前のタイマ割り込みベクタ　セグメント
+static uint16_t hal_tick_old_seg = 0;
+/// 0=元のまま 1=乗っ取っている
+static uint8_t  hal_tick_hooked = 0;
+
+/// キーボードから受け取ったスキャンコード　割り込み処理で書き込む
+volatile uint8_t hal_kb_ring[HAL_KB_RING];
+/// キーボードのリングバッファ　次に書き込む位置（割り込み処理が進める）
+volatile uint8_t hal_kb_head = 0;
+/// キーボードのリングバッファ　次に読む位置
+volatile uint8_t hal_kb_tail = 0;
+/// 乗っ取る前のキーボード割り込みベクタ　オフセット
+static uint16_t hal_kb_old_off = 0;
+/// 乗っ取る前のキーボード割り込みベクタ　セグメント
+static uint16_t hal_kb_old_seg = 0;
+/// 0=元のまま 1=乗っ取っている
+static uint8_t  hal_kb_hooked = 0;
+
+/// タイマ割り込み処理（下のアセンブラで定義）
+extern void hal_tick_isr(void);
+/// キーボード割り込み処理（下のアセンブラで定義）
+extern void hal_kb_isr(void);
+
+//-------------------------------------------------------------------------
+// 割り込み処理
+// 割り込み時のDSは不定なので、乗っ取る時にコードセグメント内のhal_isr_dsへDSを書いておく。
+// どちらもBIOSの処理には繋がず、マスタPICにEOIを出して戻る。
+//
+// hal_tick_isr : hal_ticksを1増やす。
+// hal_kb_isr   : 8251のデータ(0x41)を読んでhal_kb_ringに入れる。一杯なら捨てる。
+//-------------------------------------------------------------------------
+__asm__ (
+	"	.text\n"
+	"hal_tick_isr:\n"
+	"	pushw	%ds\n"
+	"	movw	%cs:hal_isr_ds, %ds\n"
+	"	addw	$1, hal_ticks\n"
+	"	adcw	$0, hal_ticks+2\n"
+	"	pushw	%ax\n"
+	"	movb	$0x20, %al\n"					//EOI
+	"	outb	%al, $0x00\n"
+	"	popw	%ax\n"
+	"	popw	%ds\n"
+	"	iret\n"
+	"hal_kb_isr:\n"
+	"	pushw	%ds\n"
+	"	movw	%cs:hal_isr_ds, %ds\n"
+	"	pushw	%ax\n"
+	"	pushw	%bx\n"
+	"	inb	$0x41, %al\n"					//8251 データ
+	"	xorw	%bx, %bx\n"
+	"	movb	hal_kb_head, %bl\n"
+	"	movb	%al, hal_kb_ring(%bx)\n"
+	"	incb	%bl\n"
+	"	andb	$" HAL_STR(HAL_KB_RING) "-1, %bl\n"
+	"	cmpb	hal_kb_tail, %bl\n"
+	"	je	1f\n"
+	"	movb	%bl, hal_kb_head\n"
+	"1:\n"
+	"	movb	$0x20, %al\n"					//EOI
+	"	outb	%al, $0x00\n"
+	"	popw	%bx\n"
+	"	popw	%ax\n"
+	"	popw	%ds\n"
+	"	iret\n"
+	"hal_isr_ds:\n"
+	"	.word	0\n");
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みベクタを差し替える
+* @param[in] 割り込み番号、新しい処理（コードセグメント内）
+* @param[out] 元のベクタのオフセット、セグメント
+* @return 無し
+* @details INT 21h AH=35h/25h　割り込み処理が使うDSもここでhal_isr_dsに書いておく。
+*/
+static void hal_vect_hook(uint8_t number, void (*isr)(void), uint16_t *old_off, uint16_t *old_seg){
+	union REGS   regs;
+	struct SREGS sregs;
+	uint16_t     code_seg;
+
+	segread(&sregs);
+	regs.h.ah = 0x35;							//指定：割り込みベクタの取得
+	regs.h.al = number;
+	intdosx(&regs, &regs, &sregs);
+	*old_off = regs.x.bx;
+	*old_seg = sregs.es;
+
+	__asm volatile (
+		"movw %%ds, %%cs:hal_isr_ds\n\t"
+		"movw %%cs, %0"
+		: "=r" (code_seg) : : "memory");
+	segread(&sregs);
+	sregs.ds  = code_seg;
+	regs.h.ah = 0x25;							//指定：割り込みベクタの設定
+	regs.h.al = number;
+	regs.x.dx = (uint16_t)(uintptr_t)isr;
+	intdosx(&regs, &regs, &sregs);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みベクタを元に戻す
+* @param[in] 割り込み番号、元のベクタのオフセット、セグメント
+* @param[out] 無し
+* @return 無し
+* @details INT 21h AH=25h
+*/
+static void hal_vect_restore(uint8_t number, uint16_t old_off, uint16_t old_seg){
+	union REGS   regs;
+	struct SREGS sregs;
+
+	segread(&sregs);
+	sregs.ds  = old_seg;
+	regs.h.ah = 0x25;							//指定：割り込みベクタの設定
+	regs.h.al = number;
+	regs.x.dx = old_off;
+	intdosx(&regs, &regs, &sregs);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief タイマ割り込みを乗っ取る
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details INT 08h(IRQ0)をhal_tick_isrに向ける。PITの設定とIRQ0のマスク解除は呼ぶ側で行う。
+*/
+void hal_tick_hook(void){
+	if(hal_tick_hooked){
+		return;
+	}
+	hal_ticks = 0;
+	hal_vect_hook(0x08, hal_tick_isr, &hal_tick_old_off, &hal_tick_old_seg);
+	hal_tick_hooked = 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief タイマ割り込みを元に戻す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details IRQ0のマスクは呼ぶ側で先に戻しておくこと。
+*/
+void hal_tick_unhook(void){
+	if(!hal_tick_hooked){
+		return;
+	}
+	hal_vect_restore(0x08, hal_tick_old_off, hal_tick_old_seg);
+	hal_tick_hooked = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief タイマ割り込みの回数
+* @param[in] 無し
+* @param[out] 無し
+* @return hal_tick_hook()からの割り込み回数
+* @details 32ビットを途中で書き換えられないよう、割り込みを止めて読む。
+*/
+uint32_t hal_tick_count(void){
+	uint32_t ticks;
+
+	_disable();
+	ticks = hal_ticks;
+	_enable();
+	return ticks;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 次の割り込みまでCPUを止める
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details STI直後の1命令は割り込みを受けないので、STI/HLTの間に割り込みが来て取りこぼすことはない。
+*/
+void hal_idle(void){
+	__asm volatile ("sti\n\thlt" : : : "memory");
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みを止める
+* @param[in] 無し
+* @param[out] 無し
+* @return 止める前のフラグ（hal_int_restore()に渡す）
+* @details 割り込み禁止の中から呼ばれても、hal_int_restore()で元の状態に戻る。
+*/
+uint16_t hal_int_save(void){
+	uint16_t flags;
+
+	__asm volatile ("pushf\n\tpop %0\n\tcli" : "=r" (flags) : : "memory");
+	return flags;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みの許可を元に戻す
+* @param[in] hal_int_save()が返したフラグ
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void hal_int_restore(uint16_t flags){
+	__asm volatile ("push %0\n\tpopf" : : "r" (flags) : "memory", "cc");
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボード割り込みを乗っ取る
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details INT 09h(IRQ1)をhal_kb_isrに向ける。以後、BIOSのキーバッファには何も入らない。
+*/
+void hal_kb_hook(void){
+	if(hal_kb_hooked){
+		return;
+	}
+	_disable();
+	hal_kb_head = 0;
+	hal_kb_tail = 0;
+	hal_vect_hook(0x09, hal_kb_isr, &hal_kb_old_off, &hal_kb_old_seg);
+	_enable();
+	hal_kb_hooked = 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボード割り込みを元に戻す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void hal_kb_unhook(void){
+	if(!hal_kb_hooked){
+		return;
+	}
+	_disable();
+	hal_vect_restore(0x09, hal_kb_old_off, hal_kb_old_seg);
+	_enable();
+	hal_kb_hooked = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボードから受け取ったスキャンコードを1つ取り出す
+* @param[in] 無し
+* @param[out] スキャンコード（bit7=離した）
+* @return 1=取り出した 0=無い
+* @details 書き込み位置は割り込み処理だけが、読み出し位置はここだけが動かすので割り込みは止めない。
+*/
+uint8_t hal_kb_get(uint8_t *code){
+	uint8_t tail = hal_kb_tail;
+
+	if(tail == hal_kb_head){
+		return 0;
+	}
+	*code = hal_kb_ring[tail];
+	hal_kb_tail = (tail + 1) & (HAL_KB_RING - 1);
+	return 1;
+}
+
+/// 割り込み監視　記録の大きさ（1件8バイト）　256で固定（書き込み位置の桁あふれで一周させる）
+#define HAL_IRQ_RING 256
+
+///割り込み監視の記録1件
+typedef struct type_hal_irq_event {
+	/// IRQ番号
+	uint8_t  line;
+	/// 位置合わせ
+	uint8_t  pad;
+	/// 割り込み時のPITカウンタ0の値
+	uint16_t phase;
+	/// 割り込み時のhal_ticks
+	uint32_t ticks;
+} st_hal_irq_event;
+
+/// 割り込み監視　IRQごとの回数　割り込み処理で増やす
+volatile uint32_t hal_irq_counts[HAL_IRQ_LINES];
+/// 割り込み監視　乗っ取る前のベクタ　[IRQ番号*2]=オフセット [IRQ番号*2+1]=セグメント
+uint16_t hal_irq_old[HAL_IRQ_LINES * 2];
+/// 割り込み監視　割り込みの記録　割り込み処理で書き込む
+volatile st_hal_irq_event hal_irq_events[HAL_IRQ_RING];
+/// 割り込み監視　次に書き込む位置（割り込み処理が進める）
+volatile uint8_t  hal_irq_head = 0;
+/// 割り込み監視　次に読む位置
+volatile uint8_t  hal_irq_tail = 0;
+/// 割り込み監視　記録が一杯で捨てた数
+volatile uint16_t hal_irq_lost = 0;
+/// 0=元のまま 1=乗っ取っている
+static uint8_t    hal_irq_hooked = 0;
+
+/// 割り込み監視の入口（下のアセンブラで定義）
+extern void hal_irq_isr0(void);
+extern void hal_irq_isr1(void);
+extern void hal_irq_isr2(void);
+extern void hal_irq_isr3(void);
+extern void hal_irq_isr4(void);
+extern void hal_irq_isr5(void);
+extern void hal_irq_isr6(void);
+extern void hal_irq_isr7(void);
+extern void hal_irq_isr8(void);
+extern void hal_irq_isr9(void);
+extern void hal_irq_isr10(void);
+extern void hal_irq_isr11(void);
+extern void hal_irq_isr12(void);
+extern void hal_irq_isr13(void);
+extern void hal_irq_isr14(void);
+extern void hal_irq_isr15(void);
+
+/// 割り込み監視の入口　IRQ番号順
+static void (* const hal_irq_isrs[HAL_IRQ_LINES])(void) = {
+	hal_irq_isr0,  hal_irq_isr1,  hal_irq_isr2,  hal_irq_isr3,
+	hal_irq_isr4,  hal_irq_isr5,  hal_irq_isr6,  hal_irq_isr7,
+	hal_irq_isr8,  hal_irq_isr9,  hal_irq_isr10, hal_irq_isr11,
+	hal_irq_isr12, hal_irq_isr13, hal_irq_isr14, hal_irq_isr15,
+};
+
+/// 割り込み監視の入口1個分　BXにIRQ番号を入れて共通部へ
+#define HAL_IRQ_STUB(n) \
+	"hal_irq_isr" #n ":\n" \
+	"	pushw	%bx\n" \
+	"	movw	$" #n ", %bx\n" \
+	"	jmp	hal_irq_common\n"
+
+//-------------------------------------------------------------------------
+// 割り込み監視の処理
+// 回数を1増やし、hal_ticksとPITカウンタ0の値を記録に書いて、元の処理に繋ぐ。EOIは元の処理が出す。
+// 繋ぎ先は割り込み禁止のまま%cs:hal_irq_chainに置いてから飛ぶので、他の割り込みと混ざらない。
+//-------------------------------------------------------------------------
+__asm__ (
+	"	.text\n"
+	HAL_IRQ_STUB(0)  HAL_IRQ_STUB(1)  HAL_IRQ_STUB(2)  HAL_IRQ_STUB(3)
+	HAL_IRQ_STUB(4)  HAL_IRQ_STUB(5)  HAL_IRQ_STUB(6)  HAL_IRQ_STUB(7)
+	HAL_IRQ_STUB(8)  HAL_IRQ_STUB(9)  HAL_IRQ_STUB(10) HAL_IRQ_STUB(11)
+	HAL_IRQ_STUB(12) HAL_IRQ_STUB(13) HAL_IRQ_STUB(14) HAL_IRQ_STUB(15)
+	"hal_irq_common:\n"
+	"	pushw	%ds\n"
+	"	pushw	%ax\n"
+	"	pushw	%si\n"
+	"	movw	%cs:hal_isr_ds, %ds\n"
+	"	movw	%bx, %si\n"
+	"	shlw	$1, %si\n"
+	"	shlw	$1, %si\n"						//SI=IRQ番号*4
+	"	addw	$1, hal_irq_counts(%si)\n"
+	"	adcw	$0, hal_irq_counts+2(%si)\n"
+	"	movw	hal_irq_old(%si), %ax\n"
+	"	movw	%ax, %cs:hal_irq_chain\n"
+	"	movw	hal_irq_old+2(%si), %ax\n"
+	"	movw	%ax, %cs:hal_irq_chain+2\n"
+	"	movb	hal_irq_head, %al\n"
+	"	xorb	%ah, %ah\n"
+	"	movw	%ax, %si\n"
+	"	incb	%al\n"
+	"	cmpb	hal_irq_tail, %al\n"
+	"	je	1f\n"
+	"	movb	%al, hal_irq_head\n"
+	"	shlw	$1, %si\n"
+	"	shlw	$1, %si\n"
+	"	shlw	$1, %si\n"						//SI=書き込み位置*8
+	"	movb	%bl, hal_irq_events(%si)\n"
+	"	movw	hal_ticks, %ax\n"
+	"	movw	%ax, hal_irq_events+4(%si)\n"
+	"	movw	hal_ticks+2, %ax\n"
+	"	movw	%ax, hal_irq_events+6(%si)\n"
+	"	movb	$0x00, %al\n"					//カウンタ0 ラッチ
+	"	outb	%al, $0x77\n"
+	"	inb	$0x71, %al\n"
+	"	movb	%al, %ah\n"
+	"	inb	$0x71, %al\n"
+	"	xchgb	%al, %ah\n"
+	"	movw	%ax, hal_irq_events+2(%si)\n"
+	"	jmp	2f\n"
+	"1:\n"
+	"	addw	$1, hal_irq_lost\n"
+	"2:\n"
+	"	popw	%si\n"
+	"	popw	%ax\n"
+	"	popw	%ds\n"
+	"	popw	%bx\n"
+	"	ljmp	*%cs:hal_irq_chain\n"
+	"hal_irq_chain:\n"
+	"	.word	0, 0\n");
+
+//-------------------------------------------------------------------------
+/**
+* @brief IRQ番号に対応する割り込み番号
+* @param[in] IRQ番号
+* @param[out] 無し
+* @return 割り込み番号　マスタはINT 08h～0Fh、スレーブはINT 10h～17h
+* @details
+*/
+static uint8_t hal_irq_vector(uint8_t line){
+	return (uint8_t)((line < 8) ? (0x08 + line) : (0x10 + (line - 8)));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 全IRQの割り込みを監視する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details マスタとスレーブの16本のベクタを監視の入口に向ける。回数と記録は0から数え直す。
+* @details 元の処理には必ず繋ぐので、マスクやEOIの扱いは変わらない。
+*/
+void hal_irq_hook(void){
+	if(hal_irq_hooked){
+		return;
+	}
+	_disable();
+	for(uint8_t line = 0; line < HAL_IRQ_LINES; line++){
+		hal_irq_counts[line] = 0;
+	}
+	hal_irq_head = 0;
+	hal_irq_tail = 0;
+	hal_irq_lost = 0;
+	for(uint8_t line = 0; line < HAL_IRQ_LINES; line++){
+		hal_vect_hook(hal_irq_vector(line), hal_irq_isrs[line], &hal_irq_old[line * 2], &hal_irq_old[(line * 2) + 1]);
+	}
+	_enable();
+	hal_irq_hooked = 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みの監視をやめる
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 乗っ取った後に他がベクタを変えていないこと（監視中は他の乗っ取りをしないこと）。
+*/
+void hal_irq_unhook(void){
+	if(!hal_irq_hooked){
+		return;
+	}
+	_disable();
+	for(uint8_t line = 0; line < HAL_IRQ_LINES; line++){
+		hal_vect_restore(hal_irq_vector(line), hal_irq_old[line * 2], hal_irq_old[(line * 2) + 1]);
+	}
+	_enable();
+	hal_irq_hooked = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief IRQごとの割り込み回数
+* @param[in] IRQ番号
+* @param[out] 無し
+* @return hal_irq_hook()からの回数
+* @details 32ビットを途中で書き換えられないよう、割り込みを止めて読む。
+*/
+uint32_t hal_irq_count(uint8_t line){
+	uint32_t count;
+
+	_disable();
+	count = hal_irq_counts[line];
+	_enable();
+	return count;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みの記録を1件取り出す
+* @param[in] 無し
+* @param[out] IRQ番号、その時のタイマ割り込みの回数、PITカウンタ0の値
+* @return 1=取り出した 0=無い
+* @details 書き込み位置は割り込み処理だけが、読み出し位置はここだけが動かすので割り込みは止めない。
+*/
+uint8_t hal_irq_get(uint8_t *line, uint32_t *ticks, uint16_t *phase){
+	uint8_t tail = hal_irq_tail;
+
+	if(tail == hal_irq_head){
+		return 0;
+	}
+	*line  = hal_irq_events[tail].line;
+	*ticks = hal_irq_events[tail].ticks;
+	*phase = hal_irq_events[tail].phase;
+	hal_irq_tail = tail + 1;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 記録が一杯で捨てた割り込みの数
+* @param[in] 無し
+* @param[out] 無し
+* @return 件数
+* @details 回数（hal_irq_count）には捨てた分も入っている。
+*/
+uint16_t hal_irq_dropped(void){
+	return hal_irq_lost;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボードインタフェースの初期化
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details INT 18h AH=03h
+*/
+void kb_init(void){
+	union REGS  regs_param;						//BIOSコールパラメタ
+	union REGS  regs_result;					//BIOSコール戻り値
+
+	regs_param.h.ah = 0x03; 					//指定：キーボードインタフェースの初期化
+	int86( 0x18, &regs_param, &regs_result);	//BIOSコール実行
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボードバッファーのセンス
+* @param[in] 無し
+* @param[out] 無し
+* @return 0=入力なし それ以外=入力あり
+* @details INT 18h AH=01h
+*/
+uint8_t kb_sense(void){
+	union REGS  regs_param;						//BIOSコールパラメタ
+	union REGS  regs_result;					//BIOSコール戻り値
+
+	regs_param.h.ah = 0x01; 					//指定：キーボードバッファーセンシング
+	int86( 0x18, &regs_param, &regs_result);	//BIOSコール実行
+	return regs_result.h.bh;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief シフトキー状態のセンス
+* @param[in] 無し
+* @param[out] 無し
+* @return シフトキー状態　bit0=SHIFT
+* @details INT 18h AH=02h
+*/
+uint8_t kb_shift(void){
+	union REGS  regs_param;						//BIOSコールパラメタ
+	union REGS  regs_result;					//BIOSコール戻り値
+
+	regs_param.h.ah = 0x02; 					//指定：シフトキー状態のセンシング
+	int86( 0x18, &regs_param, &regs_result);	//BIOSコール実行
+	return regs_result.h.al;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボードバッファーの読み込み
+* @param[in] 無し
+* @param[out] 無し
+* @return キーコード
+* @details INT 18h AH=00h
+*/
+uint8_t kb_read(void){
+	union REGS  regs_param;						//BIOSコールパラメタ
+	union REGS  regs_result;					//BIOSコール戻り値
+
+	regs_param.h.ah = 0x00; 					//指定：キーボードバッファーリード
+	int86( 0x18, &regs_param, &regs_result);	//BIOSコール実行
+	return regs_result.h.ah;
+}
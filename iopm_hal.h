@@ -0,0 +1,123 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+* @file iopm_hal.h
+* @brief iopm ハードウェア抽象化層
+* @author antarcticlion
+* @date 17Oct2026
+* @details I/Oポート、メモリ（テキストVRAMを含む）、キーボード、ファイル、タイマ割り込み、CPU固有命令へのアクセスをここに集める。
+* @details
+* @details 通常はPC-98実機用（iopm_dos.c）。IOPM_HOSTを定義するとLinux上の模擬PC-98（iopm_sim.c）を使う。
+* @details iopm.c側はこのヘッダの関数とマクロだけを使い、inp()やint86()を直接呼ばないこと。
+*/
+
+#ifndef IOPM_HAL_H
+#define IOPM_HAL_H
+
+#include <stdint.h>
+
+/// CPU種別　8086/8088
+#define CPU_8086  0
+/// CPU種別　V30/V20
+#define CPU_V30   1
+/// CPU種別　80186/80188
+#define CPU_186   2
+/// CPU種別　80286以降
+#define CPU_286   3
+
+/// 割り込み監視　IRQの本数（マスタIR0～7、スレーブIR8～15）
+#define HAL_IRQ_LINES 16
+
+#ifdef IOPM_HOST
+//-------------------------------------------------------------------------
+// Linux上の模擬PC-98
+//-------------------------------------------------------------------------
+
+#define __far
+
+/// 模擬PC-98の1MB+64KBのメモリ空間
+extern uint8_t sim_mem[];
+/// テキストVRAMに書き込んだセル数（ベンチマーク用）
+extern uint32_t sim_vram_cells;
+
+/// セグメント:オフセットから模擬メモリ上のポインタを作る
+#define MK_FP(seg, off) ((void *)&sim_mem[((uint32_t)(uint16_t)(seg) << 4) + (uint16_t)(off)])
+/// 模擬メモリ上のポインタのセグメント
+#define FP_SEG(ptr)     ((uint16_t)(((uint8_t *)(ptr) - sim_mem) >> 4))
+/// 模擬メモリ上のポインタのオフセット
+#define FP_OFF(ptr)     ((uint16_t)(((uint8_t *)(ptr) - sim_mem) & 0x0F))
+
+uint8_t  port_in8(uint16_t port);
+uint16_t port_in16(uint16_t port);
+void     port_out8(uint16_t port, uint8_t value);
+void     port_out16(uint16_t port, uint16_t value);
+
+#else
+//-------------------------------------------------------------------------
+// PC-98実機
+//-------------------------------------------------------------------------
+
+#include <conio.h>
+#include <i86.h>
+#include <dos.h>
+
+/// 8ビット読み込み
+#define port_in8(port)          ((uint8_t)inp(port))
+/// 16ビット読み込み
+#define port_in16(port)         ((uint16_t)inpw(port))
+/// 8ビット書き込み
+#define port_out8(port, value)  outp((port), (value))
+/// 16ビット書き込み
+#define port_out16(port, value) outpw((port), (value))
+
+#endif
+
+void     hal_init(void);
+uint8_t  hal_detect_cpu(void);
+uint16_t hal_far_alloc(uint16_t paras);
+void     hal_copy_to_far(uint16_t __far *dst, const uint16_t *src, uint16_t count);
+void     hal_copy_from_far(uint16_t *dst, const uint16_t __far *src, uint16_t count);
+uint16_t hal_far_compare(const uint16_t __far *a, const uint16_t __far *b, uint16_t count);
+void     hal_ins8(uint16_t port, uint8_t __far *buf, uint16_t count);
+void     hal_ins16(uint16_t port, uint16_t __far *buf, uint16_t count);
+void     hal_outs8(uint16_t port, uint8_t __far *buf, uint16_t count);
+void     hal_outs16(uint16_t port, uint16_t __far *buf, uint16_t count);
+
+uint8_t  hal_file_create(const char *name, uint16_t *handle);
+uint8_t  hal_file_open(const char *name, uint16_t *handle);
+uint16_t hal_file_read(uint16_t handle, void __far *buf, uint16_t count);
+uint16_t hal_file_write(uint16_t handle, const void __far *buf, uint16_t count);
+void     hal_file_close(uint16_t handle);
+
+void     hal_tick_hook(void);
+void     hal_tick_unhook(void);
+uint32_t hal_tick_count(void);
+void     hal_idle(void);
+uint16_t hal_int_save(void);
+void     hal_int_restore(uint16_t flags);
+
+void     hal_irq_hook(void);
+void     hal_irq_unhook(void);
+uint32_t hal_irq_count(uint8_t line);
+uint8_t  hal_irq_get(uint8_t *line, uint32_t *ticks, uint16_t *phase);
+uint16_t hal_irq_dropped(void);
+
+void     kb_init(void);
+void     hal_kb_hook(void);
+void     hal_kb_unhook(void);
+uint8_t  hal_kb_get(uint8_t *code);
+uint8_t  kb_sense(void);
+uint8_t  kb_shift(void);
+uint8_t  kb_read(void);
+
+#endif
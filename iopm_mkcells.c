@@ -0,0 +1,124 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+//-------------------------------------------------------------------------
+/**
+* @file iopm_mkcells.c
+* @brief iopm 固定文字列の変換ツール（ビルド時にLinux上で動かす）
+* @author antarcticlion
+* @date 17Oct2026
+* @details iopm_ui.hの文字列をテキストVRAMの文字コード列に変換し、iopm_cells.hとして標準出力に書き出す。
+* @details 文字列をSJISにするため、-fexec-charset=CP932を付けてビルドすること。
+* @details 全角文字は左右2セルに分け、VRAM_print()と同じ値にする。
+*/
+//-------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "iopm_sjis.h"
+#include "iopm_ui.h"
+
+/// 出力済みのセル数
+static unsigned cell_total = 0;
+
+//-------------------------------------------------------------------------
+/**
+* @brief 文字列1個分のセル数を数える
+* @param[in] 文字列
+* @param[out] 無し
+* @return セル数
+* @details
+*/
+static unsigned count_cells(const char *text){
+	const uint8_t *curr = (const uint8_t *)text;
+	unsigned       count = 0;
+	uint8_t        code;
+
+	while((code = *curr++)){
+		if(is_SJIS(code)){
+			curr++;
+			count++;
+		}
+		count++;
+	}
+	return count;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 文字列1個分のセルを書き出す
+* @param[in] 名前、文字列
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+static void emit_cells(const char *name, const char *text){
+	const uint8_t *curr = (const uint8_t *)text;
+	unsigned       column = 0;
+	uint8_t        code;
+
+	printf("\t/* %s */\n\t", name);
+	while((code = *curr++)){
+		if(is_SJIS(code)){
+			uint16_t value = SJIS_to_VRAM(code, *curr++);
+			printf("0x%04X,0x%04X,", (value & 0xFF7F), (value | 0x0080));
+			column += 2;
+		}else{
+			printf("0x%04X,", code);
+			column++;
+		}
+		if((column >= 10) && *curr){
+			printf("\n\t");
+			column = 0;
+		}
+	}
+	printf("\n");
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 変換ツール本体
+* @param[in] 無し
+* @param[out] 無し
+* @return 0
+* @details セル列、メイン画面の文字列表、実行時に使う文字列の位置と長さの順に書き出す。
+*/
+int main(void){
+	printf("/* iopm_cells.h: generated from iopm_ui.h by iopm_mkcells. Do not edit. */\n\n");
+
+	printf("/// UI cells\n");
+	printf("static const uint16_t ui_cells[] = {\n");
+#define UI_LABEL(name, x, y, attr, text) emit_cells(#name, text);
+#define UI_TEXT(name, text)              emit_cells(#name, text);
+	UI_MAIN_LABELS
+	UI_TEXTS
+#undef UI_LABEL
+#undef UI_TEXT
+	printf("};\n\n");
+
+	printf("/// main screen labels\n");
+	printf("static const st_ui_label ui_main_labels[] = {\n");
+#define UI_LABEL(name, x, y, attr, text) \
+	printf("\t{%3d, %3d, %-40s, %3u, %4u},\n", x, y, #attr, count_cells(text), cell_total); \
+	cell_total += count_cells(text);
+	UI_MAIN_LABELS
+#undef UI_LABEL
+	printf("};\n\n");
+
+#define UI_TEXT(name, text) \
+	printf("/// %s offset\n#define UI_%s %u\n", #name, #name, cell_total); \
+	printf("/// %s length\n#define UI_%s_LEN %u\n", #name, #name, count_cells(text)); \
+	cell_total += count_cells(text);
+	UI_TEXTS
+#undef UI_TEXT
+
+	return 0;
+}
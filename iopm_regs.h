@@ -0,0 +1,82 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+* @file iopm_regs.h
+* @brief iopm ボードのレジスタ定義
+* @author antarcticlion
+* @date 17Oct2026
+* @details 本体と拡張ボードのI/Oポートに名前とビット欄を付ける。ビルド時にreg_list[]に展開され、
+* @details 起動時にポート番号からの索引（reg_index_build()）を作る。
+* @details
+* @details REG(ポート, 名前, ビット欄)
+* @details 　名前は最大10文字の半角。
+* @details 　ビット欄は「名前:ビット」か「名前:上位-下位」を空白で区切り、上位のビットから並べる。無ければ""。
+* @details 　読みと書きで意味が違うレジスタは、よく見る方の意味で書く。
+* @details
+* @details ボードを足す時はREG_LIST_xxxを作ってREG_LISTに加える。
+*/
+
+#ifndef IOPM_REGS_H
+#define IOPM_REGS_H
+
+/// 割り込みコントローラ 8259A（マスタ00h/02h、スレーブ08h/0Ah）
+#define REG_LIST_PIC \
+	REG(0x0000, "PIC1 CMD",   "") \
+	REG(0x0002, "PIC1 IMR",   "SLV:7 IR6:6 IR5:5 RS:4 IR3:3 VS:2 KB:1 TM:0") \
+	REG(0x0008, "PIC2 CMD",   "") \
+	REG(0x000A, "PIC2 IMR",   "IR15:7 IR14:6 IR13:5 IR12:4 IR11:3 IR10:2 IR9:1 IR8:0")
+
+/// システムポート 8255（31h～37h）
+#define REG_LIST_PPI \
+	REG(0x0031, "PPI DIPSW2", "") \
+	REG(0x0033, "PPI B",      "CI:7 CS:6 CD:5 INT3:4 CRT:3 IMCK:2 EMCK:1 CDAT:0") \
+	REG(0x0035, "PPI C",      "SHUT0:7 PSTB:6 SHUT1:5 MCHK:4 BUZ:3 TXRE:2 TXEE:1 RXRE:0") \
+	REG(0x0037, "PPI CTRL",   "MODE:7 BIT:3-1 SET:0")
+
+/// キーボード 8251（41h/43h）
+#define REG_LIST_KB \
+	REG(0x0041, "KB DATA",    "") \
+	REG(0x0043, "KB STAT",    "DSR:7 SYN:6 FE:5 OE:4 PE:3 TXE:2 RXR:1 TXR:0")
+
+/// GDC μPD7220（テキスト60h/62h、グラフィックA0h/A2h）
+#define REG_LIST_GDC \
+	REG(0x0060, "TGDC STAT",  "LP:7 HB:6 VS:5 DMA:4 DRAW:3 EMP:2 FULL:1 DRDY:0") \
+	REG(0x0062, "TGDC CMD",   "") \
+	REG(0x00A0, "GGDC STAT",  "LP:7 HB:6 VS:5 DMA:4 DRAW:3 EMP:2 FULL:1 DRDY:0") \
+	REG(0x00A2, "GGDC CMD",   "")
+
+/// インターバルタイマ 8253（71h～77h）
+#define REG_LIST_PIT \
+	REG(0x0071, "PIT CNT0",   "") \
+	REG(0x0073, "PIT CNT1",   "") \
+	REG(0x0075, "PIT CNT2",   "") \
+	REG(0x0077, "PIT CTRL",   "SC:7-6 RW:5-4 MODE:3-1 BCD:0")
+
+/// サウンドボード 26K/86（OPN/OPNA 188h～18Eh、86ボードのID A460h）
+#define REG_LIST_SOUND \
+	REG(0x0188, "OPN ADDR",   "BUSY:7 FLGB:1 FLGA:0") \
+	REG(0x018A, "OPN DATA",   "") \
+	REG(0x018C, "OPNA EXADR", "BUSY:7 FLAG:4-0") \
+	REG(0x018E, "OPNA EXDAT", "") \
+	REG(0xA460, "86 ID",      "ID:7-4 MASK:1 OPNA:0")
+
+/// 登録するすべてのレジスタ
+#define REG_LIST \
+	REG_LIST_PIC \
+	REG_LIST_PPI \
+	REG_LIST_KB \
+	REG_LIST_GDC \
+	REG_LIST_PIT \
+	REG_LIST_SOUND
+
+#endif
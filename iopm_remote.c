@@ -0,0 +1,567 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+//-------------------------------------------------------------------------
+/**
+* @file iopm_remote.c
+* @brief iopm RS-232Cリモート操作のクライアント（Linux上で動かす）
+* @author antarcticlion
+* @date 17Oct2026
+* @details 'make tools'でビルドする。iopm.exeをshift+f･10のリモート画面にしておき、シリアルポートを渡して使う。
+* @details
+* @details iopm_remote [-b 速度] [-t 秒] デバイス [コマンド…]
+* @details 　コマンドを引数に書かなければ標準入力から読む（#から行末まではコメント）。
+* @details 　コマンドはREMOTE_FRAME_MAXに収まるだけ1フレームにまとめて送り、結果を1行ずつ標準出力に書き出す。
+* @details
+* @details 　info　　　　　　　　　　　　　版、CPU種別、PITのクロック
+* @details 　in8 ポート　　　　　　　　　　8ビット読込
+* @details 　in16 ポート 　　　　　　　　　16ビット読込
+* @details 　out8 ポート 値　　　　　　　　8ビット書込
+* @details 　out16 ポート 値 　　　　　　　16ビット書込
+* @details 　ins8 ポート 回数　　　　　　　8ビット連続読込
+* @details 　outs8 ポート 16進の列 　　　　8ビット連続書込（例 outs8 188 00FF1234）
+* @details 　poll ポート マスク 期待値 ms　(値 & マスク) == 期待値 になるまで待つ
+* @details 　数値は16進（0x付きでもよい）、msと回数は10進。
+* @details
+* @details 最初にinfoを1回送って相手を確かめ、PITのクロックを覚えておく（pollの経過をusにするのに使う）。
+* @details 実機のないところでは、IOPM_SERIALを設定したiopm_hostの疑似端末につないで試せる。
+*/
+//-------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+#include "iopm_remote.h"
+
+/// 1行の最大長
+#define TOOL_LINE_MAX  4096
+/// 1コマンドの最大の語数
+#define TOOL_WORDS_MAX 8
+
+///送るコマンド1個分
+typedef struct type_remote_cmd {
+	/// REMOTE_OP_xxx
+	uint8_t  op;
+	/// ポート
+	uint16_t port;
+	/// 値（out8/out16）、マスク（poll）
+	uint16_t value;
+	/// 期待値（poll）
+	uint8_t  expect;
+	/// 回数（ins8/outs8）、上限[ms]（poll）
+	uint16_t count;
+	/// 書き込むデータ（outs8）
+	uint8_t *data;
+} st_remote_cmd;
+
+///コマンド名と引数の数
+static const struct {
+	const char *name;
+	uint8_t     op;
+	uint8_t     args;
+} tool_ops[] = {
+	{"info",  REMOTE_OP_INFO,  0}, {"in8",   REMOTE_OP_IN8,   1}, {"in16",  REMOTE_OP_IN16,  1},
+	{"out8",  REMOTE_OP_OUT8,  2}, {"out16", REMOTE_OP_OUT16, 2}, {"ins8",  REMOTE_OP_INS8,  2},
+	{"outs8", REMOTE_OP_OUTS8, 2}, {"poll",  REMOTE_OP_POLL,  4},
+};
+
+///コマンドの引数のバイト数（連続書込のデータを除く）
+static const uint8_t tool_arg_size[] = {0, 2, 2, 3, 4, 4, 4, 6};
+///コマンドの結果のバイト数（連続読込のデータを除く）
+static const uint8_t tool_result_size[] = {6, 1, 2, 0, 0, 0, 0, 6};
+
+///シリアルポート
+static int           tool_fd = -1;
+///応答を待つ時間[秒]
+static int           tool_timeout = 5;
+///次に送るフレームのSEQ
+static uint8_t       tool_seq = 0;
+///相手のPITのクロック[Hz]（0=不明）
+static uint32_t      tool_clock = 0;
+///まとめているコマンド
+static st_remote_cmd tool_cmds[REMOTE_FRAME_MAX];
+///まとめているコマンドの数
+static uint16_t      tool_count = 0;
+///まとめている要求の本体
+static uint8_t       tool_req[REMOTE_FRAME_MAX];
+///要求の本体のバイト数
+static uint16_t      tool_req_len = 0;
+///応答の本体の予定のバイト数
+static uint16_t      tool_rep_len = REMOTE_REPLY_HEAD;
+///受け取った応答の本体
+static uint8_t       tool_rep[REMOTE_FRAME_MAX];
+///エラーがあったか
+static int           tool_failed = 0;
+
+//-------------------------------------------------------------------------
+/**
+* @brief リトルエンディアンの16ビット値を取り出す
+* @param[in] バイト列
+* @param[out] 無し
+* @return 値
+* @details
+*/
+static uint16_t get16(const uint8_t *bytes){
+	return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief リトルエンディアンの32ビット値を取り出す
+* @param[in] バイト列
+* @param[out] 無し
+* @return 値
+* @details
+*/
+static uint32_t get32(const uint8_t *bytes){
+	return (uint32_t)get16(bytes) | ((uint32_t)get16(bytes + 2) << 16);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief シリアルポートを開く
+* @param[in] デバイス、速度[bps]
+* @param[out] 無し
+* @return 1=成功 0=失敗
+* @details ローモード、8N1、RTS/CTSのフロー制御あり（iopmはフレームを受け付ける間だけRTSを上げる）。
+*/
+static int open_port(const char *name, int baud){
+	static const struct {
+		int     baud;
+		speed_t speed;
+	} speeds[] = {{2400, B2400}, {4800, B4800}, {9600, B9600}, {19200, B19200}, {38400, B38400}};
+	struct termios tio;
+	speed_t        speed = 0;
+
+	for(size_t index = 0; index < sizeof(speeds) / sizeof(speeds[0]); index++){
+		if(speeds[index].baud == baud){
+			speed = speeds[index].speed;
+		}
+	}
+	if(speed == 0){
+		fprintf(stderr, "iopm_remote: unsupported speed %d\n", baud);
+		return 0;
+	}
+	if(((tool_fd = open(name, O_RDWR | O_NOCTTY)) < 0) || (tcgetattr(tool_fd, &tio) != 0)){
+		fprintf(stderr, "iopm_remote: cannot open %s\n", name);
+		return 0;
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD | CRTSCTS;
+	tio.c_cflag &= ~CSTOPB;
+	tio.c_cc[VMIN]  = 0;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	tcsetattr(tool_fd, TCSANOW, &tio);
+	tcflush(tool_fd, TCIOFLUSH);
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 決まったバイト数を受け取る
+* @param[in] バイト数
+* @param[out] 受け取り先
+* @return 1=受け取った 0=時間切れ
+* @details tool_timeout秒の間に1バイトも来なければ時間切れ。
+*/
+static int read_bytes(uint8_t *buf, size_t size){
+	while(size){
+		fd_set         fds;
+		struct timeval wait = {tool_timeout, 0};
+		ssize_t        got;
+
+		FD_ZERO(&fds);
+		FD_SET(tool_fd, &fds);
+		if(select(tool_fd + 1, &fds, NULL, NULL, &wait) <= 0){
+			return 0;
+		}
+		if((got = read(tool_fd, buf, size)) <= 0){
+			return 0;
+		}
+		buf  += got;
+		size -= got;
+	}
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 全バイトを送る
+* @param[in] バイト列、バイト数
+* @param[out] 無し
+* @return 1=送った 0=失敗
+* @details
+*/
+static int write_bytes(const uint8_t *buf, size_t size){
+	while(size){
+		ssize_t put = write(tool_fd, buf, size);
+
+		if(put <= 0){
+			return 0;
+		}
+		buf  += put;
+		size -= put;
+	}
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 1コマンドの結果を書き出す
+* @param[in] コマンド、結果
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+static void print_result(const st_remote_cmd *cmd, const uint8_t *result){
+	switch(cmd->op){
+	case REMOTE_OP_INFO:
+		printf("info  version %u cpu %u clock %u\n", result[0], result[1], get32(result + 2));
+		break;
+	case REMOTE_OP_IN8:
+		printf("in8   %04X = %02X\n", cmd->port, result[0]);
+		break;
+	case REMOTE_OP_IN16:
+		printf("in16  %04X = %04X\n", cmd->port, get16(result));
+		break;
+	case REMOTE_OP_OUT8:
+		printf("out8  %04X <- %02X\n", cmd->port, cmd->value);
+		break;
+	case REMOTE_OP_OUT16:
+		printf("out16 %04X <- %04X\n", cmd->port, cmd->value);
+		break;
+	case REMOTE_OP_INS8:
+		printf("ins8  %04X x%u =", cmd->port, cmd->count);
+		for(uint16_t index = 0; index < cmd->count; index++){
+			printf(" %02X", result[index]);
+		}
+		printf("\n");
+		break;
+	case REMOTE_OP_OUTS8:
+		printf("outs8 %04X x%u\n", cmd->port, cmd->count);
+		break;
+	case REMOTE_OP_POLL:
+		printf("poll  %04X & %02X == %02X : %s %02X %u ticks", cmd->port, cmd->value, cmd->expect,
+			(result[0] ? "hit" : "timeout"), result[1], get32(result + 2));
+		if(tool_clock){
+			printf(" (%.1f us)", (double)get32(result + 2) * 1e6 / tool_clock);
+		}
+		printf("\n");
+		break;
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief まとめたコマンドを1フレームで送り、応答を受け取って結果を書き出す
+* @param[in] 1=結果を書き出す 0=書き出さない
+* @param[out] 無し
+* @return 1=すべて実行された 0=エラー
+* @details 応答のSEQとチェックを確かめる。エラーの時は実行されたコマンドの結果までを書き出す。
+*/
+static int flush_frame(int quiet){
+	static const char *errors[] = {"ok", "checksum error", "bad command", "reply too long"};
+	uint8_t head[4];
+	uint8_t sum = 0;
+	uint8_t check;
+	int     ok  = 1;
+
+	if(tool_count == 0){
+		return 1;
+	}
+	head[0] = REMOTE_SOF_REQ;
+	head[1] = tool_seq;
+	head[2] = (uint8_t)tool_req_len;
+	head[3] = (uint8_t)(tool_req_len >> 8);
+	for(int index = 0; index < 4; index++){
+		sum += head[index];
+	}
+	for(uint16_t index = 0; index < tool_req_len; index++){
+		sum += tool_req[index];
+	}
+	check = (uint8_t)-sum;
+	if(!write_bytes(head, 4) || !write_bytes(tool_req, tool_req_len) || !write_bytes(&check, 1)){
+		fprintf(stderr, "iopm_remote: write failed\n");
+		exit(1);
+	}
+
+	uint16_t len;
+	do{
+		if(!read_bytes(head, 1)){
+			fprintf(stderr, "iopm_remote: no reply (seq %u)\n", tool_seq);
+			exit(1);
+		}
+	}while(head[0] != REMOTE_SOF_REPLY);
+	if(!read_bytes(head + 1, 3) || ((len = get16(head + 2)) > REMOTE_FRAME_MAX) || (len < REMOTE_REPLY_HEAD) ||
+		!read_bytes(tool_rep, len) || !read_bytes(&check, 1)){
+		fprintf(stderr, "iopm_remote: broken reply (seq %u)\n", tool_seq);
+		exit(1);
+	}
+	sum = head[0] + head[1] + head[2] + head[3] + check;
+	for(uint16_t index = 0; index < len; index++){
+		sum += tool_rep[index];
+	}
+	if((sum != 0) || (head[1] != tool_seq)){
+		fprintf(stderr, "iopm_remote: bad reply (seq %u)\n", tool_seq);
+		exit(1);
+	}
+
+	uint16_t done = get16(tool_rep + 1);
+	uint16_t pos  = REMOTE_REPLY_HEAD;
+	for(uint16_t index = 0; (index < done) && (index < tool_count); index++){
+		st_remote_cmd *cmd  = &tool_cmds[index];
+		uint16_t       size = tool_result_size[cmd->op] + ((cmd->op == REMOTE_OP_INS8) ? cmd->count : 0);
+
+		if((pos + size) > len){
+			break;
+		}
+		if(cmd->op == REMOTE_OP_INFO){
+			tool_clock = get32(tool_rep + pos + 2);
+		}
+		if(!quiet){
+			print_result(cmd, tool_rep + pos);
+		}
+		pos += size;
+	}
+	if(tool_rep[0] != REMOTE_OK){
+		fprintf(stderr, "iopm_remote: %s after %u of %u commands (seq %u)\n",
+			((tool_rep[0] < 4) ? errors[tool_rep[0]] : "error"), done, tool_count, tool_seq);
+		tool_failed = 1;
+		ok = 0;
+	}
+
+	for(uint16_t index = 0; index < tool_count; index++){
+		free(tool_cmds[index].data);
+	}
+	tool_count   = 0;
+	tool_req_len = 0;
+	tool_rep_len = REMOTE_REPLY_HEAD;
+	tool_seq++;
+	return ok;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief コマンドを今のフレームに加える
+* @param[in] コマンド
+* @param[out] 無し
+* @return 無し
+* @details 要求か応答がREMOTE_FRAME_MAXを超えるなら、先に今のフレームを送る。
+*/
+static void add_command(const st_remote_cmd *cmd){
+	uint16_t need   = 1 + tool_arg_size[cmd->op] + ((cmd->op == REMOTE_OP_OUTS8) ? cmd->count : 0);
+	uint16_t result = tool_result_size[cmd->op] + ((cmd->op == REMOTE_OP_INS8) ? cmd->count : 0);
+	uint8_t *dst;
+
+	if(((tool_req_len + need) > REMOTE_FRAME_MAX) || ((tool_rep_len + result) > REMOTE_FRAME_MAX)){
+		flush_frame(0);
+	}
+	dst = tool_req + tool_req_len;
+	*dst++ = cmd->op;
+	if(cmd->op != REMOTE_OP_INFO){
+		*dst++ = (uint8_t)cmd->port;
+		*dst++ = (uint8_t)(cmd->port >> 8);
+	}
+	switch(cmd->op){
+	case REMOTE_OP_OUT8:
+		*dst++ = (uint8_t)cmd->value;
+		break;
+	case REMOTE_OP_OUT16:
+		*dst++ = (uint8_t)cmd->value;
+		*dst++ = (uint8_t)(cmd->value >> 8);
+		break;
+	case REMOTE_OP_INS8:
+	case REMOTE_OP_OUTS8:
+		*dst++ = (uint8_t)cmd->count;
+		*dst++ = (uint8_t)(cmd->count >> 8);
+		if(cmd->op == REMOTE_OP_OUTS8){
+			memcpy(dst, cmd->data, cmd->count);
+		}
+		break;
+	case REMOTE_OP_POLL:
+		*dst++ = (uint8_t)cmd->value;
+		*dst++ = cmd->expect;
+		*dst++ = (uint8_t)cmd->count;
+		*dst++ = (uint8_t)(cmd->count >> 8);
+		break;
+	}
+	tool_req_len += need;
+	tool_rep_len += result;
+	tool_cmds[tool_count++] = *cmd;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 語の並びからコマンドを1つ読み取る
+* @param[in] 語の並び、語の数
+* @param[out] コマンド
+* @return 使った語の数　0=誤り
+* @details
+*/
+static int parse_command(char **words, int count, st_remote_cmd *cmd){
+	for(size_t index = 0; index < sizeof(tool_ops) / sizeof(tool_ops[0]); index++){
+		unsigned long arg[4] = {0, 0, 0, 0};
+		char         *end;
+
+		if(strcmp(words[0], tool_ops[index].name)){
+			continue;
+		}
+		if(count <= tool_ops[index].args){
+			fprintf(stderr, "iopm_remote: %s needs %u arguments\n", words[0], tool_ops[index].args);
+			return 0;
+		}
+		for(int word = 0; word < tool_ops[index].args; word++){
+			int decimal = ((tool_ops[index].op == REMOTE_OP_INS8) && (word == 1)) || ((tool_ops[index].op == REMOTE_OP_POLL) && (word == 3));
+
+			if((tool_ops[index].op == REMOTE_OP_OUTS8) && (word == 1)){
+				continue;
+			}
+			arg[word] = strtoul(words[1 + word], &end, (decimal ? 10 : 16));
+			if((*end != 0) || (arg[word] > 0xFFFF)){
+				fprintf(stderr, "iopm_remote: bad number %s\n", words[1 + word]);
+				return 0;
+			}
+		}
+		memset(cmd, 0, sizeof(*cmd));
+		cmd->op     = tool_ops[index].op;
+		cmd->port   = (uint16_t)arg[0];
+		cmd->value  = (uint16_t)arg[1];
+		cmd->count  = (uint16_t)arg[1];
+		if(cmd->op == REMOTE_OP_POLL){
+			cmd->expect = (uint8_t)arg[2];
+			cmd->count  = (uint16_t)arg[3];
+		}
+		if(cmd->op == REMOTE_OP_OUTS8){
+			const char *hex = words[2];
+			size_t      len = strlen(hex);
+
+			if((len % 2) || (len == 0) || ((len / 2) > (REMOTE_FRAME_MAX - 5))){
+				fprintf(stderr, "iopm_remote: bad data %s\n", hex);
+				return 0;
+			}
+			cmd->count = (uint16_t)(len / 2);
+			cmd->data  = malloc(cmd->count);
+			for(uint16_t byte = 0; byte < cmd->count; byte++){
+				char pair[3] = {hex[byte * 2], hex[(byte * 2) + 1], 0};
+
+				cmd->data[byte] = (uint8_t)strtoul(pair, &end, 16);
+				if(*end != 0){
+					fprintf(stderr, "iopm_remote: bad data %s\n", hex);
+					free(cmd->data);
+					return 0;
+				}
+			}
+		}
+		if((cmd->op == REMOTE_OP_INS8) && (cmd->count > (REMOTE_FRAME_MAX - REMOTE_REPLY_HEAD))){
+			fprintf(stderr, "iopm_remote: ins8 count too large\n");
+			return 0;
+		}
+		return 1 + tool_ops[index].args;
+	}
+	fprintf(stderr, "iopm_remote: unknown command %s\n", words[0]);
+	return 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 語の並びのコマンドをすべてフレームに加える
+* @param[in] 語の並び、語の数
+* @param[out] 無し
+* @return 1=成功 0=誤りがあった
+* @details
+*/
+static int add_words(char **words, int count){
+	while(count > 0){
+		st_remote_cmd cmd;
+		int           used = parse_command(words, count, &cmd);
+
+		if(used == 0){
+			return 0;
+		}
+		add_command(&cmd);
+		words += used;
+		count -= used;
+	}
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief クライアント本体
+* @param[in] 引数の数、引数
+* @param[out] 無し
+* @return 0=成功 1=通信の誤りかエラーの応答 2=引数やデバイスの誤り
+* @details
+*/
+int main(int argc, char *argv[]){
+	int           baud = 9600;
+	int           arg  = 1;
+	st_remote_cmd info = {REMOTE_OP_INFO, 0, 0, 0, 0, NULL};
+
+	while((arg < argc) && (argv[arg][0] == '-')){
+		if(!strcmp(argv[arg], "-b") && ((arg + 1) < argc)){
+			baud = atoi(argv[arg + 1]);
+		}else if(!strcmp(argv[arg], "-t") && ((arg + 1) < argc)){
+			tool_timeout = atoi(argv[arg + 1]);
+		}else{
+			arg = argc;
+			break;
+		}
+		arg += 2;
+	}
+	if(arg >= argc){
+		fprintf(stderr, "USAGE: iopm_remote [-b baud] [-t seconds] device [command ...]\n");
+		return 2;
+	}
+	if(!open_port(argv[arg], baud)){
+		return 2;
+	}
+	arg++;
+
+	add_command(&info);
+	flush_frame(1);
+
+	if(arg < argc){
+		if(!add_words(&argv[arg], argc - arg)){
+			return 2;
+		}
+	}else{
+		char line[TOOL_LINE_MAX];
+
+		while(fgets(line, sizeof(line), stdin) != NULL){
+			char *words[TOOL_WORDS_MAX];
+			int   count = 0;
+			char *hash  = strchr(line, '#');
+
+			if(hash != NULL){
+				*hash = 0;
+			}
+			for(char *word = strtok(line, " \t\r\n"); (word != NULL) && (count < TOOL_WORDS_MAX); word = strtok(NULL, " \t\r\n")){
+				words[count++] = word;
+			}
+			if(!add_words(words, count)){
+				return 2;
+			}
+		}
+	}
+	flush_frame(0);
+	close(tool_fd);
+	return tool_failed;
+}
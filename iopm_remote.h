@@ -0,0 +1,71 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+* @file iopm_remote.h
+* @brief iopm RS-232Cリモート操作の通信形式
+* @author antarcticlion
+* @date 17Oct2026
+* @details iopm本体（サーバ側、shift+f･10）と、Linux上のクライアントiopm_remoteの両方で使う。
+* @details
+* @details フレームは [SOF][SEQ][長さ 下位][長さ 上位][本体 × 長さ][チェック] のバイト列。
+* @details チェックはSOFからチェックまでの全バイトの和が0（256で割った余り）になる値。数値はすべてリトルエンディアン。
+* @details
+* @details 要求の本体はコマンドの並びで、1フレームにいくつでも（REMOTE_FRAME_MAXまで）詰められる。
+* @details サーバは順に実行し、応答の本体に [状態][実行したコマンド数 16ビット][結果…] を返す。
+* @details 結果はコマンドの順に、結果のあるコマンドの分だけ詰めて並ぶ。途中でエラーになった時は、そこまでの結果を返す。
+* @details 応答のSEQは要求のSEQと同じ値。
+*/
+
+#ifndef IOPM_REMOTE_H
+#define IOPM_REMOTE_H
+
+/// リモート　通信形式の版
+#define REMOTE_VERSION    1
+/// リモート　要求フレームの先頭
+#define REMOTE_SOF_REQ    0x9A
+/// リモート　応答フレームの先頭
+#define REMOTE_SOF_REPLY  0x9B
+/// リモート　フレームの本体の最大バイト数（要求、応答とも）
+#define REMOTE_FRAME_MAX  2048
+/// リモート　フレームの本体以外のバイト数（SOF、SEQ、長さ、チェック）
+#define REMOTE_FRAME_EXTRA 5
+/// リモート　応答の本体の頭のバイト数（状態、実行したコマンド数）
+#define REMOTE_REPLY_HEAD 3
+
+/// コマンド　版と機種情報　→ 版(8) CPU種別(8) PITのクロック[Hz](32)
+#define REMOTE_OP_INFO    0x00
+/// コマンド　8ビット読込　ポート(16) → 値(8)
+#define REMOTE_OP_IN8     0x01
+/// コマンド　16ビット読込　ポート(16) → 値(16)
+#define REMOTE_OP_IN16    0x02
+/// コマンド　8ビット書込　ポート(16) 値(8) → 無し
+#define REMOTE_OP_OUT8    0x03
+/// コマンド　16ビット書込　ポート(16) 値(16) → 無し
+#define REMOTE_OP_OUT16   0x04
+/// コマンド　8ビット連続読込　ポート(16) 回数(16) → 値(8) × 回数
+#define REMOTE_OP_INS8    0x05
+/// コマンド　8ビット連続書込　ポート(16) 回数(16) 値(8) × 回数 → 無し
+#define REMOTE_OP_OUTS8   0x06
+/// コマンド　条件待ち　ポート(16) マスク(8) 期待値(8) 上限[ms](16) → 成立(8) 最後の値(8) 経過カウント(32)
+#define REMOTE_OP_POLL    0x07
+
+/// 応答の状態　すべて実行した
+#define REMOTE_OK         0
+/// 応答の状態　要求のチェックが合わない（何も実行していない）
+#define REMOTE_ERR_CHECK  1
+/// 応答の状態　知らないコマンドか、コマンドの途中で本体が終わっている
+#define REMOTE_ERR_OP     2
+/// 応答の状態　結果が応答に入りきらない
+#define REMOTE_ERR_LONG   3
+
+#endif
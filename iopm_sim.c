@@ -0,0 +1,1205 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+//-------------------------------------------------------------------------
+/**
+* @file iopm_sim.c
+* @brief iopm ハードウェア抽象化層　Linux上の模擬PC-98
+* @author antarcticlion
+* @date 17Oct2026
+* @details iopm.cをLinuxのgccでそのままビルドして動かすための模擬環境。'make host'でiopm_hostができる。
+* @details
+* @details I/Oポート：書いた値をそのまま読み返すラッチ。未使用ポートは0xFFを返す。
+* @details 　　　　　　PITカウンタ0(0x71/0x77)は実時間から2.4576MHzで作り、GDCステータス(0x60)は読むたびにVSYNCが反転する。
+* @details 　　　　　　DMAC(0x01～0x27の奇数)は8237の動作を模擬し、チャネル1に模擬ボードがつながっている。
+* @details メモリ　　：1MB+64KBの配列。テキストVRAM(A000h/A200h)、BIOSワークエリアもこの中にある。
+* @details キーボード：環境変数IOPM_KEYSに空白区切りで書いたキーを順に返す。使い切った後はESCを返し続ける。
+* @details 　　　　　　ESC SPACE RET UP DOWN LEFT RIGHT ROLLUP ROLLDOWN HOME F1～F10、16進のキーコード、NONE（1回だけ入力なし）。
+* @details 　　　　　　DUMPは1回だけ入力なしを返し、その時点の画面を標準出力に書き出す。WAITは1回だけ入力なしを返し、100ms待つ。
+* @details 　　　　　　頭にS-を付けるとSHIFTを押したことになる。
+* @details ファイル　：カレントディレクトリのファイルをそのまま読み書きする。
+* @details 画面　　　：環境変数IOPM_DUMPが設定されていれば、終了時にテキストVRAMの内容を標準出力に書き出す。
+* @details RS-232C　 ：環境変数IOPM_SERIALにパスを書くと、8251(0x30/0x32)を疑似端末につなぎ、そのパスに端末へのリンクを作る。
+* @details 　　　　　　iopm_remoteにそのパスを渡すと、実機と同じ通信形式で試せる。通信速度の設定は無視する。
+*/
+//-------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <iconv.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "iopm_hal.h"
+
+/// 模擬メモリの大きさ　FFFF:FFFFまで届くように1MB+64KB
+#define SIM_MEM_SIZE   0x110000
+/// 模擬メモリ　DOSに見立ててhal_far_alloc()で割り当てる先頭セグメント
+#define SIM_HEAP_START 0x1000
+/// 模擬メモリ　hal_far_alloc()で割り当てられる終端セグメント
+#define SIM_HEAP_END   0xA000
+/// 模擬ファイル　同時に開けるファイル数
+#define SIM_FILES_MAX  4
+/// 模擬キーボード　キーの最大数
+#define SIM_KEYS_MAX   1024
+/// 模擬キーボード　入力なしを表すキー
+#define SIM_KEY_NONE   0xFFFF
+/// 模擬キーボード　入力なしで画面を書き出すキー
+#define SIM_KEY_DUMP   0xFFFE
+/// 模擬キーボード　入力なしで100ms待つキー
+#define SIM_KEY_WAIT   0xFFFD
+/// 模擬DMAC　DREQを出し続ける模擬ボードのチャネル
+#define SIM_DMA_BOARD_CH 1
+
+/// 模擬PC-98のメモリ空間
+uint8_t sim_mem[SIM_MEM_SIZE];
+/// テキストVRAMに書き込んだセル数（ベンチマーク用）
+uint32_t sim_vram_cells = 0;
+
+/// 模擬I/Oポート　ラッチ
+static uint8_t  sim_port[0x10000];
+/// 模擬ファイル　開いているファイル
+static FILE    *sim_files[SIM_FILES_MAX];
+/// 次に割り当てるセグメント
+static uint16_t sim_heap = SIM_HEAP_START;
+/// PITカウンタ0　ラッチした値
+static uint16_t sim_pit_latch = 0;
+/// PITカウンタ0　0=次は下位バイト 1=次は上位バイト
+static uint8_t  sim_pit_msb = 0;
+/// PITカウンタ0　1周のカウント数（書き込んだ初期値、0なら65536）
+static uint32_t sim_pit_reload = 0x10000;
+/// PITカウンタ0　初期値の下位バイト
+static uint8_t  sim_pit_load_low = 0;
+/// PITカウンタ0　0=次の書き込みは下位バイト 1=上位バイト
+static uint8_t  sim_pit_load_msb = 0;
+/// PIT　計時の起点
+static struct timespec sim_pit_epoch;
+/// 模擬DMAC（8237）　チャネルごとのベースアドレス、ベースカウント、現在アドレス、現在カウント
+static uint16_t sim_dma_base_addr[4], sim_dma_base_count[4], sim_dma_addr[4], sim_dma_count[4];
+/// 模擬DMAC　チャネルごとのモードレジスタ
+static uint8_t  sim_dma_mode[4];
+/// 模擬DMAC　チャネルごとのバンク（A16～A19）
+static uint8_t  sim_dma_bank[4];
+/// 模擬DMAC　マスク（bit0～3）　リセット時は全チャネルマスク
+static uint8_t  sim_dma_mask = 0x0F;
+/// 模擬DMAC　ソフトウェア要求（bit0～3）
+static uint8_t  sim_dma_request = 0;
+/// 模擬DMAC　ターミナルカウントに達したチャネル（bit0～3）　ステータスを読むと消える
+static uint8_t  sim_dma_tc = 0;
+/// 模擬DMAC　バイトポインタのフリップフロップ　0=下位 1=上位
+static uint8_t  sim_dma_ff = 0;
+/// 模擬DMAC　チャネルごとに転送を進めた時刻（PITのカウント数）
+static uint64_t sim_dma_time[4];
+/// 模擬DMAC　模擬ボードが出すデータの番号（1バイトごとに1増え、A5hとの排他的論理和を出す）
+static uint8_t  sim_dma_data = 0;
+/// 模擬RS-232C　疑似端末のマスタ側　-1=つないでいない
+static int      sim_serial_fd = -1;
+/// 模擬RS-232C　疑似端末のスレーブ側（相手がいない間も開けておき、エコーを止めておく）
+static int      sim_serial_slave = -1;
+/// 模擬RS-232C　作ったリンクのパス
+static char    *sim_serial_link = NULL;
+/// 模擬RS-232C　受け取って、まだ読まれていないバイト　-1=無し
+static int      sim_serial_rx = -1;
+/// タイマ割り込み　0=元のまま 1=乗っ取っている
+static uint8_t  sim_tick_hooked = 0;
+/// GDCステータス　VSYNCビット
+static uint8_t  sim_vsync = 0;
+/// 模擬キーボード　キー列　上位8ビットがシフト状態、下位8ビットがキーコード
+static uint16_t sim_keys[SIM_KEYS_MAX];
+/// 模擬キーボード　キーの数
+static uint16_t sim_key_count = 0;
+/// 模擬キーボード　次に返すキー
+static uint16_t sim_key_next = 0;
+/// 模擬キーボード　1キー分のスキャンコード列（SHIFTの押し離しを含めて最大4個）
+static uint8_t  sim_kb_codes[4];
+/// 模擬キーボード　スキャンコード列の数
+static uint8_t  sim_kb_count = 0;
+/// 模擬キーボード　スキャンコード列の次に返す位置
+static uint8_t  sim_kb_next = 0;
+/// 割り込み監視　0=元のまま 1=乗っ取っている
+static uint8_t  sim_irq_hooked = 0;
+/// 割り込み監視　IRQごとの回数
+static uint32_t sim_irq_counts[HAL_IRQ_LINES];
+/// 割り込み監視　記録（IRQ番号、タイマ割り込みの回数、PITカウンタ0の値）
+static struct {
+	uint8_t  line;
+	uint32_t ticks;
+	uint16_t phase;
+} sim_irq_events[256];
+/// 割り込み監視　次に書き込む位置
+static uint8_t  sim_irq_head = 0;
+/// 割り込み監視　次に読む位置
+static uint8_t  sim_irq_tail = 0;
+/// 割り込み監視　記録が一杯で捨てた数
+static uint16_t sim_irq_lost = 0;
+/// 割り込み監視　IRQ0として記録済みのタイマ割り込みの回数
+static uint32_t sim_irq_ticks = 0;
+/// 割り込み監視　IRQ1として記録済みのキーの位置
+static uint16_t sim_irq_keys = 0;
+
+/// キー名とキーコードの対応
+static const struct {
+	const char *name;
+	uint8_t     code;
+} sim_key_names[] = {
+	{"ESC",      0x00}, {"SPACE",    0x34}, {"RET",      0x1C},
+	{"UP",       0x3A}, {"LEFT",     0x3B}, {"RIGHT",    0x3C}, {"DOWN",     0x3D},
+	{"ROLLUP",   0x36}, {"ROLLDOWN", 0x37}, {"HOME",     0x3E},
+	{"F1",       0x62}, {"F2",       0x63}, {"F3",       0x64}, {"F4",       0x65}, {"F5",       0x66},
+	{"F6",       0x67}, {"F7",       0x68}, {"F8",       0x69}, {"F9",       0x6A}, {"F10",      0x6B},
+};
+
+//-------------------------------------------------------------------------
+/**
+* @brief 計時の起点からの経過時間をPITのカウント数で返す
+* @param[in] 無し
+* @param[out] 無し
+* @return 経過カウント（2.4576MHz）
+* @details
+*/
+static uint64_t sim_pit_ticks(void){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t ns = (uint64_t)(now.tv_sec - sim_pit_epoch.tv_sec) * 1000000000ULL + now.tv_nsec - sim_pit_epoch.tv_nsec;
+	return (ns * 24576ULL) / 10000000ULL;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 模擬DMACの転送を進める
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details マスクの外れたチャネルで、DREQがあれば前回からの経過カウント1つにつき1バイト転送する（約2.4MB/s）。
+* @details DREQは模擬ボード（SIM_DMA_BOARD_CH）が出し続ける。ソフトウェア要求は残りを一度に転送する。
+* @details 転送の種類がライト（I/O→メモリ）なら模擬ボードのデータを書き、リード（メモリ→I/O）ならメモリは変えない。
+*/
+static void sim_dma_run(void){
+	uint64_t now = sim_pit_ticks();
+
+	for(uint8_t ch = 0; ch < 4; ch++){
+		uint8_t  bit  = (uint8_t)(1 << ch);
+		uint64_t bytes;
+
+		if(sim_dma_mask & bit){
+			sim_dma_time[ch] = now;
+			continue;
+		}
+		if(sim_dma_request & bit){
+			bytes = 0x10000;
+		}else if(ch == SIM_DMA_BOARD_CH){
+			bytes = now - sim_dma_time[ch];
+		}else{
+			bytes = 0;
+		}
+		sim_dma_time[ch] = now;
+		while(bytes--){
+			uint32_t phys = ((uint32_t)sim_dma_bank[ch] << 16) | sim_dma_addr[ch];
+
+			if((sim_dma_mode[ch] & 0x0C) == 0x04){
+				sim_mem[phys] = (uint8_t)(sim_dma_data++ ^ 0xA5);
+			}
+			sim_dma_addr[ch] += ((sim_dma_mode[ch] & 0x20) ? -1 : 1);
+			if(sim_dma_count[ch]-- == 0){
+				sim_dma_tc      |= bit;
+				sim_dma_request &= ~bit;
+				if(sim_dma_mode[ch] & 0x10){
+					sim_dma_addr[ch]  = sim_dma_base_addr[ch];
+					sim_dma_count[ch] = sim_dma_base_count[ch];
+				}else{
+					sim_dma_mask |= bit;
+				}
+				break;
+			}
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 模擬DMACのアドレス/カウントの16ビットレジスタを1バイト書く
+* @param[in] レジスタ、値
+* @param[out] 無し
+* @return 無し
+* @details フリップフロップで下位、上位を交互に書く。
+*/
+static void sim_dma_write16(uint16_t *reg, uint8_t value){
+	*reg = (sim_dma_ff ? ((*reg & 0x00FF) | ((uint16_t)value << 8)) : ((*reg & 0xFF00) | value));
+	sim_dma_ff ^= 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 模擬DMACの読み込み
+* @param[in] ポート（01h～27hの奇数）
+* @param[out] 無し
+* @return 値
+* @details アドレスとカウントは現在値を、フリップフロップで下位、上位の順に返す。
+*/
+static uint8_t sim_dma_in(uint16_t port){
+	uint8_t value;
+
+	sim_dma_run();
+	if(port < 0x10){
+		uint8_t  ch  = (uint8_t)(port >> 2);
+		uint16_t reg = ((port & 0x02) ? sim_dma_count[ch] : sim_dma_addr[ch]);
+
+		value = (uint8_t)(sim_dma_ff ? (reg >> 8) : reg);
+		sim_dma_ff ^= 1;
+		return value;
+	}
+	if(port == 0x11){
+		value = (uint8_t)(sim_dma_tc | (sim_dma_request << 4));
+		sim_dma_tc = 0;
+		return value;
+	}
+	return sim_port[port];
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 模擬DMACへの書き込み
+* @param[in] ポート（01h～27hの奇数）、値
+* @param[out] 無し
+* @return 無し
+* @details アドレスとカウントはベースと現在の両方に書く。バンクはチャネル0～3が27h、21h、23h、25h。
+*/
+static void sim_dma_out(uint16_t port, uint8_t value){
+	uint8_t ch = value & 0x03;
+
+	sim_dma_run();
+	if(port < 0x10){
+		ch = (uint8_t)(port >> 2);
+		if(port & 0x02){
+			sim_dma_write16(&sim_dma_base_count[ch], value);
+			sim_dma_ff ^= 1;
+			sim_dma_write16(&sim_dma_count[ch], value);
+		}else{
+			sim_dma_write16(&sim_dma_base_addr[ch], value);
+			sim_dma_ff ^= 1;
+			sim_dma_write16(&sim_dma_addr[ch], value);
+		}
+		return;
+	}
+	switch(port){
+	case 0x13: //リクエスト
+		sim_dma_request = ((value & 0x04) ? (sim_dma_request | (1 << ch)) : (sim_dma_request & ~(1 << ch)));
+		break;
+	case 0x15: //シングルマスク
+		sim_dma_mask = ((value & 0x04) ? (sim_dma_mask | (1 << ch)) : (sim_dma_mask & ~(1 << ch)));
+		break;
+	case 0x17: //モード
+		sim_dma_mode[ch] = value;
+		break;
+	case 0x19: //フリップフロップのクリア
+		sim_dma_ff = 0;
+		break;
+	case 0x1B: //マスタクリア
+		sim_dma_ff      = 0;
+		sim_dma_mask    = 0x0F;
+		sim_dma_request = 0;
+		sim_dma_tc      = 0;
+		break;
+	case 0x1D: //マスクのクリア
+		sim_dma_mask = 0;
+		break;
+	case 0x1F: //全マスク
+		sim_dma_mask = value & 0x0F;
+		break;
+	case 0x21: //バンク　チャネル1
+	case 0x23: //バンク　チャネル2
+	case 0x25: //バンク　チャネル3
+	case 0x27: //バンク　チャネル0
+		sim_dma_bank[((port - 0x21) / 2 + 1) & 0x03] = value & 0x0F;
+		break;
+	default:
+		break;
+	}
+	sim_port[port] = value;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 模擬RS-232Cを疑似端末につなぐ
+* @param[in] リンクを作るパス
+* @param[out] 無し
+* @return 無し
+* @details スレーブ側はローモードにしておく。パスに既にあるものは消してからリンクを作る。
+*/
+static void sim_serial_open(const char *link){
+	struct termios tio;
+	const char    *name;
+
+	sim_serial_fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if((sim_serial_fd < 0) || grantpt(sim_serial_fd) || unlockpt(sim_serial_fd) || ((name = ptsname(sim_serial_fd)) == NULL)){
+		fprintf(stderr, "iopm_host: cannot open a pseudo terminal\n");
+		exit(1);
+	}
+	sim_serial_slave = open(name, O_RDWR | O_NOCTTY);
+	if((sim_serial_slave >= 0) && (tcgetattr(sim_serial_slave, &tio) == 0)){
+		cfmakeraw(&tio);
+		tcsetattr(sim_serial_slave, TCSANOW, &tio);
+	}
+	fcntl(sim_serial_fd, F_SETFL, fcntl(sim_serial_fd, F_GETFL) | O_NONBLOCK);
+	unlink(link);
+	if(symlink(name, link) != 0){
+		fprintf(stderr, "iopm_host: cannot link %s to %s\n", link, name);
+		exit(1);
+	}
+	sim_serial_link = strdup(link);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 模擬8251の受信バッファを埋める
+* @param[in] 無し
+* @param[out] 無し
+* @return 1=受信バイトあり 0=無し
+* @details
+*/
+static int sim_serial_poll(void){
+	uint8_t byte;
+
+	if((sim_serial_rx < 0) && (sim_serial_fd >= 0) && (read(sim_serial_fd, &byte, 1) == 1)){
+		sim_serial_rx = byte;
+	}
+	return (sim_serial_rx >= 0);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 8ビット読み込み
+* @param[in] ポート
+* @param[out] 無し
+* @return 値
+* @details
+*/
+uint8_t port_in8(uint16_t port){
+	switch(port){
+	case 0x0060: //GDCステータス
+		sim_vsync ^= 0x20;
+		return (sim_port[port] & ~0x20) | sim_vsync;
+	case 0x0071: //PITカウンタ0
+		sim_pit_msb ^= 1;
+		return (sim_pit_msb ? (uint8_t)sim_pit_latch : (uint8_t)(sim_pit_latch >> 8));
+	case 0x0030: //8251データ
+		if(sim_serial_poll()){
+			uint8_t byte = (uint8_t)sim_serial_rx;
+
+			sim_serial_rx = -1;
+			return byte;
+		}
+		return sim_port[port];
+	case 0x0032: //8251ステータス　DSR、送信可、送信空は常に立てる
+		return (uint8_t)(0x85 | (sim_serial_poll() ? 0x02 : 0x00));
+	default:
+		if((port < 0x0028) && (port & 1)){
+			return sim_dma_in(port);
+		}
+		return sim_port[port];
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 16ビット読み込み
+* @param[in] ポート
+* @param[out] 無し
+* @return 値
+* @details ポートとポート+1を続けて読む。
+*/
+uint16_t port_in16(uint16_t port){
+	uint16_t value = port_in8(port);
+	return value | ((uint16_t)port_in8(port + 1) << 8);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 8ビット書き込み
+* @param[in] ポート、値
+* @param[out] 無し
+* @return 無し
+* @details PITのカウンタ0のラッチと初期値の書き込み、DMAC（01h～27hの奇数）、8251の送信を解釈し、あとはラッチに残す。
+* @details カウンタは起点から初期値ごとに一周する。初期値を書き換えても起点は変えない。
+*/
+void port_out8(uint16_t port, uint8_t value){
+	if((port < 0x0028) && (port & 1)){
+		sim_dma_out(port, value);
+		return;
+	}
+	if((port == 0x0030) && (sim_serial_fd >= 0)){
+		while((write(sim_serial_fd, &value, 1) < 0) && (sim_serial_slave >= 0)){
+			hal_idle();						//相手が読むまで待つ
+		}
+	}
+	if((port == 0x0077) && ((value & 0xF0) == 0x00)){
+		sim_pit_latch = (uint16_t)(sim_pit_reload - (sim_pit_ticks() % sim_pit_reload));
+		sim_pit_msb   = 0;
+		return;
+	}
+	if((port == 0x0077) && ((value & 0xC0) == 0x00)){
+		sim_pit_msb      = 0;
+		sim_pit_load_msb = 0;
+	}
+	if(port == 0x0071){
+		if(!sim_pit_load_msb){
+			sim_pit_load_low = value;
+		}else{
+			sim_pit_reload = ((uint32_t)value << 8) | sim_pit_load_low;
+			if(sim_pit_reload == 0){
+				sim_pit_reload = 0x10000;
+			}
+		}
+		sim_pit_load_msb ^= 1;
+	}
+	sim_port[port] = value;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 16ビット書き込み
+* @param[in] ポート、値
+* @param[out] 無し
+* @return 無し
+* @details ポートとポート+1に続けて書く。
+*/
+void port_out16(uint16_t port, uint16_t value){
+	port_out8(port, (uint8_t)value);
+	port_out8(port + 1, (uint8_t)(value >> 8));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キー列を解釈する
+* @param[in] キー列の文字列
+* @param[out] 無し
+* @return 無し
+* @details 知らないキー名は無視する。
+*/
+static void sim_parse_keys(const char *text){
+	char *copy = strdup(text);
+	char *token;
+
+	for(token = strtok(copy, " \t\r\n,"); (token != NULL) && (sim_key_count < SIM_KEYS_MAX); token = strtok(NULL, " \t\r\n,")){
+		uint16_t shift = 0;
+		int      found = 0;
+
+		if(!strcmp(token, "NONE")){
+			sim_keys[sim_key_count++] = SIM_KEY_NONE;
+			continue;
+		}
+		if(!strcmp(token, "DUMP")){
+			sim_keys[sim_key_count++] = SIM_KEY_DUMP;
+			continue;
+		}
+		if(!strcmp(token, "WAIT")){
+			sim_keys[sim_key_count++] = SIM_KEY_WAIT;
+			continue;
+		}
+		if(!strncmp(token, "S-", 2)){
+			shift  = 0x0100;
+			token += 2;
+		}
+		for(size_t index = 0; index < sizeof(sim_key_names) / sizeof(sim_key_names[0]); index++){
+			if(!strcmp(token, sim_key_names[index].name)){
+				sim_keys[sim_key_count++] = shift | sim_key_names[index].code;
+				found = 1;
+				break;
+			}
+		}
+		if(!found){
+			char *end;
+			unsigned long code = strtoul(token, &end, 16);
+			if((*end == '\0') && (end != token) && (code < 0x80)){
+				sim_keys[sim_key_count++] = shift | (uint16_t)code;
+			}else{
+				fprintf(stderr, "iopm_sim: unknown key '%s'\n", token);
+			}
+		}
+	}
+	free(copy);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief テキストVRAMの内容をUTF-8で書き出す
+* @param[in] 出力先
+* @param[out] 無し
+* @return 無し
+* @details 漢字はJISコードをEUC-JPに直してからiconvでUTF-8にする。罫線の半角グラフィック文字は+-|で表す。
+*/
+void sim_dump_screen(FILE *out){
+	uint16_t *code = (uint16_t *)MK_FP(0xA000, 0x0000);
+	iconv_t   conv = iconv_open("UTF-8", "EUC-JP");
+
+	for(int y = 0; y < 25; y++){
+		char  line[80 * 4 + 1];
+		char  utf8[80 * 6 + 1];
+		char *dst = line;
+
+		for(int x = 0; x < 80; x++){
+			uint16_t cell = code[(y * 80) + x];
+			if(cell & 0xFF00){
+				if(!(cell & 0x0080)){		//漢字の左半分
+					*dst++ = (char)(((cell & 0x7F) + 0x20) | 0x80);
+					*dst++ = (char)((cell >> 8) | 0x80);
+				}
+			}else if((cell >= 0xA1) && (cell <= 0xDF)){
+				*dst++ = (char)0x8E;		//半角カナ
+				*dst++ = (char)cell;
+			}else if((cell == 0x95)){
+				*dst++ = '-';
+			}else if((cell == 0x96)){
+				*dst++ = '|';
+			}else if((cell >= 0x80)){
+				*dst++ = '+';
+			}else if((cell < 0x20)){
+				*dst++ = ' ';
+			}else{
+				*dst++ = (char)cell;
+			}
+		}
+		*dst = '\0';
+
+		char  *in       = line;
+		char  *out_ptr  = utf8;
+		size_t in_left  = (size_t)(dst - line);
+		size_t out_left = sizeof(utf8) - 1;
+		if((conv == (iconv_t)-1) || (iconv(conv, &in, &in_left, &out_ptr, &out_left) == (size_t)-1)){
+			out_ptr = utf8 + sprintf(utf8, "%s", line);
+		}
+		*out_ptr = '\0';
+		while((out_ptr > utf8) && (out_ptr[-1] == ' ')){
+			*--out_ptr = '\0';
+		}
+		fprintf(out, "%s\n", utf8);
+	}
+	if(conv != (iconv_t)-1){
+		iconv_close(conv);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 終了時の画面出力
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details atexit()に登録して使う。
+*/
+static void sim_exit(void){
+	if(getenv("IOPM_DUMP") != NULL){
+		sim_dump_screen(stdout);
+	}
+	if(sim_serial_link != NULL){
+		unlink(sim_serial_link);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 初期化
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 未使用ポートを0xFFにし、キー列を読み込み、RS-232Cを疑似端末につなぎ、終了時の画面出力を登録する。
+*/
+void hal_init(void){
+	const char *keys   = getenv("IOPM_KEYS");
+	const char *serial = getenv("IOPM_SERIAL");
+
+	memset(sim_port, 0xFF, sizeof(sim_port));
+	sim_port[0x0002] = 0x00;				//PICマスク
+	clock_gettime(CLOCK_MONOTONIC, &sim_pit_epoch);
+	if(keys != NULL){
+		sim_parse_keys(keys);
+	}
+	if(serial != NULL){
+		sim_serial_open(serial);
+	}
+	atexit(sim_exit);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief CPUの種別を調べる
+* @param[in] 無し
+* @param[out] 無し
+* @return 常にCPU_286
+* @details 環境変数IOPM_CPUに0～3を書くとその種別にする。
+*/
+uint8_t hal_detect_cpu(void){
+	const char *cpu = getenv("IOPM_CPU");
+
+	if((cpu != NULL) && (cpu[0] >= '0') && (cpu[0] <= '3')){
+		return (uint8_t)(cpu[0] - '0');
+	}
+	return CPU_286;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 模擬メモリを割り当てる
+* @param[in] 大きさ（パラグラフ数）
+* @param[out] 無し
+* @return セグメント　確保できなければ0
+* @details 先頭から順に割り当てるだけで、解放はしない。
+*/
+uint16_t hal_far_alloc(uint16_t paras){
+	uint16_t seg = sim_heap;
+
+	if(((uint32_t)sim_heap + paras) > SIM_HEAP_END){
+		return 0;
+	}
+	sim_heap += paras;
+	return seg;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ニアメモリからファーメモリへワード単位でブロック転送する
+* @param[in] 転送先、転送元、ワード数
+* @param[out] 無し
+* @return 無し
+* @details 転送先がテキストVRAMの文字コード領域(A000h～A1FFh)ならsim_vram_cellsに数える。属性領域へは同じ範囲を書くので数えない。
+*/
+void hal_copy_to_far(uint16_t __far *dst, const uint16_t *src, uint16_t count){
+	uint32_t addr = (uint32_t)((uint8_t *)dst - sim_mem);
+
+	if((addr >= 0xA0000) && (addr < 0xA2000)){
+		sim_vram_cells += count;
+	}
+	memcpy(dst, src, (size_t)count * 2);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファーメモリからニアメモリへワード単位でブロック転送する
+* @param[in] 転送先、転送元、ワード数
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void hal_copy_from_far(uint16_t *dst, const uint16_t __far *src, uint16_t count){
+	memcpy(dst, src, (size_t)count * 2);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファーメモリ同士をワード単位で比べ、最初に違うワードを探す
+* @param[in] 比べる2つの領域、ワード数
+* @param[out] 無し
+* @return 最初に違うワードの番号　全部同じならワード数
+* @details
+*/
+uint16_t hal_far_compare(const uint16_t __far *a, const uint16_t __far *b, uint16_t count){
+	uint16_t index = 0;
+
+	while((index < count) && (a[index] == b[index])){
+		index++;
+	}
+	return index;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 8ビット連続読み込み
+* @param[in] ポート、格納先、回数
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void hal_ins8(uint16_t port, uint8_t __far *buf, uint16_t count){
+	while(count--){
+		*buf++ = port_in8(port);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 16ビット連続読み込み
+* @param[in] ポート、格納先、回数
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void hal_ins16(uint16_t port, uint16_t __far *buf, uint16_t count){
+	while(count--){
+		*buf++ = port_in16(port);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 8ビット連続書き込み
+* @param[in] ポート、書き込むデータ、回数
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void hal_outs8(uint16_t port, uint8_t __far *buf, uint16_t count){
+	while(count--){
+		port_out8(port, *buf++);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 16ビット連続書き込み
+* @param[in] ポート、書き込むデータ、回数
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void hal_outs16(uint16_t port, uint16_t __far *buf, uint16_t count){
+	while(count--){
+		port_out16(port, *buf++);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファイルを新しく作る
+* @param[in] ファイル名
+* @param[out] ハンドル
+* @return 1=成功 0=失敗（同じ名前のファイルがある場合も失敗）
+* @details カレントディレクトリに作る。ハンドルはsim_files[]の番号+1。
+*/
+uint8_t hal_file_create(const char *name, uint16_t *handle){
+	for(uint16_t index = 0; index < SIM_FILES_MAX; index++){
+		if(sim_files[index] == NULL){
+			if((sim_files[index] = fopen(name, "wbx")) == NULL){
+				return 0;
+			}
+			*handle = index + 1;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファイルを読み込み用に開く
+* @param[in] ファイル名
+* @param[out] ハンドル
+* @return 1=成功 0=失敗
+* @details
+*/
+uint8_t hal_file_open(const char *name, uint16_t *handle){
+	for(uint16_t index = 0; index < SIM_FILES_MAX; index++){
+		if(sim_files[index] == NULL){
+			if((sim_files[index] = fopen(name, "rb")) == NULL){
+				return 0;
+			}
+			*handle = index + 1;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファイルから読み込む
+* @param[in] ハンドル、格納先、バイト数
+* @param[out] 無し
+* @return 読み込めたバイト数
+* @details
+*/
+uint16_t hal_file_read(uint16_t handle, void __far *buf, uint16_t count){
+	if((handle == 0) || (handle > SIM_FILES_MAX) || (sim_files[handle - 1] == NULL)){
+		return 0;
+	}
+	return (uint16_t)fread(buf, 1, count, sim_files[handle - 1]);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファイルに書き込む
+* @param[in] ハンドル、書き込むデータ、バイト数
+* @param[out] 無し
+* @return 書き込めたバイト数
+* @details
+*/
+uint16_t hal_file_write(uint16_t handle, const void __far *buf, uint16_t count){
+	if((handle == 0) || (handle > SIM_FILES_MAX) || (sim_files[handle - 1] == NULL)){
+		return 0;
+	}
+	return (uint16_t)fwrite(buf, 1, count, sim_files[handle - 1]);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ファイルを閉じる
+* @param[in] ハンドル
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void hal_file_close(uint16_t handle){
+	if((handle == 0) || (handle > SIM_FILES_MAX) || (sim_files[handle - 1] == NULL)){
+		return;
+	}
+	fclose(sim_files[handle - 1]);
+	sim_files[handle - 1] = NULL;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief タイマ割り込みを乗っ取る
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 模擬環境には割り込みが無いので、乗っ取ったことだけを覚える。
+*/
+void hal_tick_hook(void){
+	sim_tick_hooked = 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief タイマ割り込みを元に戻す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void hal_tick_unhook(void){
+	sim_tick_hooked = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief タイマ割り込みの回数
+* @param[in] 無し
+* @param[out] 無し
+* @return 割り込み回数
+* @details PITカウンタ0が一周した回数を実時間から求める。乗っ取っていなければ0。
+*/
+uint32_t hal_tick_count(void){
+	if(!sim_tick_hooked){
+		return 0;
+	}
+	return (uint32_t)(sim_pit_ticks() / sim_pit_reload);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 次の割り込みまでCPUを止める
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details HLTの代わりに100us眠る。
+*/
+void hal_idle(void){
+	struct timespec wait = {0, 100000};
+
+	nanosleep(&wait, NULL);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みを止める
+* @param[in] 無し
+* @param[out] 無し
+* @return 止める前のフラグ
+* @details 模擬環境には割り込みが無いので何もしない。
+*/
+uint16_t hal_int_save(void){
+	return 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みの許可を元に戻す
+* @param[in] hal_int_save()が返したフラグ
+* @param[out] 無し
+* @return 無し
+* @details 模擬環境には割り込みが無いので何もしない。
+*/
+void hal_int_restore(uint16_t flags){
+	(void)flags;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みの記録を1件書く
+* @param[in] IRQ番号、タイマ割り込みの回数、PITカウンタ0の値
+* @param[out] 無し
+* @return 無し
+* @details 実機の割り込み処理と同じく、回数は必ず増やし、記録が一杯なら捨てた数を増やす。
+*/
+static void sim_irq_put(uint8_t line, uint32_t ticks, uint16_t phase){
+	sim_irq_counts[line]++;
+	if((uint8_t)(sim_irq_head + 1) == sim_irq_tail){
+		sim_irq_lost++;
+		return;
+	}
+	sim_irq_events[sim_irq_head].line  = line;
+	sim_irq_events[sim_irq_head].ticks = ticks;
+	sim_irq_events[sim_irq_head].phase = phase;
+	sim_irq_head++;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 前回からの割り込みを記録に起こす
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details PITカウンタ0が一周するごとにIRQ0、キー列から読んだキーのスキャンコード1個ごとにIRQ1が起きたものとする。
+*/
+static void sim_irq_pump(void){
+	uint64_t now   = sim_pit_ticks();
+	uint32_t ticks = (uint32_t)(now / sim_pit_reload);
+
+	while(sim_irq_ticks < ticks){
+		sim_irq_ticks++;
+		sim_irq_put(0, sim_irq_ticks, (uint16_t)sim_pit_reload);
+	}
+	while(sim_irq_keys < sim_key_next){
+		uint16_t key   = sim_keys[sim_irq_keys++];
+		uint8_t  codes = ((key >= SIM_KEY_WAIT) ? 0 : ((key & 0x0100) ? 4 : 2));
+
+		while(codes--){
+			sim_irq_put(1, ticks, (uint16_t)(sim_pit_reload - (now % sim_pit_reload)));
+		}
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 全IRQの割り込みを監視する
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 回数と記録は0から数え直す。
+*/
+void hal_irq_hook(void){
+	memset(sim_irq_counts, 0, sizeof(sim_irq_counts));
+	sim_irq_head   = 0;
+	sim_irq_tail   = 0;
+	sim_irq_lost   = 0;
+	sim_irq_ticks  = (uint32_t)(sim_pit_ticks() / sim_pit_reload);
+	sim_irq_keys   = sim_key_next;
+	sim_irq_hooked = 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みの監視をやめる
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+void hal_irq_unhook(void){
+	sim_irq_hooked = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief IRQごとの割り込み回数
+* @param[in] IRQ番号
+* @param[out] 無し
+* @return hal_irq_hook()からの回数
+* @details
+*/
+uint32_t hal_irq_count(uint8_t line){
+	if(sim_irq_hooked){
+		sim_irq_pump();
+	}
+	return sim_irq_counts[line];
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 割り込みの記録を1件取り出す
+* @param[in] 無し
+* @param[out] IRQ番号、その時のタイマ割り込みの回数、PITカウンタ0の値
+* @return 1=取り出した 0=無い
+* @details
+*/
+uint8_t hal_irq_get(uint8_t *line, uint32_t *ticks, uint16_t *phase){
+	if(sim_irq_hooked){
+		sim_irq_pump();
+	}
+	if(sim_irq_tail == sim_irq_head){
+		return 0;
+	}
+	*line  = sim_irq_events[sim_irq_tail].line;
+	*ticks = sim_irq_events[sim_irq_tail].ticks;
+	*phase = sim_irq_events[sim_irq_tail].phase;
+	sim_irq_tail++;
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 記録が一杯で捨てた割り込みの数
+* @param[in] 無し
+* @param[out] 無し
+* @return 件数
+* @details
+*/
+uint16_t hal_irq_dropped(void){
+	return sim_irq_lost;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 入力なしのキー（NONE、DUMP、WAIT）を処理する
+* @param[in] キー
+* @param[out] 無し
+* @return 無し
+* @details
+*/
+static void sim_key_special(uint16_t key){
+	if(key == SIM_KEY_DUMP){
+		sim_dump_screen(stdout);
+	}else if(key == SIM_KEY_WAIT){
+		struct timespec wait = {0, 100000000};
+
+		nanosleep(&wait, NULL);
+	}
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボードの初期化
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details BIOSのキーバッファの入力数(0000:0528)に残りのキー数を入れておく。
+*/
+void kb_init(void){
+	sim_mem[0x0528] = ((sim_key_next < sim_key_count) ? 1 : 0);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キー入力のセンス
+* @param[in] 無し
+* @param[out] 無し
+* @return 0=入力なし 1=入力あり
+* @details NONE、DUMP、WAITはここで読み捨てる。
+*/
+uint8_t kb_sense(void){
+	if((sim_key_next < sim_key_count) && (sim_keys[sim_key_next] >= SIM_KEY_WAIT)){
+		sim_key_special(sim_keys[sim_key_next++]);
+		kb_init();
+		return 0;
+	}
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief シフトキー状態
+* @param[in] 無し
+* @param[out] 無し
+* @return bit0=SHIFT
+* @details
+*/
+uint8_t kb_shift(void){
+	if(sim_key_next < sim_key_count){
+		return (uint8_t)(sim_keys[sim_key_next] >> 8);
+	}
+	return 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーの読み込み
+* @param[in] 無し
+* @param[out] 無し
+* @return キーコード
+* @details キー列を使い切った後はESCを返し続ける。
+*/
+uint8_t kb_read(void){
+	uint8_t code = 0x00;
+
+	if(sim_key_next < sim_key_count){
+		code = (uint8_t)sim_keys[sim_key_next++];
+	}
+	kb_init();
+	return code;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボード割り込みを乗っ取る
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 以後、キー列はhal_kb_get()からスキャンコードとして返す。
+*/
+void hal_kb_hook(void){
+	sim_kb_count  = 0;
+	sim_kb_next   = 0;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボード割り込みを元に戻す
+* @param[in] 無し
+* @param[out] 無し
+* @return 無し
+* @details 模擬環境では何もしない。
+*/
+void hal_kb_unhook(void){
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief キーボードから受け取ったスキャンコードを1つ取り出す
+* @param[in] 無し
+* @param[out] スキャンコード（bit7=離した）
+* @return 1=取り出した 0=無い
+* @details キー列の1キーを、押す・離すのスキャンコードに直して順に返す。SHIFT付きならSHIFT(0x70)の押し離しで挟む。
+* @details 1キー分を返し終えるごとに1回「無い」を返す。NONE、DUMP、WAITも1回分の「無い」になる。
+* @details キー列を使い切った後はESCを押し続ける。
+*/
+uint8_t hal_kb_get(uint8_t *code){
+	if((sim_kb_count != 0) && (sim_kb_next >= sim_kb_count)){
+		sim_kb_count = 0;						//1キー分を返し終えたら1回「無い」を挟む
+		return 0;
+	}
+	if(sim_kb_count == 0){
+		uint16_t key = 0x0000;
+
+		if(sim_key_next < sim_key_count){
+			key = sim_keys[sim_key_next++];
+		}
+		kb_init();
+		if(key >= SIM_KEY_WAIT){
+			sim_key_special(key);
+			return 0;
+		}
+		sim_kb_next  = 0;
+		if(key & 0x0100){
+			sim_kb_codes[sim_kb_count++] = 0x70;
+		}
+		sim_kb_codes[sim_kb_count++] = (uint8_t)key;
+		sim_kb_codes[sim_kb_count++] = (uint8_t)key | 0x80;
+		if(key & 0x0100){
+			sim_kb_codes[sim_kb_count++] = 0xF0;
+		}
+	}
+	*code = sim_kb_codes[sim_kb_next++];
+	return 1;
+}
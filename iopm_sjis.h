@@ -0,0 +1,78 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+* @file iopm_sjis.h
+* @brief iopm SJISからテキストVRAMの文字コードへの変換
+* @author antarcticlion
+* @date 17Oct2026
+* @details iopm本体と、ビルド時に固定文字列を変換するiopm_mkcellsの両方で使う。
+*/
+
+#ifndef IOPM_SJIS_H
+#define IOPM_SJIS_H
+
+#include <stdint.h>
+
+//-------------------------------------------------------------------------
+/**
+* @brief 指定された文字コードはSJISかどうかを判定する
+* @param[in] 判定する1バイトコード
+* @param[out] 無し
+* @return 1=SJIS 0=SJISじゃない
+* @details 渡された8ビットデータが、SJIS漢字文字コードの1バイト目かどうかを判定する。
+*/
+uint8_t is_SJIS(uint8_t code){
+	uint8_t result = 0;
+	if(      (code > 0x80) && (code < 0xA0)){
+		result = 1;
+	}else if((code > 0xDF) && (code < 0xFD)){
+		result = 1;
+	}
+	return result;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief SJIS文字コードをVRAMに格納される形式(JIS)に変換する
+* @param[in] SJISの1バイト目、2バイト目
+* @param[out] 無し
+* @return VRAM形式(JIS)の漢字コード
+* @details printf書式ではないことに注意。
+*/
+uint16_t SJIS_to_VRAM(uint8_t code1, uint8_t code2){
+  code1 <<= 1;
+  if( code2 < 0x9F ){
+    if( code1 < 0x3F ){
+		code1 += 0x1F;
+	}else{
+		code1 -= 0x61;
+	}
+    if( code2 > 0x7E ){
+		code2 -= 0x20;
+	}else{
+		code2 -= 0x1F;
+	}
+  }else{
+    if( code1 < 0x3F ){
+		code1 += 0x20;
+	}else{
+		code1 -= 0x60;
+	}
+    code2 -= 0x7E;
+  }
+  code1 -= 0x20;
+
+  return (((uint16_t)code2)<< 8) + ((uint16_t)code1);
+}
+
+#endif
@@ -0,0 +1,283 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+//-------------------------------------------------------------------------
+/**
+* @file iopm_trace.c
+* @brief iopm トレースファイルの解析ツール（Linux上で動かす）
+* @author antarcticlion
+* @date 17Oct2026
+* @details 'make tools'でビルドする。iopm.exeがf･4で書き出したIOPMnnnn.IOTを読む。
+* @details
+* @details iopm_trace ファイル名　　　　レコードをCSVで標準出力に書き出す
+* @details iopm_trace -s ファイル名　　ポートごとの読み書き回数、読み書きの比、値の分布を書き出す
+* @details
+* @details ファイルはリトルエンディアンのバイト列として読むので、実行するマシンのエンディアンや詰め物に依存しない。
+*/
+//-------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "iopm_trace.h"
+
+/// 分布で表示する値の数
+#define TOOL_TOP_VALUES 8
+
+///値1個分の出現回数
+typedef struct type_value_count {
+	/// 値
+	uint16_t value;
+	/// 回数
+	uint32_t count;
+} st_value_count;
+
+///ポート1個分の集計
+typedef struct type_port_stat {
+	/// 読み込み回数
+	uint32_t reads;
+	/// 書き込み回数
+	uint32_t writes;
+	/// 16ビットアクセスの回数
+	uint32_t wides;
+	/// 値の種類数
+	uint32_t kinds;
+	/// 確保済みの値の数
+	uint32_t room;
+	/// 値ごとの出現回数
+	st_value_count *values;
+} st_port_stat;
+
+///ポートごとの集計
+static st_port_stat tool_ports[0x10000];
+
+//-------------------------------------------------------------------------
+/**
+* @brief リトルエンディアンの16ビット値を取り出す
+* @param[in] バイト列
+* @param[out] 無し
+* @return 値
+* @details
+*/
+static uint16_t get16(const uint8_t *bytes){
+	return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief リトルエンディアンの32ビット値を取り出す
+* @param[in] バイト列
+* @param[out] 無し
+* @return 値
+* @details
+*/
+static uint32_t get32(const uint8_t *bytes){
+	return (uint32_t)get16(bytes) | ((uint32_t)get16(bytes + 2) << 16);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief ヘッダを読む
+* @param[in] ファイル
+* @param[out] ヘッダ
+* @return 1=成功 0=トレースファイルではない
+* @details
+*/
+static int read_head(FILE *fp, st_trace_head *head){
+	uint8_t bytes[TRACE_HEAD_SIZE];
+
+	if(fread(bytes, 1, TRACE_HEAD_SIZE, fp) != TRACE_HEAD_SIZE){
+		return 0;
+	}
+	memcpy(head->magic, bytes, 4);
+	head->version = bytes[4];
+	head->source  = bytes[5];
+	head->flags   = get16(bytes + 6);
+	head->clock   = get32(bytes + 8);
+	head->records = get32(bytes + 12);
+	return (memcmp(head->magic, TRACE_MAGIC, 4) == 0) && (head->version == TRACE_VERSION);
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief レコードを1件読む
+* @param[in] ファイル
+* @param[out] レコード
+* @return 1=読めた 0=ファイルの終わり
+* @details
+*/
+static int read_rec(FILE *fp, st_trace_rec *rec){
+	uint8_t bytes[TRACE_REC_SIZE];
+
+	if(fread(bytes, 1, TRACE_REC_SIZE, fp) != TRACE_REC_SIZE){
+		return 0;
+	}
+	rec->flags = bytes[0];
+	rec->addr  = get16(bytes + 1);
+	rec->data  = get16(bytes + 3);
+	rec->delta = get16(bytes + 5);
+	return 1;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 値の出現回数を1つ増やす
+* @param[in] ポートの集計、値
+* @param[out] 無し
+* @return 無し
+* @details 値の種類は多くないので線形探索で足りる。
+*/
+static void count_value(st_port_stat *port, uint16_t value){
+	for(uint32_t index = 0; index < port->kinds; index++){
+		if(port->values[index].value == value){
+			port->values[index].count++;
+			return;
+		}
+	}
+	if(port->kinds == port->room){
+		port->room   = (port->room ? (port->room * 2) : 16);
+		port->values = realloc(port->values, port->room * sizeof(st_value_count));
+		if(port->values == NULL){
+			fprintf(stderr, "iopm_trace: out of memory\n");
+			exit(2);
+		}
+	}
+	port->values[port->kinds].value = value;
+	port->values[port->kinds].count = 1;
+	port->kinds++;
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 出現回数の多い順に並べるための比較
+* @param[in] 比較する2件
+* @param[out] 無し
+* @return qsortの比較結果
+* @details 回数が同じなら値の小さい順。
+*/
+static int compare_count(const void *left, const void *right){
+	const st_value_count *a = left;
+	const st_value_count *b = right;
+
+	if(a->count != b->count){
+		return ((a->count < b->count) ? 1 : -1);
+	}
+	return ((a->value > b->value) - (a->value < b->value));
+}
+
+//-------------------------------------------------------------------------
+/**
+* @brief 解析ツール本体
+* @param[in] 引数の数、引数
+* @param[out] 無し
+* @return 0=成功 1=ファイルが壊れている 2=引数やファイルの誤り
+* @details
+*/
+int main(int argc, char *argv[]){
+	int             summary = 0;
+	const char     *name;
+	FILE           *fp;
+	st_trace_head   head;
+	st_trace_rec    rec;
+	uint64_t        time    = 0;
+	uint32_t        number  = 0;
+	uint32_t        reads   = 0;
+	uint32_t        writes  = 0;
+
+	if((argc == 3) && !strcmp(argv[1], "-s")){
+		summary = 1;
+		name    = argv[2];
+	}else if(argc == 2){
+		name    = argv[1];
+	}else{
+		fprintf(stderr, "USAGE: iopm_trace [-s] file.IOT\n");
+		return 2;
+	}
+	if((fp = fopen(name, "rb")) == NULL){
+		fprintf(stderr, "iopm_trace: cannot open %s\n", name);
+		return 2;
+	}
+	if(!read_head(fp, &head) || (head.clock == 0)){
+		fprintf(stderr, "iopm_trace: %s is not an iopm trace file\n", name);
+		fclose(fp);
+		return 2;
+	}
+
+	if(!summary){
+		printf("no,time_us,delta_ticks,rw,width,addr,data\n");
+	}
+	while(read_rec(fp, &rec)){
+		if(rec.flags & TRACE_FLAG_SKIP){
+			time += ((uint32_t)rec.addr << 16) | rec.data;
+			continue;
+		}
+		time += rec.delta;
+		if(summary){
+			st_port_stat *port = &tool_ports[rec.addr];
+			if(rec.flags & TRACE_FLAG_WRITE){
+				port->writes++;
+				writes++;
+			}else{
+				port->reads++;
+				reads++;
+			}
+			if(rec.flags & TRACE_FLAG_16BIT){
+				port->wides++;
+			}
+			count_value(port, rec.data);
+		}else{
+			printf("%u,%.3f,%u,%c,%d,%04X,%0*X\n", number, (double)time * 1e6 / head.clock, rec.delta,
+				((rec.flags & TRACE_FLAG_WRITE) ? 'W' : 'R'), ((rec.flags & TRACE_FLAG_16BIT) ? 16 : 8),
+				rec.addr, ((rec.flags & TRACE_FLAG_16BIT) ? 4 : 2), rec.data);
+		}
+		number++;
+	}
+	fclose(fp);
+
+	if(summary){
+		printf("file     : %s\n", name);
+		printf("source   : %s\n", ((head.source == TRACE_SOURCE_CAPTURE) ? "capture" : ((head.source == TRACE_SOURCE_SESSION) ? "session" : "log")));
+		printf("records  : %u (header says %u)\n", number, head.records);
+		printf("reads    : %u\n", reads);
+		printf("writes   : %u\n", writes);
+		if(head.flags & TRACE_HEAD_TIMED){
+			printf("span     : %.3f us (PIT %u Hz)\n", (double)time * 1e6 / head.clock, head.clock);
+			if(time){
+				printf("rate     : %.1f ops/s\n", (double)(number - 1) * head.clock / time);
+			}
+		}else{
+			printf("span     : untimed\n");
+		}
+		printf("\n port    reads   writes   r/w    16bit  kinds  top values (value:count)\n");
+		for(uint32_t addr = 0; addr < 0x10000; addr++){
+			st_port_stat *port = &tool_ports[addr];
+			if((port->reads + port->writes) == 0){
+				continue;
+			}
+			printf(" %04X %8u %8u ", addr, port->reads, port->writes);
+			if(port->writes){
+				printf("%6.2f", (double)port->reads / port->writes);
+			}else{
+				printf("%6s", "-");
+			}
+			printf(" %8u %6u ", port->wides, port->kinds);
+			qsort(port->values, port->kinds, sizeof(st_value_count), compare_count);
+			for(uint32_t index = 0; (index < port->kinds) && (index < TOOL_TOP_VALUES); index++){
+				printf(" %04X:%u", port->values[index].value, port->values[index].count);
+			}
+			printf("\n");
+			free(port->values);
+		}
+	}
+
+	return ((number == head.records) ? 0 : 1);
+}
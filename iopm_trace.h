@@ -0,0 +1,89 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+* @file iopm_trace.h
+* @brief iopm トレースファイルの形式
+* @author antarcticlion
+* @date 17Oct2026
+* @details iopm本体（書き出し側）と、Linux上でトレースを解析するiopm_traceの両方で使う。
+* @details
+* @details ファイルはヘッダ1個とレコードの並び。数値はすべてリトルエンディアンで、詰め物は入れない。
+* @details 時間はPITのカウント数で、ヘッダのclockで割ると秒になる。
+* @details 前のレコードからの間隔が16ビットに収まらない場合は、先にTRACE_FLAG_SKIPのレコードを置いて
+* @details addr:dataの32ビット分を時刻に足す。
+*/
+
+#ifndef IOPM_TRACE_H
+#define IOPM_TRACE_H
+
+#include <stdint.h>
+
+/// トレース　ファイルの識別子
+#define TRACE_MAGIC          "IOPT"
+/// トレース　形式の版
+#define TRACE_VERSION        1
+/// トレース　ヘッダの大きさ
+#define TRACE_HEAD_SIZE      16
+/// トレース　レコードの大きさ
+#define TRACE_REC_SIZE       7
+
+/// トレースの出どころ　メイン画面のログ
+#define TRACE_SOURCE_LOG     0
+/// トレースの出どころ　キャプチャ
+#define TRACE_SOURCE_CAPTURE 1
+/// トレースの出どころ　記録した操作（再生できる）
+#define TRACE_SOURCE_SESSION 2
+
+/// ヘッダの属性　レコードの間隔が有効
+#define TRACE_HEAD_TIMED     0x0001
+
+/// レコードの属性　書き込み
+#define TRACE_FLAG_WRITE     0x01
+/// レコードの属性　16ビット
+#define TRACE_FLAG_16BIT     0x02
+/// レコードの属性　時間だけを進めるレコード
+#define TRACE_FLAG_SKIP      0x80
+
+#pragma pack(push, 1)
+
+///トレースファイルのヘッダ
+typedef struct type_trace_head {
+	/// TRACE_MAGIC
+	uint8_t  magic[4];
+	/// TRACE_VERSION
+	uint8_t  version;
+	/// TRACE_SOURCE_LOG、TRACE_SOURCE_CAPTURE
+	uint8_t  source;
+	/// TRACE_HEAD_TIMED
+	uint16_t flags;
+	/// PITの入力クロック[Hz]
+	uint32_t clock;
+	/// レコード数
+	uint32_t records;
+} st_trace_head;
+
+///トレースファイルのレコード
+typedef struct type_trace_rec {
+	/// TRACE_FLAG_WRITE、TRACE_FLAG_16BIT、TRACE_FLAG_SKIP
+	uint8_t  flags;
+	/// アドレス
+	uint16_t addr;
+	/// データ
+	uint16_t data;
+	/// 前のレコードからの間隔（PITのカウント数）
+	uint16_t delta;
+} st_trace_rec;
+
+#pragma pack(pop)
+
+#endif
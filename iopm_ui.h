@@ -0,0 +1,50 @@
+/*
+PC-9801/9821 series I/O Port manipulator
+
+Copyright (C) 2023 antarcticlion
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 3 of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+/**
+* @file iopm_ui.h
+* @brief iopm 画面の固定文字列
+* @author antarcticlion
+* @date 17Oct2026
+* @details ここに書いた文字列は、ビルド時にiopm_mkcellsがテキストVRAMの文字コード列に変換してiopm_cells.hを作る。
+* @details 実行時は変換済みのセルをシャドウVRAMに写すだけになる。
+* @details
+* @details UI_LABEL(名前, ｘ, ｙ, 属性, 文字列)　メイン画面の決まった位置に決まった属性で描く文字列
+* @details UI_TEXT(名前, 文字列)　　　　　　　　 位置と属性を実行時に決める文字列
+* @details
+* @details 注：ファイルは必ずUTF-8で保存すること。iopm_mkcellsのビルド時にSJISに変換される。
+*/
+
+/// メイン画面の固定文字列
+#define UI_MAIN_LABELS \
+	UI_LABEL(main_addr,     2,  1, ATTR_COLOR_WHITE,  "アドレス:    [0x0188]") \
+	UI_LABEL(main_data16,   2,  3, ATTR_COLOR_WHITE,  "データ16:    [0x----]") \
+	UI_LABEL(main_data8,    2,  5, ATTR_COLOR_WHITE,  "データ 8:      [0x--]") \
+	UI_LABEL(main_logh1,   27,  1, (ATTR_COLOR_GREEN | ATTR_UNDERLINE), "R/W : 8/16 : ADDR : DATA") \
+	UI_LABEL(main_logh2,   54,  1, (ATTR_COLOR_GREEN | ATTR_UNDERLINE), "R/W : 8/16 : ADDR : DATA") \
+	UI_LABEL(main_help1,    1,  7, ATTR_COLOR_WHITE,  "　↑　　　　　　　　　　") \
+	UI_LABEL(main_help2,    1,  8, ATTR_COLOR_WHITE,  "←　→　　　　　　　MOVE") \
+	UI_LABEL(main_help3,    1,  9, ATTR_COLOR_WHITE,  "　↓　　　　　　　　　　") \
+	UI_LABEL(main_help4,    1, 11, ATTR_COLOR_WHITE,  "[SHIFT]+[↑]　　数値　UP") \
+	UI_LABEL(main_help5,    1, 12, ATTR_COLOR_WHITE,  "[SHIFT]+[↓]　　数値DOWN") \
+	UI_LABEL(main_help6,    1, 13, ATTR_COLOR_WHITE,  "[SPACE] 　　 8ビット読込") \
+	UI_LABEL(main_help7,    1, 14, ATTR_COLOR_WHITE,  "[SHIFT]+[SPACE] 　　書込") \
+	UI_LABEL(main_help8,    1, 15, ATTR_COLOR_WHITE,  "[RETURN]　　16ビット読込") \
+	UI_LABEL(main_help9,    1, 16, ATTR_COLOR_WHITE,  "[SHIFT]+[RETURN]　　書込") \
+	UI_LABEL(main_help10,   1, 17, ATTR_COLOR_WHITE,  "[ESC] 　　　　　　　終了") \
+	UI_LABEL(main_title,    1, 20, ATTR_COLOR_YELLOW, "I/O Port manipulator") \
+	UI_LABEL(main_version, 15, 21, ATTR_COLOR_YELLOW, "  Ver 1.26")
+
+/// 実行時に位置と属性を決める文字列
+#define UI_TEXTS \
+	UI_TEXT(log_used,  " *  :  **  : __00 : __00") \
+	UI_TEXT(log_empty, "--- : ---- : ---- : ----")